@@ -0,0 +1,99 @@
+#include "vke_async_compute.hpp"
+
+// std
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+namespace vke {
+    VkeAsyncCompute::VkeAsyncCompute(VkeDevice& device, uint32_t framesInFlight) : m_device{ device } {
+        if (!isActive())
+            return;
+
+        m_commandBuffers.resize(framesInFlight);
+        m_slotValues.assign(framesInFlight, 0);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_device.getComputeCommandPool();
+        allocInfo.commandBufferCount = framesInFlight;
+        if (vkAllocateCommandBuffers(m_device.device(), &allocInfo, m_commandBuffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate async compute command buffers!");
+        }
+
+        VkSemaphoreTypeCreateInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        timelineInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &timelineInfo;
+        if (vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_timeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create async compute timeline semaphore!");
+        }
+    }
+
+    VkeAsyncCompute::~VkeAsyncCompute() {
+        if (!isActive())
+            return;
+
+        vkQueueWaitIdle(m_device.computeQueue());
+        vkDestroySemaphore(m_device.device(), m_timeline, nullptr);
+        vkFreeCommandBuffers(m_device.device(), m_device.getComputeCommandPool(), static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
+    }
+
+    VkCommandBuffer VkeAsyncCompute::begin(uint32_t frameIndex) {
+        assert(isActive() && "Async compute is unavailable on this device");
+        assert(frameIndex < m_commandBuffers.size() && "Frame index out of range");
+
+        // Normally already reached, the graphics frame that used the slot last waited for this work
+        if (m_slotValues[frameIndex] != 0) {
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &m_timeline;
+            waitInfo.pValues = &m_slotValues[frameIndex];
+            vkWaitSemaphores(m_device.device(), &waitInfo, std::numeric_limits<uint64_t>::max());
+        }
+
+        VkCommandBuffer commandBuffer = m_commandBuffers[frameIndex];
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording async compute command buffer!");
+        }
+        return commandBuffer;
+    }
+
+    uint64_t VkeAsyncCompute::submit(uint32_t frameIndex) {
+        VkCommandBuffer commandBuffer = m_commandBuffers[frameIndex];
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record async compute command buffer!");
+        }
+
+        uint64_t value = m_submitted + 1;
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &value;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_timeline;
+
+        if (vkQueueSubmit(m_device.computeQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit async compute command buffer!");
+        }
+
+        m_submitted = value;
+        m_slotValues[frameIndex] = value;
+        return value;
+    }
+}
\ No newline at end of file
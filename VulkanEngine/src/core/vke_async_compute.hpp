@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vke_device.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <vector>
+
+namespace vke {
+	// Records and submits compute work on the device's async compute queue, one command buffer per frame in
+	// flight. Submissions signal a timeline semaphore the graphics submission that consumes the results waits on.
+	// Inactive when the device has no separate compute family, the work then stays on the graphics queue
+	class VkeAsyncCompute {
+	public:
+		VkeAsyncCompute(VkeDevice& device, uint32_t framesInFlight);
+		~VkeAsyncCompute();
+
+		VkeAsyncCompute(const VkeAsyncCompute&) = delete;
+		VkeAsyncCompute& operator=(const VkeAsyncCompute&) = delete;
+
+		bool isActive() const { return m_device.hasAsyncCompute(); }
+
+		// Waits for the slot's previous submission before handing its command buffer out for recording
+		VkCommandBuffer begin(uint32_t frameIndex);
+		// Returns the timeline value that is reached once the work has finished
+		uint64_t submit(uint32_t frameIndex);
+
+		VkSemaphore getTimeline() const { return m_timeline; }
+
+	private:
+		VkeDevice& m_device;
+		std::vector<VkCommandBuffer> m_commandBuffers;
+		std::vector<uint64_t> m_slotValues; // Last value submitted from each slot
+		VkSemaphore m_timeline = VK_NULL_HANDLE;
+		uint64_t m_submitted = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "vke_bindless_heap.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace vke {
+    VkeBindlessHeap::VkeBindlessHeap(VkeDevice& device) : m_device{ device } {
+        // Slots are never all written, and are rewritten while earlier frames holding the set are still executing
+        VkDescriptorBindingFlags bindingFlags =
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+        m_setLayout = VkeDescriptorSetLayout::Builder(device)
+            .addBinding(BINDLESS_TEXTURE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_ALL, MAX_BINDLESS_TEXTURES)
+            .addBinding(BINDLESS_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL, MAX_BINDLESS_BUFFERS)
+            .setBindingFlags(BINDLESS_TEXTURE_BINDING, bindingFlags)
+            .setBindingFlags(BINDLESS_BUFFER_BINDING, bindingFlags)
+            .buildShared();
+
+        m_pool = VkeDescriptorPool::Builder(device)
+            .setMaxSets(1)
+            .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+            .addPoolSizes(*m_setLayout, 1)
+            .build();
+
+        if (!m_pool->allocateDescriptor(m_setLayout->getDescriptorSetLayout(), m_descriptorSet)) {
+            throw std::runtime_error("failed to allocate bindless descriptor set!");
+        }
+    }
+
+    VkeBindlessHeap::~VkeBindlessHeap() {
+        assert(
+            m_textureSlots.freeSlots.size() == m_textureSlots.next && m_bufferSlots.freeSlots.size() == m_bufferSlots.next &&
+            "Bindless heap destroyed while resources still hold slots");
+    }
+
+    uint32_t VkeBindlessHeap::addTexture(const VkDescriptorImageInfo& imageInfo) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint32_t index = m_textureSlots.allocate();
+        write(BINDLESS_TEXTURE_BINDING, index, &imageInfo, nullptr);
+        return index;
+    }
+
+    uint32_t VkeBindlessHeap::addBuffer(const VkDescriptorBufferInfo& bufferInfo) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint32_t index = m_bufferSlots.allocate();
+        write(BINDLESS_BUFFER_BINDING, index, nullptr, &bufferInfo);
+        return index;
+    }
+
+    void VkeBindlessHeap::removeTexture(uint32_t index) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_textureSlots.release(index);
+    }
+
+    void VkeBindlessHeap::removeBuffer(uint32_t index) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bufferSlots.release(index);
+    }
+
+    void VkeBindlessHeap::write(uint32_t binding, uint32_t index, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_descriptorSet;
+        write.dstBinding = binding;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = m_setLayout->getBindings().at(binding).descriptorType;
+        write.pImageInfo = imageInfo;
+        write.pBufferInfo = bufferInfo;
+        vkUpdateDescriptorSets(m_device.device(), 1, &write, 0, nullptr);
+    }
+
+    // Freed slots first, so the arrays stay dense and the highest used slot stays low
+    uint32_t VkeBindlessHeap::SlotAllocator::allocate() {
+        if (!freeSlots.empty()) {
+            uint32_t index = freeSlots.back();
+            freeSlots.pop_back();
+            return index;
+        }
+        if (next == capacity) {
+            throw std::runtime_error("----- VKE DESCRIPTOR ERROR ----- : Bindless heap is full");
+        }
+        return next++;
+    }
+
+    void VkeBindlessHeap::SlotAllocator::release(uint32_t index) {
+        assert(index < next && "Released a bindless slot that was never allocated");
+        freeSlots.push_back(index);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "vke_descriptors.hpp"
+
+// std
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Set index shared by every pipeline, see bindless.glsl
+#define BINDLESS_SET 3
+#define BINDLESS_TEXTURE_BINDING 0
+#define BINDLESS_BUFFER_BINDING 1
+#define MAX_BINDLESS_TEXTURES 4096
+#define MAX_BINDLESS_BUFFERS 4096
+
+// Slot value of a resource that isn't in the heap, shaders test for it before indexing
+#define BINDLESS_INVALID_INDEX 0xFFFFFFFF
+
+namespace vke {
+	// One descriptor set holding every sampled texture and storage buffer in partially bound arrays. Resources take a
+	// stable slot on creation and shaders index the arrays by it, so materials never bind descriptor sets of their own.
+	// Slots are update after bind: adding a resource doesn't disturb frames in flight that never read the slot
+	class VkeBindlessHeap {
+	public:
+		VkeBindlessHeap(VkeDevice& device);
+		~VkeBindlessHeap();
+
+		VkeBindlessHeap(const VkeBindlessHeap&) = delete;
+		VkeBindlessHeap& operator=(const VkeBindlessHeap&) = delete;
+
+		// Thread safe. The owner removes the slot before destroying the resource, the slot is then reused
+		uint32_t addTexture(const VkDescriptorImageInfo& imageInfo);
+		uint32_t addBuffer(const VkDescriptorBufferInfo& bufferInfo);
+		void removeTexture(uint32_t index);
+		void removeBuffer(uint32_t index);
+
+		std::shared_ptr<VkeDescriptorSetLayout> getSetLayout() const { return m_setLayout; }
+		VkDescriptorSet getDescriptorSet() const { return m_descriptorSet; }
+
+	private:
+		struct SlotAllocator {
+			explicit SlotAllocator(uint32_t slotCount) : capacity{ slotCount } { }
+
+			uint32_t capacity;
+			uint32_t next = 0;
+			std::vector<uint32_t> freeSlots;
+
+			uint32_t allocate();
+			void release(uint32_t index);
+		};
+
+		void write(uint32_t binding, uint32_t index, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo);
+
+		VkeDevice& m_device;
+		std::shared_ptr<VkeDescriptorSetLayout> m_setLayout;
+		std::unique_ptr<VkeDescriptorPool> m_pool;
+		VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+		std::mutex m_mutex;
+		SlotAllocator m_textureSlots{ MAX_BINDLESS_TEXTURES };
+		SlotAllocator m_bufferSlots{ MAX_BINDLESS_BUFFERS };
+	};
+}
\ No newline at end of file
@@ -35,7 +35,8 @@ namespace vke {
         uint32_t instanceCount,
         VkBufferUsageFlags usageFlags,
         VkMemoryPropertyFlags memoryPropertyFlags,
-        VkDeviceSize minOffsetAlignment)
+        VkDeviceSize minOffsetAlignment,
+        bool sharedWithCompute)
         : m_device{ device },
         m_instanceSize{ instanceSize },
         m_instanceCount{ instanceCount },
@@ -43,15 +44,31 @@ namespace vke {
         m_memoryPropertyFlags{ memoryPropertyFlags } {
         m_alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         m_bufferSize = m_alignmentSize * instanceCount;
-        device.createBuffer(m_bufferSize, usageFlags, memoryPropertyFlags, m_buffer, m_memory);
+        device.createBuffer(m_bufferSize, usageFlags, memoryPropertyFlags, m_buffer, m_memory, sharedWithCompute);
     }
 
     VkeBuffer::~VkeBuffer() {
+        if (m_bindlessIndex != BINDLESS_INVALID_INDEX) {
+            m_device.bindlessHeap().removeBuffer(m_bindlessIndex);
+        }
         unmap();
         vkDestroyBuffer(m_device.device(), m_buffer, nullptr);
         vkFreeMemory(m_device.device(), m_memory, nullptr);
     }
 
+    /**
+     * Slot of the whole buffer in the bindless storage buffer array, registered on first use
+     *
+     * @return Index shaders pass to bindlessBuffers[]
+     */
+    uint32_t VkeBuffer::getBindlessIndex() {
+        assert(m_usageFlags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT && "Only storage buffers can be bindless");
+        if (m_bindlessIndex == BINDLESS_INVALID_INDEX) {
+            m_bindlessIndex = m_device.bindlessHeap().addBuffer(descriptorInfo());
+        }
+        return m_bindlessIndex;
+    }
+
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
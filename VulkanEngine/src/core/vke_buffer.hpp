@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vke_device.hpp"
+#include "vke_bindless_heap.hpp"
 
 namespace vke {
     class VkeBuffer {
@@ -11,7 +12,8 @@ namespace vke {
             uint32_t instanceCount,
             VkBufferUsageFlags usageFlags,
             VkMemoryPropertyFlags memoryPropertyFlags,
-            VkDeviceSize minOffsetAlignment = 1);
+            VkDeviceSize minOffsetAlignment = 1,
+            bool sharedWithCompute = false);
         ~VkeBuffer();
 
         VkeBuffer(const VkeBuffer&) = delete;
@@ -30,6 +32,9 @@ namespace vke {
         VkDescriptorBufferInfo descriptorInfoForIndex(int index);
         VkResult invalidateIndex(int index);
 
+        // Registers the whole buffer in the bindless storage buffer array on first call
+        uint32_t getBindlessIndex();
+
         VkBuffer getBuffer() const { return m_buffer; }
         void* getMappedMemory() const { return m_mapped; }
         uint32_t getInstanceCount() const { return m_instanceCount; }
@@ -53,5 +58,6 @@ namespace vke {
         VkDeviceSize m_alignmentSize;
         VkBufferUsageFlags m_usageFlags;
         VkMemoryPropertyFlags m_memoryPropertyFlags;
+        uint32_t m_bindlessIndex = BINDLESS_INVALID_INDEX;
     };
 }
\ No newline at end of file
@@ -2,40 +2,43 @@
 
 #include "vke_core.hpp"
 
-#define MAX_FRAMES_IN_FLIGHT 2
 // https://github.com/lukasino1214/StellarEngine/blob/main/Engine/graphics/core.h
 // https://github.com/lukasino1214/StellarEngine/blob/main/Engine/graphics/core.cpp
 namespace vke {
-    void VkeCore::init(VkeDevice& device) {
-        globalDescriptorPool = VkeDescriptorPool::Builder(device)
-            .setMaxSets(MAX_POOL_SIZE)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000) // Object
-            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000) // Lighting
-            .build();
+    // Every shader binding the shared sets, the union of their reflected bindings defines sets 0 - 2. Set 3 is fixed
+    // by the bindless heap since reflection can't size its runtime arrays
+    static const std::vector<std::string> CORE_SET_SHADERS = {
+        "simple_shader.vert.spv", "simple_shader.frag.spv", "depth_prepass.vert.spv", "gbuffer.frag.spv",
+        "shadow.vert.spv", "point_shadow.vert.spv", "point_light.vert.spv", "point_light.frag.spv",
+        "fullscreen.vert.spv", "deferred_ambient.frag.spv", "deferred_light_volume.vert.spv", "deferred_light_volume.frag.spv",
+        "light_cluster.comp.spv"
+    };
 
-        globalSetLayout = VkeDescriptorSetLayout::Builder(device)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS) // Object
-            .addBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS) // Lighting
-            .build();
-
-        shadowDescriptorPool = VkeDescriptorPool::Builder(device)
-            .setMaxSets(MAX_POOL_SIZE)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000) // Shadow map
-            .build();
-
-        shadowSetLayout = VkeDescriptorSetLayout::Builder(device)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT) // Shadow map
-            .build();
+    void VkeCore::init(VkeDevice& device, uint32_t frameCount) {
+        VkePipelineRegistry& registry = device.pipelineRegistry();
+        globalSetLayout = registry.getSetLayout(CORE_SET_SHADERS, 0);  // Object, scene
+        shadowSetLayout = registry.getSetLayout(CORE_SET_SHADERS, 1);  // Shadow map, point shadow atlas, raw depth, moments
+        clusterSetLayout = registry.getSetLayout(CORE_SET_SHADERS, 2); // Cluster info, lights, light grid, light indices
+        bindlessSetLayout = device.bindlessHeap().getSetLayout();       // Textures, storage buffers
+        bindlessSet = device.bindlessHeap().getDescriptorSet();
 
         // Init sets
-        uint32_t size = MAX_FRAMES_IN_FLIGHT;
+        framesInFlight = frameCount;
+        uint32_t size = framesInFlight;
+        descriptorAllocator = std::make_unique<VkeDescriptorAllocator>(device);
+        frameDescriptorAllocators.clear();
+        for (uint32_t i = 0; i < size; i++) {
+            frameDescriptorAllocators.push_back(std::make_unique<VkeDescriptorAllocator>(device));
+        }
+
         objectSet = std::vector<VkDescriptorSet>(size);
         shadowSet = std::vector<VkDescriptorSet>(size);
+        clusterSet = std::vector<VkDescriptorSet>(size);
 
         // Init uniform buffer objects
         objectBuffers = std::vector<std::unique_ptr<VkeBuffer>>(size);
         sceneBuffers = std::vector<std::unique_ptr<VkeBuffer>>(size);
-        for (int i = 0; i < size; i++) {
+        for (uint32_t i = 0; i < size; i++) {
             objectBuffers[i] = std::make_unique<VkeBuffer>(
                 device,
                 sizeof(UniformBufferObject),
@@ -61,22 +64,25 @@ namespace vke {
         std::vector<VkDescriptorSetLayout> setLayouts{};
         setLayouts.push_back(globalSetLayout->getDescriptorSetLayout());
         setLayouts.push_back(shadowSetLayout->getDescriptorSetLayout());
+        setLayouts.push_back(clusterSetLayout->getDescriptorSetLayout());
+        setLayouts.push_back(bindlessSetLayout->getDescriptorSetLayout());
         return setLayouts;
     }
 
     void VkeCore::buildCoreDescriptorSets() {
-        uint32_t size = MAX_FRAMES_IN_FLIGHT;
+        uint32_t size = framesInFlight;
         for (int i = 0; i < (int)size; i++) {
             auto objectBuffer = objectBuffers[i]->descriptorInfo();
             auto sceneBuffer = sceneBuffers[i]->descriptorInfo();
 
-            VkeDescriptorWriter(*globalSetLayout, *globalDescriptorPool)
+            VkeDescriptorWriter(*globalSetLayout, *descriptorAllocator)
                 .writeBuffer(0, &objectBuffer)
                 .writeBuffer(1, &sceneBuffer)
                 .build(objectSet[i]);
         }
 
         descriptorSets[0] = objectSet;
+        descriptorSets[BINDLESS_SET] = std::vector<VkDescriptorSet>(size, bindlessSet);
     }
 
     std::vector<VkDescriptorSet> VkeCore::getSets(uint32_t frameIndex) {
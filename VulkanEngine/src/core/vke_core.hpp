@@ -3,32 +3,44 @@
 #include "vke_device.hpp"
 #include "vke_buffer.hpp"
 #include "vke_descriptors.hpp"
+#include "vke_pipeline_registry.hpp"
+#include "vke_bindless_heap.hpp"
 #include "vke_frame_info.hpp"
 
 #include <array>
 #include <memory>
 #include <vector>
 
-#define NUM_DESCRIPTOR_SETS 2
-#define MAX_POOL_SIZE 1000
+#define NUM_DESCRIPTOR_SETS 4
 
 // Note from past experiments, this class CANNOT be static. Can't call destructors on static objects.
-// I want to overhaul descriptors entirely. The current usage scales poorly, and cannot easily add incoming data to shaders
-// Check out these resources:
-// https://github.com/ARM-software/vulkan_best_practice_for_mobile_developers
+// Sets 0 - 2 hold per frame engine data, set 3 is the device's bindless heap where textures and storage buffers
+// are indexed by slot instead of bound, see VkeBindlessHeap
 // https://github.com/KhronosGroup/Vulkan-Samples/tree/master/samples/extensions/descriptor_indexing
 namespace vke {
 	class VkeCore {
 	public:
-		std::unique_ptr<VkeDescriptorPool> globalDescriptorPool;
-		std::unique_ptr<VkeDescriptorSetLayout> globalSetLayout;
+		// Every per frame vector below has this many entries
+		uint32_t framesInFlight = 0;
 
-		std::unique_ptr<VkeDescriptorPool> shadowDescriptorPool;
-		std::unique_ptr<VkeDescriptorSetLayout> shadowSetLayout;
+		// Sets that live as long as the renderer, grows as systems allocate
+		std::unique_ptr<VkeDescriptorAllocator> descriptorAllocator;
+
+		// One per frame in flight, reset once the slot's previous frame has finished. For sets only used by that frame's commands
+		std::vector<std::unique_ptr<VkeDescriptorAllocator>> frameDescriptorAllocators;
+
+		std::shared_ptr<VkeDescriptorSetLayout> globalSetLayout;
+		std::shared_ptr<VkeDescriptorSetLayout> shadowSetLayout;
+		std::shared_ptr<VkeDescriptorSetLayout> clusterSetLayout;
+
+		// Owned by the bindless heap, the same set for every frame
+		std::shared_ptr<VkeDescriptorSetLayout> bindlessSetLayout;
+		VkDescriptorSet bindlessSet = VK_NULL_HANDLE;
 
 		// Individual sets
 		std::vector<VkDescriptorSet> objectSet;
 		std::vector<VkDescriptorSet> shadowSet;
+		std::vector<VkDescriptorSet> clusterSet;
 
 		// Individual bindings within sets
 		// set = 0, binding = 0, 1, etc.
@@ -39,7 +51,7 @@ namespace vke {
 		std::vector<VkDescriptorSet> descriptorSets[NUM_DESCRIPTOR_SETS];
 		std::vector<VkDescriptorSet> getSets(uint32_t frameIndex);
 
-		void init(VkeDevice& device);
+		void init(VkeDevice& device, uint32_t frameCount);
 		void buildCoreDescriptorSets();
 		std::vector<VkDescriptorSetLayout> getSetLayouts();
 
@@ -3,6 +3,7 @@
 #include "vke_descriptors.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -22,25 +23,59 @@ namespace vke {
         return *this;
     }
 
+    VkeDescriptorSetLayout::Builder& VkeDescriptorSetLayout::Builder::setBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags) {
+        assert(bindings.count(binding) == 1 && "Binding flags set before the binding was added");
+        bindingFlags[binding] = flags;
+        return *this;
+    }
+
+    VkeDescriptorSetLayout::Builder& VkeDescriptorSetLayout::Builder::setFlags(VkDescriptorSetLayoutCreateFlags layoutFlags) {
+        flags = layoutFlags;
+        return *this;
+    }
+
     std::unique_ptr<VkeDescriptorSetLayout> VkeDescriptorSetLayout::Builder::build() const {
-        return std::make_unique<VkeDescriptorSetLayout>(m_device, bindings);
+        return std::make_unique<VkeDescriptorSetLayout>(m_device, bindings, bindingFlags, flags);
     }
 
     std::shared_ptr<VkeDescriptorSetLayout> VkeDescriptorSetLayout::Builder::buildShared() const {
-        return std::make_shared<VkeDescriptorSetLayout>(m_device, bindings);
+        return std::make_shared<VkeDescriptorSetLayout>(m_device, bindings, bindingFlags, flags);
+    }
+
+    std::shared_ptr<VkeDescriptorSetLayout> VkeDescriptorSetLayout::Builder::buildCached(VkeDescriptorLayoutCache& cache) const {
+        return cache.getLayout(bindings, bindingFlags, flags);
     }
 
     // *************** Descriptor Set Layout *********************
 
     VkeDescriptorSetLayout::VkeDescriptorSetLayout(
-        VkeDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings) : m_device{ device }, m_bindings{ bindings } {
+        VkeDevice& device,
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+        VkDescriptorSetLayoutCreateFlags flags) : m_device{ device }, m_bindings{ bindings }, m_flags{ flags } {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+        VkDescriptorSetLayoutCreateFlags layoutFlags = flags;
         for (auto kv : bindings) {
             setLayoutBindings.push_back(kv.second);
+
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+            if (setLayoutBindingFlags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) {
+                layoutFlags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+            }
         }
 
+        // Parallel to pBindings
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptorSetLayoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+        descriptorSetLayoutInfo.flags = layoutFlags;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
@@ -64,6 +99,13 @@ namespace vke {
         return *this;
     }
 
+    VkeDescriptorPool::Builder& VkeDescriptorPool::Builder::addPoolSizes(const VkeDescriptorSetLayout& setLayout, uint32_t setCount) {
+        for (auto& [binding, layoutBinding] : setLayout.getBindings()) {
+            m_poolSizes.push_back({ layoutBinding.descriptorType, layoutBinding.descriptorCount * setCount });
+        }
+        return *this;
+    }
+
     VkeDescriptorPool::Builder& VkeDescriptorPool::Builder::setPoolFlags(
         VkDescriptorPoolCreateFlags flags) {
         m_poolFlags = flags;
@@ -116,8 +158,7 @@ namespace vke {
         allocInfo.pSetLayouts = &descriptorSetLayout;
         allocInfo.descriptorSetCount = 1;
 
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-        // a new pool whenever an old pool fills up. But this is beyond our current scope
+        // Fixed size, VkeDescriptorAllocator chains pools for callers that can't size theirs up front
         if (vkAllocateDescriptorSets(m_device.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
             return false;
         }
@@ -136,10 +177,205 @@ namespace vke {
         vkResetDescriptorPool(m_device.device(), m_descriptorPool, 0);
     }
 
+    // *************** Descriptor Layout Cache *********************
+
+    std::shared_ptr<VkeDescriptorSetLayout> VkeDescriptorLayoutCache::getLayout(
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+        VkDescriptorSetLayoutCreateFlags flags) {
+        // Ordered by binding number so insertion order doesn't change the key
+        std::vector<uint32_t> numbers;
+        for (auto& [binding, layoutBinding] : bindings) {
+            numbers.push_back(binding);
+        }
+        std::sort(numbers.begin(), numbers.end());
+
+        std::string key(reinterpret_cast<const char*>(&flags), sizeof(flags));
+        for (uint32_t number : numbers) {
+            const VkDescriptorSetLayoutBinding& binding = bindings.at(number);
+            auto flags = bindingFlags.find(number);
+            uint32_t words[5] = {
+                binding.binding,
+                static_cast<uint32_t>(binding.descriptorType),
+                binding.descriptorCount,
+                binding.stageFlags,
+                flags != bindingFlags.end() ? flags->second : 0 };
+            key.append(reinterpret_cast<const char*>(words), sizeof(words));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto cached = m_layouts.find(key);
+        if (cached != m_layouts.end()) {
+            return cached->second;
+        }
+        auto layout = std::make_shared<VkeDescriptorSetLayout>(m_device, bindings, bindingFlags, flags);
+        m_layouts.emplace(key, layout);
+        return layout;
+    }
+
+    // *************** Descriptor Allocator *********************
+
+    VkeDescriptorAllocator::VkeDescriptorAllocator(VkeDevice& device, const std::vector<PoolSizeRatio>& ratios)
+        : m_device{ device }, m_ratios{ ratios } {}
+
+    VkeDescriptorAllocator::~VkeDescriptorAllocator() {
+        for (VkDescriptorPool pool : m_usedPools) {
+            vkDestroyDescriptorPool(m_device.device(), pool, nullptr);
+        }
+        for (VkDescriptorPool pool : m_freePools) {
+            vkDestroyDescriptorPool(m_device.device(), pool, nullptr);
+        }
+    }
+
+    std::vector<VkeDescriptorAllocator::PoolSizeRatio> VkeDescriptorAllocator::defaultRatios() {
+        return {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+            { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+            { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1.0f },
+        };
+    }
+
+    bool VkeDescriptorAllocator::allocate(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) {
+        if (m_currentPool == VK_NULL_HANDLE) {
+            m_currentPool = grabPool();
+            m_usedPools.push_back(m_currentPool);
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_currentPool;
+        allocInfo.pSetLayouts = &descriptorSetLayout;
+        allocInfo.descriptorSetCount = 1;
+
+        VkResult result = vkAllocateDescriptorSets(m_device.device(), &allocInfo, &descriptor);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            // Full, chain a fresh pool and retry once
+            m_currentPool = grabPool();
+            m_usedPools.push_back(m_currentPool);
+            allocInfo.descriptorPool = m_currentPool;
+            result = vkAllocateDescriptorSets(m_device.device(), &allocInfo, &descriptor);
+        }
+        return result == VK_SUCCESS;
+    }
+
+    void VkeDescriptorAllocator::resetPools() {
+        for (VkDescriptorPool pool : m_usedPools) {
+            vkResetDescriptorPool(m_device.device(), pool, 0);
+            m_freePools.push_back(pool);
+        }
+        m_usedPools.clear();
+        m_currentPool = VK_NULL_HANDLE;
+    }
+
+    VkDescriptorPool VkeDescriptorAllocator::grabPool() {
+        if (!m_freePools.empty()) {
+            VkDescriptorPool pool = m_freePools.back();
+            m_freePools.pop_back();
+            return pool;
+        }
+
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        for (auto& ratio : m_ratios) {
+            poolSizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio * m_setsPerPool)) });
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = m_setsPerPool;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(m_device.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+
+        // Each pool this allocator needs to chain is a sign the next should be bigger
+        m_setsPerPool = std::min(m_setsPerPool * 2, static_cast<uint32_t>(DESCRIPTOR_ALLOCATOR_MAX_SETS));
+        return pool;
+    }
+
+    // *************** Descriptor Update Template *********************
+
+    VkeDescriptorUpdateTemplate::Builder& VkeDescriptorUpdateTemplate::Builder::addEntry(
+        uint32_t binding, size_t offset, uint32_t count, size_t stride) {
+        assert(m_setLayout.getBindings().count(binding) == 1 && "Layout does not contain specified binding");
+
+        const VkDescriptorSetLayoutBinding& layoutBinding = m_setLayout.getBindings().at(binding);
+        bool isImage =
+            layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+            layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+            layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+            layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER ||
+            layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+
+        VkDescriptorUpdateTemplateEntry entry{};
+        entry.dstBinding = binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = count;
+        entry.descriptorType = layoutBinding.descriptorType;
+        entry.offset = offset;
+        entry.stride = stride != 0 ? stride : (isImage ? sizeof(VkDescriptorImageInfo) : sizeof(VkDescriptorBufferInfo));
+        m_entries.push_back(entry);
+        return *this;
+    }
+
+    VkeDescriptorUpdateTemplate::Builder& VkeDescriptorUpdateTemplate::Builder::setPushTarget(
+        VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set) {
+        m_bindPoint = bindPoint;
+        m_pipelineLayout = pipelineLayout;
+        m_set = set;
+        return *this;
+    }
+
+    std::unique_ptr<VkeDescriptorUpdateTemplate> VkeDescriptorUpdateTemplate::Builder::build() const {
+        bool push = m_setLayout.isPushDescriptor();
+        assert((!push || m_pipelineLayout != VK_NULL_HANDLE) && "Push descriptor template needs a push target");
+
+        VkDescriptorUpdateTemplateCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(m_entries.size());
+        createInfo.pDescriptorUpdateEntries = m_entries.data();
+        createInfo.templateType = push ?
+            VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR :
+            VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        createInfo.descriptorSetLayout = m_setLayout.getDescriptorSetLayout();
+        createInfo.pipelineBindPoint = m_bindPoint;
+        createInfo.pipelineLayout = m_pipelineLayout;
+        createInfo.set = m_set;
+        return std::make_unique<VkeDescriptorUpdateTemplate>(m_device, createInfo);
+    }
+
+    VkeDescriptorUpdateTemplate::VkeDescriptorUpdateTemplate(VkeDevice& device, const VkDescriptorUpdateTemplateCreateInfo& createInfo)
+        : m_device{ device }, m_pipelineLayout{ createInfo.pipelineLayout }, m_set{ createInfo.set } {
+        if (vkCreateDescriptorUpdateTemplate(m_device.device(), &createInfo, nullptr, &m_template) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor update template!");
+        }
+    }
+
+    VkeDescriptorUpdateTemplate::~VkeDescriptorUpdateTemplate() {
+        vkDestroyDescriptorUpdateTemplate(m_device.device(), m_template, nullptr);
+    }
+
+    void VkeDescriptorUpdateTemplate::update(VkDescriptorSet set, const void* data) const {
+        vkUpdateDescriptorSetWithTemplate(m_device.device(), set, m_template, data);
+    }
+
+    void VkeDescriptorUpdateTemplate::push(VkCommandBuffer commandBuffer, const void* data) const {
+        assert(m_device.cmdPushDescriptorSetWithTemplate != nullptr && "Push descriptors aren't supported by this device");
+        m_device.cmdPushDescriptorSetWithTemplate(commandBuffer, m_template, m_pipelineLayout, m_set, data);
+    }
+
     // *************** Descriptor Writer *********************
 
     VkeDescriptorWriter::VkeDescriptorWriter(VkeDescriptorSetLayout& setLayout, VkeDescriptorPool& pool)
-        : m_setLayout{ setLayout }, m_pool{ pool } {}
+        : m_setLayout{ setLayout }, m_pool{ &pool } {}
+
+    VkeDescriptorWriter::VkeDescriptorWriter(VkeDescriptorSetLayout& setLayout, VkeDescriptorAllocator& allocator)
+        : m_setLayout{ setLayout }, m_allocator{ &allocator } {}
 
     VkeDescriptorWriter& VkeDescriptorWriter::writeBuffer(
         uint32_t binding, VkDescriptorBufferInfo* bufferInfo) {
@@ -158,7 +394,8 @@ namespace vke {
         write.pBufferInfo = bufferInfo;
         write.descriptorCount = 1;
 
-        m_writes.push_back(write);
+        assert(m_writeCount < MAX_DESCRIPTOR_WRITES && "Too many writes for one VkeDescriptorWriter");
+        m_writes[m_writeCount++] = write;
         return *this;
     }
 
@@ -179,12 +416,15 @@ namespace vke {
         write.pImageInfo = imageInfo;
         write.descriptorCount = 1;
 
-        m_writes.push_back(write);
+        assert(m_writeCount < MAX_DESCRIPTOR_WRITES && "Too many writes for one VkeDescriptorWriter");
+        m_writes[m_writeCount++] = write;
         return *this;
     }
 
     bool VkeDescriptorWriter::build(VkDescriptorSet& set) {
-        bool success = m_pool.allocateDescriptor(m_setLayout.getDescriptorSetLayout(), set);
+        bool success = m_allocator != nullptr ?
+            m_allocator->allocate(m_setLayout.getDescriptorSetLayout(), set) :
+            m_pool->allocateDescriptor(m_setLayout.getDescriptorSetLayout(), set);
         if (!success) {
             return false;
         }
@@ -193,9 +433,9 @@ namespace vke {
     }
 
     void VkeDescriptorWriter::overwrite(VkDescriptorSet& set) {
-        for (auto& write : m_writes) {
-            write.dstSet = set;
+        for (uint32_t i = 0; i < m_writeCount; i++) {
+            m_writes[i].dstSet = set;
         }
-        vkUpdateDescriptorSets(m_pool.m_device.device(), m_writes.size(), m_writes.data(), 0, nullptr);
+        vkUpdateDescriptorSets(m_setLayout.m_device.device(), m_writeCount, m_writes.data(), 0, nullptr);
     }
 }
\ No newline at end of file
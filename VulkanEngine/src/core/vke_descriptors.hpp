@@ -3,11 +3,23 @@
 #include "vke_device.hpp"
 
 // std
+#include <array>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+// Sets in the first pool of a VkeDescriptorAllocator, each chained pool is larger up to the max
+#define DESCRIPTOR_ALLOCATOR_INITIAL_SETS 64
+#define DESCRIPTOR_ALLOCATOR_MAX_SETS 4096
+
+// Writes one VkeDescriptorWriter holds inline, no set in the engine comes close
+#define MAX_DESCRIPTOR_WRITES 16
+
 namespace vke {
+    class VkeDescriptorLayoutCache;
+
     class VkeDescriptorSetLayout {
     public:
         class Builder {
@@ -19,24 +31,39 @@ namespace vke {
                 VkDescriptorType descriptorType,
                 VkShaderStageFlags stageFlags,
                 uint32_t count = 1);
+            // Descriptor indexing flags of an added binding. Update after bind needs a pool created with the matching flag
+            Builder& setBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags);
+            // Layout create flags, e.g. VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR
+            Builder& setFlags(VkDescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<VkeDescriptorSetLayout> build() const;
             std::shared_ptr<VkeDescriptorSetLayout> buildShared() const;
+            // Returns the cache's layout when one with identical bindings was built before
+            std::shared_ptr<VkeDescriptorSetLayout> buildCached(VkeDescriptorLayoutCache& cache) const;
         private:
             VkeDevice& m_device;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+            VkDescriptorSetLayoutCreateFlags flags = 0;
         };
 
-        VkeDescriptorSetLayout(VkeDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+        VkeDescriptorSetLayout(
+            VkeDevice& device,
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+            VkDescriptorSetLayoutCreateFlags flags = 0);
         ~VkeDescriptorSetLayout();
         VkeDescriptorSetLayout(const VkeDescriptorSetLayout&) = delete;
         VkeDescriptorSetLayout& operator=(const VkeDescriptorSetLayout&) = delete;
 
         VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& getBindings() const { return m_bindings; }
+        bool isPushDescriptor() const { return m_flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR; }
 
     private:
         VkeDevice& m_device;
         VkDescriptorSetLayout m_descriptorSetLayout;
         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_bindings;
+        VkDescriptorSetLayoutCreateFlags m_flags;
 
         friend class VkeDescriptorWriter;
     };
@@ -48,6 +75,8 @@ namespace vke {
             Builder(VkeDevice& device) : m_device{ device } {}
 
             Builder& addPoolSize(VkDescriptorType descriptorType, uint32_t count);
+            // Room for setCount sets of the layout
+            Builder& addPoolSizes(const VkeDescriptorSetLayout& setLayout, uint32_t setCount);
             Builder& setPoolFlags(VkDescriptorPoolCreateFlags flags);
             Builder& setMaxSets(uint32_t count);
             std::unique_ptr<VkeDescriptorPool> build() const;
@@ -82,9 +111,102 @@ namespace vke {
         friend class VkeDescriptorWriter;
     };
 
+    // Layouts keyed by their bindings and binding flags, identical descriptions share one VkDescriptorSetLayout
+    class VkeDescriptorLayoutCache {
+    public:
+        VkeDescriptorLayoutCache(VkeDevice& device) : m_device{ device } {}
+
+        VkeDescriptorLayoutCache(const VkeDescriptorLayoutCache&) = delete;
+        VkeDescriptorLayoutCache& operator=(const VkeDescriptorLayoutCache&) = delete;
+
+        // Thread safe
+        std::shared_ptr<VkeDescriptorSetLayout> getLayout(
+            const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+            VkDescriptorSetLayoutCreateFlags flags = 0);
+
+    private:
+        VkeDevice& m_device;
+        std::mutex m_mutex;
+        std::unordered_map<std::string, std::shared_ptr<VkeDescriptorSetLayout>> m_layouts;
+    };
+
+    // Allocates from a chain of pools, adding a larger pool whenever the current one runs out. resetPools releases every
+    // set at once, so a per frame allocator hands out transient sets for the cost of a pool bump
+    class VkeDescriptorAllocator {
+    public:
+        // Descriptors of each type per set a pool is sized for
+        struct PoolSizeRatio {
+            VkDescriptorType type;
+            float ratio;
+        };
+
+        VkeDescriptorAllocator(VkeDevice& device, const std::vector<PoolSizeRatio>& ratios = defaultRatios());
+        ~VkeDescriptorAllocator();
+        VkeDescriptorAllocator(const VkeDescriptorAllocator&) = delete;
+        VkeDescriptorAllocator& operator=(const VkeDescriptorAllocator&) = delete;
+
+        // Only fails when a new pool can't be created either
+        bool allocate(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor);
+
+        // Every set allocated so far becomes invalid, the caller makes sure the GPU no longer uses them
+        void resetPools();
+
+        static std::vector<PoolSizeRatio> defaultRatios();
+
+    private:
+        VkDescriptorPool grabPool();
+
+        VkeDevice& m_device;
+        std::vector<PoolSizeRatio> m_ratios;
+        uint32_t m_setsPerPool = DESCRIPTOR_ALLOCATOR_INITIAL_SETS;
+        VkDescriptorPool m_currentPool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorPool> m_usedPools;
+        std::vector<VkDescriptorPool> m_freePools;
+    };
+
+    // Writes a whole set from one packed struct in a single driver call. Each entry points at a VkDescriptorImageInfo or
+    // VkDescriptorBufferInfo member of the struct. Built against a push descriptor layout, the struct is pushed straight
+    // into the command buffer instead, no set is ever allocated
+    class VkeDescriptorUpdateTemplate {
+    public:
+        class Builder {
+        public:
+            Builder(VkeDevice& device, const VkeDescriptorSetLayout& setLayout) : m_device{ device }, m_setLayout{ setLayout } {}
+
+            // offset of the binding's info in the struct, stride between array elements when count > 1
+            Builder& addEntry(uint32_t binding, size_t offset, uint32_t count = 1, size_t stride = 0);
+            // Required for push descriptor layouts, the pipeline layout the set is pushed to
+            Builder& setPushTarget(VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set);
+            std::unique_ptr<VkeDescriptorUpdateTemplate> build() const;
+        private:
+            VkeDevice& m_device;
+            const VkeDescriptorSetLayout& m_setLayout;
+            std::vector<VkDescriptorUpdateTemplateEntry> m_entries{};
+            VkPipelineBindPoint m_bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+            uint32_t m_set = 0;
+        };
+
+        VkeDescriptorUpdateTemplate(VkeDevice& device, const VkDescriptorUpdateTemplateCreateInfo& createInfo);
+        ~VkeDescriptorUpdateTemplate();
+        VkeDescriptorUpdateTemplate(const VkeDescriptorUpdateTemplate&) = delete;
+        VkeDescriptorUpdateTemplate& operator=(const VkeDescriptorUpdateTemplate&) = delete;
+
+        void update(VkDescriptorSet set, const void* data) const;
+        void push(VkCommandBuffer commandBuffer, const void* data) const;
+
+    private:
+        VkeDevice& m_device;
+        VkDescriptorUpdateTemplate m_template;
+        VkPipelineLayout m_pipelineLayout;
+        uint32_t m_set;
+    };
+
     class VkeDescriptorWriter {
     public:
         VkeDescriptorWriter(VkeDescriptorSetLayout& setLayout, VkeDescriptorPool& pool);
+        VkeDescriptorWriter(VkeDescriptorSetLayout& setLayout, VkeDescriptorAllocator& allocator);
 
         VkeDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
         VkeDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
@@ -94,7 +216,9 @@ namespace vke {
 
     private:
         VkeDescriptorSetLayout& m_setLayout;
-        VkeDescriptorPool& m_pool;
-        std::vector<VkWriteDescriptorSet> m_writes;
+        VkeDescriptorPool* m_pool = nullptr;
+        VkeDescriptorAllocator* m_allocator = nullptr;
+        std::array<VkWriteDescriptorSet, MAX_DESCRIPTOR_WRITES> m_writes;
+        uint32_t m_writeCount = 0;
     };
 }
\ No newline at end of file
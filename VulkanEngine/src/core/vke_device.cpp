@@ -1,4 +1,6 @@
 #include "vke_device.hpp"
+#include "vke_pipeline_registry.hpp"
+#include "vke_bindless_heap.hpp"
 
 namespace vke {
 #pragma region Callback functions
@@ -49,9 +51,20 @@ namespace vke {
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        createPipelineCache();
+        m_pipelineRegistry = std::make_unique<VkePipelineRegistry>(*this);
+        m_bindlessHeap = std::make_unique<VkeBindlessHeap>(*this);
     }
 
     VkeDevice::~VkeDevice() {
+        // Joins the compile workers, so the cache holds every pipeline before it's saved
+        m_pipelineRegistry.reset();
+        m_bindlessHeap.reset();
+        savePipelineCache();
+        vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+        if (m_computeCommandPool != m_commandPool) {
+            vkDestroyCommandPool(m_device, m_computeCommandPool, nullptr);
+        }
         vkDestroyCommandPool(m_device, m_commandPool, nullptr);
         vkDestroyDevice(m_device, nullptr);
 
@@ -63,6 +76,68 @@ namespace vke {
         vkDestroyInstance(m_instance, nullptr);
     }
 
+    void VkeDevice::createPipelineCache() {
+        std::vector<char> initialData;
+        std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+        if (file.is_open()) {
+            initialData.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(initialData.data(), initialData.size());
+        }
+
+        // Drivers should reject a foreign blob themselves, checking the header keeps a stale cache from reaching one that doesn't
+        VkPipelineCacheHeaderVersionOne header{};
+        bool valid = initialData.size() >= sizeof(header);
+        if (valid) {
+            std::memcpy(&header, initialData.data(), sizeof(header));
+            valid = header.headerSize >= sizeof(header) &&
+                header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                header.vendorID == properties.vendorID &&
+                header.deviceID == properties.deviceID &&
+                std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+        if (!valid && !initialData.empty()) {
+            std::cout << "Discarding pipeline cache built by a different device or driver" << std::endl;
+        }
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = valid ? initialData.size() : 0;
+        cacheInfo.pInitialData = valid ? initialData.data() : nullptr;
+
+        if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_pipelineCache) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    void VkeDevice::savePipelineCache() {
+        size_t dataSize = 0;
+        if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+            return;
+        }
+        std::vector<char> data(dataSize);
+        if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+            return;
+        }
+
+        // Write beside the old cache and swap it in, a crash mid write never leaves a truncated cache behind
+        std::string tempPath = std::string(PIPELINE_CACHE_PATH) + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.write(data.data(), dataSize)) {
+                std::cerr << "failed to write pipeline cache" << std::endl;
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, PIPELINE_CACHE_PATH, error);
+        if (error) {
+            std::cerr << "failed to replace pipeline cache: " << error.message() << std::endl;
+            std::filesystem::remove(tempPath, error);
+        }
+    }
+
     void VkeDevice::createInstance() {
         if (enableValidationLayers && !checkValidationLayerSupport()) {
             throw std::runtime_error("validation layers requested, but not available!");
@@ -74,7 +149,7 @@ namespace vke {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_2; // Multiview point light shadows, descriptor indexing
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -116,6 +191,14 @@ namespace vke {
         if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
+
+        m_computeCommandPool = m_commandPool;
+        if (m_hasAsyncCompute) {
+            poolInfo.queueFamilyIndex = m_computeFamily;
+            if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_computeCommandPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create compute command pool!");
+            }
+        }
     }
 
     void VkeDevice::createSurface() { m_window.createWindowSurface(m_instance, &m_surface); }
@@ -151,6 +234,9 @@ namespace vke {
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+        if (indices.computeFamilyHasValue) {
+            uniqueQueueFamilies.insert(indices.computeFamily);
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -164,16 +250,48 @@ namespace vke {
 
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.depthClamp = VK_TRUE; // Shadow casters in front of a cascade, see VkeShadowMapSystem
+
+        VkPhysicalDeviceMultiviewFeatures multiviewFeatures = {};
+        multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+        multiviewFeatures.multiview = VK_TRUE;
+
+        // Bindless set, see VkeBindlessHeap
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.pNext = &multiviewFeatures;
+        vulkan12Features.descriptorIndexing = VK_TRUE;
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        vulkan12Features.timelineSemaphore = VK_TRUE; // Frame pacing, see VkeSwapChain
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &vulkan12Features;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+        // Required extensions plus whichever optional ones the device offers
+        std::vector<const char*> enabledExtensions = m_deviceExtensions;
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME) == 0) {
+                enabledExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+                m_pushDescriptorsSupported = true;
+            }
+        }
+
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -191,6 +309,19 @@ namespace vke {
 
         vkGetDeviceQueue(m_device, indices.graphicsFamily, 0, &m_graphicsQueue);
         vkGetDeviceQueue(m_device, indices.presentFamily, 0, &m_presentQueue);
+
+        m_graphicsFamily = indices.graphicsFamily;
+        m_hasAsyncCompute = indices.computeFamilyHasValue;
+        m_computeFamily = m_hasAsyncCompute ? indices.computeFamily : indices.graphicsFamily;
+        vkGetDeviceQueue(m_device, m_computeFamily, 0, &m_computeQueue);
+        std::cout << "async compute: " << (m_hasAsyncCompute ? "queue family " + std::to_string(m_computeFamily) : "unavailable, using the graphics queue") << std::endl;
+
+        if (m_pushDescriptorsSupported) {
+            cmdPushDescriptorSetWithTemplate = (PFN_vkCmdPushDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(
+                m_device,
+                "vkCmdPushDescriptorSetWithTemplateKHR");
+            m_pushDescriptorsSupported = cmdPushDescriptorSetWithTemplate != nullptr;
+        }
     }
 
     bool VkeDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -207,8 +338,34 @@ namespace vke {
         VkPhysicalDeviceFeatures supportedFeatures;
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_2 || properties.limits.maxBoundDescriptorSets < MIN_BOUND_DESCRIPTOR_SETS) {
+            return false;
+        }
+
+        VkPhysicalDeviceMultiviewFeatures multiviewFeatures = {};
+        multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+        VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.pNext = &multiviewFeatures;
+        VkPhysicalDeviceFeatures2 features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+
+        bool descriptorIndexingSupported =
+            vulkan12Features.descriptorIndexing &&
+            vulkan12Features.runtimeDescriptorArray &&
+            vulkan12Features.descriptorBindingPartiallyBound &&
+            vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+            vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+            vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind &&
+            vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+
         return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-            supportedFeatures.samplerAnisotropy;
+            supportedFeatures.samplerAnisotropy && supportedFeatures.depthClamp && multiviewFeatures.multiview && descriptorIndexingSupported &&
+            vulkan12Features.timelineSemaphore;
     }
 
     VkBool32 VkeDevice::formatIsFilterable(VkFormat format, VkImageTiling tiling){
@@ -362,6 +519,16 @@ namespace vke {
             i++;
         }
 
+        // Compute families without graphics run beside the graphics queue instead of sharing it
+        for (uint32_t family = 0; family < queueFamilyCount; family++) {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+                indices.computeFamily = family;
+                indices.computeFamilyHasValue = true;
+                break;
+            }
+        }
+
         return indices;
     }
 
@@ -426,13 +593,22 @@ namespace vke {
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory) {
+        VkDeviceMemory& bufferMemory,
+        bool sharedWithCompute) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+        // Concurrent instead of ownership transfers, buffers have no layout or compression to lose
+        uint32_t queueFamilies[] = { m_graphicsFamily, m_computeFamily };
+        if (sharedWithCompute && m_hasAsyncCompute) {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = queueFamilies;
+        }
+
         if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to create vertex buffer!");
         }
@@ -548,4 +724,41 @@ namespace vke {
             throw std::runtime_error("failed to bind image memory!");
         }
     }
+
+    void VkeDevice::createTransientImageWithInfo(
+        const VkImageCreateInfo& imageInfo,
+        VkImage& image,
+        VkDeviceMemory& imageMemory) {
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(m_device, image, &memRequirements);
+
+        // Tile based GPUs can keep these in on chip memory, everything else falls back to device local
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProperties);
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((memRequirements.memoryTypeBits & (1 << i)) &&
+                (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+                properties = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+                break;
+            }
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate image memory!");
+        }
+
+        if (vkBindImageMemory(m_device, image, imageMemory, 0) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind image memory!");
+        }
+    }
 }
\ No newline at end of file
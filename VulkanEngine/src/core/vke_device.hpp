@@ -9,8 +9,20 @@
 #include <iostream>
 #include <set>
 #include <unordered_set>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+
+// Relative to the working directory, written on shutdown and reused by the next launch
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
+// Shared sets 0 - 3 plus the deferred input attachment set
+#define MIN_BOUND_DESCRIPTOR_SETS 5
 
 namespace vke {
+    class VkePipelineRegistry;
+    class VkeBindlessHeap;
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR capabilities;
         std::vector<VkSurfaceFormatKHR> formats;
@@ -20,8 +32,10 @@ namespace vke {
     struct QueueFamilyIndices {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
+        uint32_t computeFamily; // Compute without graphics, absent on devices with a single family
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
+        bool computeFamilyHasValue = false;
         bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
     };
 
@@ -47,6 +61,14 @@ namespace vke {
         VkSurfaceKHR surface() { return m_surface; }
         VkQueue graphicsQueue() { return m_graphicsQueue; }
         VkQueue presentQueue() { return m_presentQueue; }
+
+        // A separate compute family's queue and pool, the graphics ones when the device has none
+        bool hasAsyncCompute() const { return m_hasAsyncCompute; }
+        VkQueue computeQueue() { return m_computeQueue; }
+        VkCommandPool getComputeCommandPool() { return m_computeCommandPool; }
+        VkPipelineCache pipelineCache() { return m_pipelineCache; }
+        VkePipelineRegistry& pipelineRegistry() { return *m_pipelineRegistry; }
+        VkeBindlessHeap& bindlessHeap() { return *m_bindlessHeap; }
         QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(m_physicalDevice); }
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(m_physicalDevice); }
 
@@ -55,12 +77,14 @@ namespace vke {
             const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
         // Buffer Helper Functions
+        // Shared buffers are accessed concurrently by the graphics and async compute families
         void createBuffer(
             VkDeviceSize size,
             VkBufferUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkBuffer& buffer,
-            VkDeviceMemory& bufferMemory);
+            VkDeviceMemory& bufferMemory,
+            bool sharedWithCompute = false);
         VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -73,6 +97,16 @@ namespace vke {
             VkImage& image,
             VkDeviceMemory& imageMemory);
 
+        // For attachments that never leave the render pass, lazily allocated when the device offers it
+        void createTransientImageWithInfo(
+            const VkImageCreateInfo& imageInfo,
+            VkImage& image,
+            VkDeviceMemory& imageMemory);
+
+        // VK_KHR_push_descriptor, optional. Small sets can then be pushed into the command buffer instead of allocated
+        bool pushDescriptorsSupported() const { return m_pushDescriptorsSupported; }
+        PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplate = nullptr;
+
         // Physical Device
         VkPhysicalDeviceProperties properties;
         VkBool32 formatIsFilterable(VkFormat format, VkImageTiling tiling);
@@ -84,6 +118,8 @@ namespace vke {
         void pickPhysicalDevice();
         void createLogicalDevice();
         void createCommandPool();
+        void createPipelineCache();
+        void savePipelineCache();
 
         // helper functions
         bool isDeviceSuitable(VkPhysicalDevice device);
@@ -100,11 +136,20 @@ namespace vke {
         VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
         VkeWindow& m_window;
         VkCommandPool m_commandPool;
+        VkCommandPool m_computeCommandPool;
+        VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+        std::unique_ptr<VkePipelineRegistry> m_pipelineRegistry;
+        std::unique_ptr<VkeBindlessHeap> m_bindlessHeap;
 
         VkDevice m_device;
         VkSurfaceKHR m_surface;
         VkQueue m_graphicsQueue;
         VkQueue m_presentQueue;
+        VkQueue m_computeQueue;
+        uint32_t m_graphicsFamily = 0;
+        uint32_t m_computeFamily = 0;
+        bool m_hasAsyncCompute = false;
+        bool m_pushDescriptorsSupported = false;
 
         const std::vector<const char*> m_validationLayers = { "VK_LAYER_KHRONOS_validation" };
         const std::vector<const char*> m_deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -7,11 +7,17 @@ namespace vke {
 		vkDestroySampler(m_device.device(), sampler, nullptr);
 
 		for (int i = 0; i < attachments.size(); i++) {
+			for (auto layerView : attachments[i].layerViews) {
+				vkDestroyImageView(m_device.device(), layerView, nullptr);
+			}
 			vkDestroyImageView(m_device.device(), attachments[i].view, nullptr);
 			vkDestroyImage(m_device.device(), attachments[i].image, nullptr);
 			vkFreeMemory(m_device.device(), attachments[i].memory, nullptr);
 		}
 
+		for (auto layerFramebuffer : layerFramebuffers) {
+			vkDestroyFramebuffer(m_device.device(), layerFramebuffer, nullptr);
+		}
 		vkDestroyFramebuffer(m_device.device(), framebuffer, nullptr);
 		vkDestroyRenderPass(m_device.device(), renderPass, nullptr);
 	}
@@ -80,6 +86,21 @@ namespace vke {
 			throw std::runtime_error("failed to create frame buffer image view!");
 		}
 
+		// Per layer views, so each layer (or group of multiview layers) can be a render target of its own
+		if (createinfo.layerCount > viewCount) {
+			assert(createinfo.layerCount % viewCount == 0 && "Layer count must be a multiple of the view count");
+			attachment.layerViews.resize(createinfo.layerCount / viewCount);
+			for (uint32_t layer = 0; layer < attachment.layerViews.size(); layer++) {
+				VkImageViewCreateInfo layerView = imageView;
+				layerView.viewType = (viewCount == 1) ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+				layerView.subresourceRange.baseArrayLayer = layer * viewCount;
+				layerView.subresourceRange.layerCount = viewCount;
+				if (vkCreateImageView(m_device.device(), &layerView, nullptr, &attachment.layerViews[layer]) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create frame buffer layer image view!");
+				}
+			}
+		}
+
 		// Fill attachment description
 		attachment.description = {};
 		attachment.description.samples = createinfo.imageSampleCount;
@@ -105,7 +126,7 @@ namespace vke {
 		return static_cast<uint32_t>(attachments.size() - 1);
 	}
 
-	VkResult VkeFrameBuffer::createSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode addressMode) {
+	VkResult VkeFrameBuffer::createSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode addressMode, VkBool32 compareEnable) {
 		VkSamplerCreateInfo samplerInfo{};
 		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 		samplerInfo.maxAnisotropy = 1.0f;
@@ -119,6 +140,8 @@ namespace vke {
 		samplerInfo.minLod = 0.0f;
 		samplerInfo.maxLod = 1.0f;
 		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		samplerInfo.compareEnable = compareEnable;
+		samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL; // Lit when the reference is no farther than the stored depth
 		return vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &sampler);
 	}
 
@@ -168,23 +191,40 @@ namespace vke {
 			subpass.pDepthStencilAttachment = &depthReference;
 		}
 
-		// Use subpass dependencies for attachment layout transitions
+		// Only order the attachment work and the layout transitions against attachment work around the pass. Reads
+		// and writes from other stages are synchronized by the render graph, whose barriers chain onto these
+		VkPipelineStageFlags attachmentStages = 0;
+		VkAccessFlags attachmentWrites = 0;
+		VkAccessFlags attachmentAccess = 0;
+		if (hasColor)
+		{
+			attachmentStages |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			attachmentWrites |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			attachmentAccess |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		}
+		if (hasDepth)
+		{
+			attachmentStages |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			attachmentWrites |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			attachmentAccess |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		}
+
 		std::array<VkSubpassDependency, 2> dependencies;
 
 		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
 		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[0].srcStageMask = attachmentStages;
+		dependencies[0].dstStageMask = attachmentStages;
+		dependencies[0].srcAccessMask = attachmentWrites;
+		dependencies[0].dstAccessMask = attachmentAccess;
 		dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
 		dependencies[1].srcSubpass = 0;
 		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		dependencies[1].srcStageMask = attachmentStages;
+		dependencies[1].dstStageMask = attachmentStages;
+		dependencies[1].srcAccessMask = attachmentWrites;
+		dependencies[1].dstAccessMask = 0;
 		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
 		// Create render pass
@@ -196,6 +236,18 @@ namespace vke {
 		renderPassInfo.pSubpasses = &subpass;
 		renderPassInfo.dependencyCount = 2;
 		renderPassInfo.pDependencies = dependencies.data();
+
+		// Every draw is broadcast to viewCount layers, gl_ViewIndex selects the view in shaders
+		uint32_t viewMask = (1u << viewCount) - 1;
+		VkRenderPassMultiviewCreateInfo multiviewInfo{};
+		multiviewInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+		multiviewInfo.subpassCount = 1;
+		multiviewInfo.pViewMasks = &viewMask;
+		multiviewInfo.correlationMaskCount = 1;
+		multiviewInfo.pCorrelationMasks = &viewMask;
+		if (viewCount > 1) {
+			renderPassInfo.pNext = &multiviewInfo;
+		}
 		if (vkCreateRenderPass(m_device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create frame buffer render pass!");
 		}
@@ -223,10 +275,29 @@ namespace vke {
 		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachmentViews.size());
 		framebufferInfo.width = width;
 		framebufferInfo.height = height;
-		framebufferInfo.layers = maxLayers;
+		framebufferInfo.layers = (viewCount > 1) ? 1 : maxLayers;
 		if (vkCreateFramebuffer(m_device.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create frame buffer!");
 		}
+
+		// One frame buffer per layer (or group of multiview layers), single layer attachments are shared between them
+		if (maxLayers > viewCount) {
+			layerFramebuffers.resize(maxLayers / viewCount);
+			for (uint32_t layer = 0; layer < layerFramebuffers.size(); layer++) {
+				std::vector<VkImageView> layerAttachmentViews;
+				for (auto& attachment : attachments)
+				{
+					layerAttachmentViews.push_back(attachment.layerViews.empty() ? attachment.view : attachment.layerViews[layer]);
+				}
+
+				VkFramebufferCreateInfo layerFramebufferInfo = framebufferInfo;
+				layerFramebufferInfo.pAttachments = layerAttachmentViews.data();
+				layerFramebufferInfo.layers = 1;
+				if (vkCreateFramebuffer(m_device.device(), &layerFramebufferInfo, nullptr, &layerFramebuffers[layer]) != VK_SUCCESS) {
+					throw std::runtime_error("failed to create frame buffer layer!");
+				}
+			}
+		}
 		
 		return VK_SUCCESS;
 	}
@@ -12,6 +12,7 @@ namespace vke {
 		VkImage image;
 		VkDeviceMemory memory;
 		VkImageView view;
+		std::vector<VkImageView> layerViews; // One view per group of viewCount layers of a layered attachment
 		VkFormat format;
 		VkImageSubresourceRange subReourceRange;
 		VkAttachmentDescription description;
@@ -64,13 +65,16 @@ namespace vke {
 		VkeFrameBuffer& operator=(const VkeFrameBuffer&&) = delete;
 
 		uint32_t width, height;
+		uint32_t viewCount = 1; // Multiview when > 1, every pass renders this many consecutive layers at once
 		VkFramebuffer framebuffer;
+		std::vector<VkFramebuffer> layerFramebuffers; // Render into one group of viewCount layers of the layered attachments
 		VkRenderPass renderPass;
-		VkSampler sampler;
+		VkSampler sampler = VK_NULL_HANDLE;
 		std::vector<FrameBufferAttachment> attachments;
 
 		uint32_t addAttachment(AttachmentCreateInfo createinfo);
-		VkResult createSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode adressMode);
+		// compareEnable makes it a depth comparison sampler for sampler2DShadow style lookups
+		VkResult createSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode adressMode, VkBool32 compareEnable = VK_FALSE);
 		VkResult createRenderPass();
 	private:
 		VkeDevice& m_device;
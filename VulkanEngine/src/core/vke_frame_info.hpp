@@ -3,6 +3,7 @@
 #include "../scene/components/vke_camera.hpp"
 #include "../scene/vke_game_object.hpp"
 #include "vke_core.hpp"
+#include "vke_render_packet.hpp"
 
 #include <array>
 
@@ -10,15 +11,22 @@
 #include <vulkan/vulkan.h>
 
 namespace vke {
-#define MAX_LIGHTS 10
+#define MAX_SHADOWED_POINT_LIGHTS 8
+#define POINT_SHADOW_FACES 6
+	// Point lights live in the light cluster storage buffer, w of position is the light range
 	struct PointLight {
 		glm::vec4 position{};
 		glm::vec4 color{};
+		int shadowIndex = -1; // Tile in the point shadow atlas, -1 when unshadowed
+		int padding[3];
 	};
 
+#define MAX_SHADOW_CASCADES 4
+	// One light space matrix per cascade, cascadeSplits holds the view depth where each cascade ends
 	struct DirectionalLight {
 		glm::vec4 position{};
-		glm::mat4 viewProjection{ 1.0f };
+		glm::mat4 viewProjection[MAX_SHADOW_CASCADES];
+		glm::vec4 cascadeSplits{};
 	};
 	
 	struct UniformBufferObject {
@@ -31,9 +39,11 @@ namespace vke {
 	struct UniformBufferScene {
 		glm::mat4 inverseView{ 1.0f };
 		glm::vec4 ambientLightColor{ 1.0f, 1.0f, 1.0f, 0.02f };
-		PointLight pointLights[MAX_LIGHTS];
 		DirectionalLight directionalLight;
+		glm::mat4 pointShadowMatrices[MAX_SHADOWED_POINT_LIGHTS * POINT_SHADOW_FACES]; // Cube faces +X -X +Y -Y +Z -Z per slot
+		glm::vec4 pointShadowTiles[MAX_SHADOWED_POINT_LIGHTS]; // Atlas uv offset in xy, scale in zw
 		int numLights;
+		int cascadeCount;
 	};
 
 	struct FrameInfo {
@@ -44,6 +54,9 @@ namespace vke {
 		// Scene
 		VkeCamera& camera;
 		std::vector<VkDescriptorSet> descriptorSets;
-		VkeGameObject::Map& gameObjects;
+		const RenderPacket& renderPacket;
+
+		// Transient sets for this frame's commands only, released wholesale when the frame slot comes around again
+		VkeDescriptorAllocator& frameDescriptorAllocator;
 	};
 }
\ No newline at end of file
@@ -1,35 +1,60 @@
 #include "vke_pipeline.hpp"
 
 // std
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
-#ifndef ENGINE_DIR
-#define ENGINE_DIR "../"
-#endif
 //
 namespace vke {
 	VkePipeline::VkePipeline(
 		VkeDevice& device, 
-		const std::string& vertFilePath, 
-		const std::string& fragFilePath, 
+		const std::string& vertShaderName, 
+		const std::string& fragShaderName, 
 		const PipelineConfigInfo& configInfo,
 		const bool emptyVertexInput) : m_device{ device } {
-		createGraphicsPipeline(vertFilePath, fragFilePath, configInfo, emptyVertexInput);
+		m_vertShaderModule = loadShaderModule(m_device, vertShaderName);
+		m_fragShaderModule = loadShaderModule(m_device, fragShaderName);
+		createGraphicsPipeline(m_vertShaderModule, m_fragShaderModule, configInfo, emptyVertexInput);
+	}
+
+	VkePipeline::VkePipeline(
+		VkeDevice& device,
+		const std::string& compShaderName,
+		VkPipelineLayout pipelineLayout) : m_device{ device }, m_bindPoint{ VK_PIPELINE_BIND_POINT_COMPUTE } {
+		m_compShaderModule = loadShaderModule(m_device, compShaderName);
+		createComputePipeline(m_compShaderModule, pipelineLayout);
+	}
+
+	VkePipeline::VkePipeline(
+		VkeDevice& device,
+		VkShaderModule vertShaderModule,
+		VkShaderModule fragShaderModule,
+		const PipelineConfigInfo& configInfo,
+		const bool emptyVertexInput) : m_device{ device } {
+		createGraphicsPipeline(vertShaderModule, fragShaderModule, configInfo, emptyVertexInput);
+	}
+
+	VkePipeline::VkePipeline(
+		VkeDevice& device,
+		VkShaderModule compShaderModule,
+		VkPipelineLayout pipelineLayout) : m_device{ device }, m_bindPoint{ VK_PIPELINE_BIND_POINT_COMPUTE } {
+		createComputePipeline(compShaderModule, pipelineLayout);
 	}
 
 	VkePipeline::~VkePipeline() {
 		vkDestroyShaderModule(m_device.device(), m_vertShaderModule, nullptr);
 		vkDestroyShaderModule(m_device.device(), m_fragShaderModule, nullptr);
-		vkDestroyPipeline(m_device.device(), m_graphicsPipeline, nullptr);
+		vkDestroyShaderModule(m_device.device(), m_compShaderModule, nullptr);
+		vkDestroyPipeline(m_device.device(), m_pipeline, nullptr);
 	}
 
 	void VkePipeline::bind(VkCommandBuffer commandBuffer) {
 		// Future note: Ray tracing in vk_pipeline is done here I believe
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+		vkCmdBindPipeline(commandBuffer, m_bindPoint, m_pipeline);
 	}
 	
-	void VkePipeline::createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo, const bool emptyVertexInput) {
+	void VkePipeline::createGraphicsPipeline(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, const PipelineConfigInfo& configInfo, const bool emptyVertexInput) {
 		assert(
 			configInfo.pipelineLayout != VK_NULL_HANDLE &&
 			"----- VKE PIPELINE ERROR ----- : Cannot create graphics pipeline: no pipelinelayout provided in configInfo");
@@ -38,27 +63,28 @@ namespace vke {
 			configInfo.renderPass != VK_NULL_HANDLE &&
 			"----- VKE PIPELINE ERROR ----- : Cannot create graphics pipeline: no renderpass provided in configInfo");
 
-		auto vertCode = readFile(vertFilepath);
-		auto fragCode = readFile(fragFilepath);
-
-		createShaderModule(vertCode, &m_vertShaderModule);
-		createShaderModule(fragCode, &m_fragShaderModule);
+		VkSpecializationInfo specializationInfo{};
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(configInfo.specializationEntries.size());
+		specializationInfo.pMapEntries = configInfo.specializationEntries.data();
+		specializationInfo.dataSize = configInfo.specializationData.size() * sizeof(uint32_t);
+		specializationInfo.pData = configInfo.specializationData.data();
+		const VkSpecializationInfo* stageSpecialization = configInfo.specializationEntries.empty() ? nullptr : &specializationInfo;
 
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		shaderStages[0].module = m_vertShaderModule;
+		shaderStages[0].module = vertShaderModule;
 		shaderStages[0].pName = "main";
 		shaderStages[0].flags = 0;
 		shaderStages[0].pNext = nullptr;
-		shaderStages[0].pSpecializationInfo = nullptr;
+		shaderStages[0].pSpecializationInfo = stageSpecialization;
 		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		shaderStages[1].module = m_fragShaderModule;
+		shaderStages[1].module = fragShaderModule;
 		shaderStages[1].pName = "main";
 		shaderStages[1].flags = 0;
 		shaderStages[1].pNext = nullptr;
-		shaderStages[1].pSpecializationInfo = nullptr;
+		shaderStages[1].pSpecializationInfo = stageSpecialization;
 
 		auto& bindingDescriptions = configInfo.bindingDescriptions;
 		auto& attributeDescriptions = configInfo.attributeDescriptions;
@@ -94,39 +120,62 @@ namespace vke {
 
 		if (vkCreateGraphicsPipelines(
 			m_device.device(),
-			VK_NULL_HANDLE,
+			m_device.pipelineCache(),
 			1,
 			&pipelineInfo,
 			nullptr,
-			&m_graphicsPipeline) != VK_SUCCESS) {
+			&m_pipeline) != VK_SUCCESS) {
 			throw std::runtime_error("----- VKE PIPELINE ERROR ----- : failed to create graphics pipeline");
 		}
 	}
-	
-	void VkePipeline::createShaderModule(const std::vector<char>& shaderCode, VkShaderModule* shaderModule) {
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = shaderCode.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
 
-		if (vkCreateShaderModule(m_device.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-			throw std::runtime_error("----- VKE PIPELINE ERROR ----- : failed to create shader module!");
+	void VkePipeline::createComputePipeline(VkShaderModule compShaderModule, VkPipelineLayout pipelineLayout) {
+		assert(
+			pipelineLayout != VK_NULL_HANDLE &&
+			"----- VKE PIPELINE ERROR ----- : Cannot create compute pipeline: no pipelinelayout provided");
+
+		VkPipelineShaderStageCreateInfo shaderStage{};
+		shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		shaderStage.module = compShaderModule;
+		shaderStage.pName = "main";
+		shaderStage.flags = 0;
+		shaderStage.pNext = nullptr;
+		shaderStage.pSpecializationInfo = nullptr;
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = shaderStage;
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(
+			m_device.device(),
+			m_device.pipelineCache(),
+			1,
+			&pipelineInfo,
+			nullptr,
+			&m_pipeline) != VK_SUCCESS) {
+			throw std::runtime_error("----- VKE PIPELINE ERROR ----- : failed to create compute pipeline");
 		}
 	}
+	
+	VkShaderModule VkePipeline::loadShaderModule(VkeDevice& device, const std::string& shaderName) {
+		return createShaderModule(device, loadShaderCode(shaderName));
+	}
 
-	std::vector<char> VkePipeline::readFile(const std::string& filePath) {
-		std::ifstream file(ENGINE_DIR + filePath, std::ios::ate | std::ios::binary);
+	VkShaderModule VkePipeline::createShaderModule(VkeDevice& device, const ShaderCode& shaderCode) {
+		VkShaderModuleCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = shaderCode.size;
+		createInfo.pCode = shaderCode.code;
 
-		if (!file.is_open()) {
-			throw std::runtime_error("----- VKE PIPELINE ERROR ----- : Failed to open file! File path: " + filePath);
+		VkShaderModule shaderModule;
+		if (vkCreateShaderModule(device.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+			throw std::runtime_error("----- VKE PIPELINE ERROR ----- : failed to create shader module!");
 		}
-		//
-		size_t fileSize = static_cast<size_t>(file.tellg());
-		std::vector<char> buffer(fileSize);
-
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
-		return buffer;
+		return shaderModule;
 	}
 
 	void VkePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
@@ -215,4 +264,46 @@ namespace vke {
 		configInfo.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
 		configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 	}
+
+	// Depth only passes (shadow, depth prepass) fetch nothing but the position from the interleaved vertex buffer
+	void VkePipeline::enablePositionOnlyInput(PipelineConfigInfo& configInfo) {
+		configInfo.attributeDescriptions.erase(
+			std::remove_if(
+				configInfo.attributeDescriptions.begin(),
+				configInfo.attributeDescriptions.end(),
+				[](const VkVertexInputAttributeDescription& attribute) { return attribute.location != 0; }),
+			configInfo.attributeDescriptions.end());
+	}
+
+	void VkePipeline::addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, uint32_t value) {
+		// Setting an id again overrides it, so a variant can start from shared defaults
+		for (auto& entry : configInfo.specializationEntries) {
+			if (entry.constantID == constantId) {
+				configInfo.specializationData[entry.offset / sizeof(uint32_t)] = value;
+				return;
+			}
+		}
+
+		VkSpecializationMapEntry entry{};
+		entry.constantID = constantId;
+		entry.offset = static_cast<uint32_t>(configInfo.specializationData.size() * sizeof(uint32_t));
+		entry.size = sizeof(uint32_t);
+		configInfo.specializationEntries.push_back(entry);
+		configInfo.specializationData.push_back(value);
+	}
+
+	void VkePipeline::addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, int32_t value) {
+		addSpecializationConstant(configInfo, constantId, static_cast<uint32_t>(value));
+	}
+
+	void VkePipeline::addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(float));
+		addSpecializationConstant(configInfo, constantId, bits);
+	}
+
+	void VkePipeline::addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, bool value) {
+		// GLSL bool constants are 32 bit VkBool32
+		addSpecializationConstant(configInfo, constantId, static_cast<uint32_t>(value ? VK_TRUE : VK_FALSE));
+	}
 }
\ No newline at end of file
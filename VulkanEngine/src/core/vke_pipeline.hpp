@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vke_device.hpp"
+#include "vke_shader_library.hpp"
 #include "../scene/components/vke_model.hpp"
 
 // std
@@ -30,16 +31,37 @@ namespace vke {
 		VkPipelineLayout pipelineLayout = nullptr;
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+
+		// Specialization constants, handed to every stage. Stages ignore ids they don't declare, the registry
+		// asserts that at least one stage declares each id. Part of the registry key, so each variant compiles once
+		std::vector<VkSpecializationMapEntry> specializationEntries;
+		std::vector<uint32_t> specializationData;
 	};
 
 	class VkePipeline {
 	public:
 		VkePipeline(
 			VkeDevice &device, 
-			const std::string& vertFilePath, 
-			const std::string& fragFilePath, 
+			const std::string& vertShaderName, 
+			const std::string& fragShaderName, 
 			const PipelineConfigInfo &configInfo,
 			const bool emptyVertexInput = false);
+		VkePipeline(
+			VkeDevice& device,
+			const std::string& compShaderName,
+			VkPipelineLayout pipelineLayout);
+
+		// Shader modules stay owned by the caller, used by VkePipelineRegistry to share them between pipelines
+		VkePipeline(
+			VkeDevice& device,
+			VkShaderModule vertShaderModule,
+			VkShaderModule fragShaderModule,
+			const PipelineConfigInfo& configInfo,
+			const bool emptyVertexInput = false);
+		VkePipeline(
+			VkeDevice& device,
+			VkShaderModule compShaderModule,
+			VkPipelineLayout pipelineLayout);
 		~VkePipeline();
 
 		VkePipeline(const VkePipeline&) = delete;
@@ -48,19 +70,30 @@ namespace vke {
 		void bind(VkCommandBuffer commandBuffer);
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 		static void enableAlphaBlending(PipelineConfigInfo& configInfo);
+		static void enablePositionOnlyInput(PipelineConfigInfo& configInfo);
+		// One overload per GLSL constant type: uint, int, float and bool
+		static void addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, uint32_t value);
+		static void addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, int32_t value);
+		static void addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, float value);
+		static void addSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantId, bool value);
+
+		// Shaders are named by their .spv file name, see loadShaderCode
+		static VkShaderModule loadShaderModule(VkeDevice& device, const std::string& shaderName);
+		static VkShaderModule createShaderModule(VkeDevice& device, const ShaderCode& shaderCode);
 		
 	private:
-		static std::vector<char> readFile(const std::string& filePath);
 		void createGraphicsPipeline(
-			const std::string& vertFilePath, 
-			const std::string& fragFilePath, 
+			VkShaderModule vertShaderModule,
+			VkShaderModule fragShaderModule,
 			const PipelineConfigInfo& pipelineConfigInfo,
 			const bool emptyVertexInput);
+		void createComputePipeline(VkShaderModule compShaderModule, VkPipelineLayout pipelineLayout);
 
-		void createShaderModule(const std::vector<char>& shaderCode, VkShaderModule* shaderModule);
 		VkeDevice& m_device;
-		VkPipeline m_graphicsPipeline;
-		VkShaderModule m_vertShaderModule;
-		VkShaderModule m_fragShaderModule;
+		VkPipeline m_pipeline;
+		VkPipelineBindPoint m_bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		VkShaderModule m_vertShaderModule = VK_NULL_HANDLE;
+		VkShaderModule m_fragShaderModule = VK_NULL_HANDLE;
+		VkShaderModule m_compShaderModule = VK_NULL_HANDLE; // Only set when the pipeline loaded its own modules
 	};
 }
\ No newline at end of file
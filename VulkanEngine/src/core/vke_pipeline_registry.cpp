@@ -0,0 +1,413 @@
+#include "vke_pipeline_registry.hpp"
+
+// std
+#include <algorithm>
+#include <map>
+
+namespace vke {
+    namespace {
+        template <typename T>
+        void appendKey(std::string& key, const T& value) {
+            key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+
+    void VkePipelineHandle::bind(VkCommandBuffer commandBuffer) {
+        if (!isReady() && m_fallback != nullptr && m_fallback->isReady()) {
+            m_fallback->bind(commandBuffer);
+            return;
+        }
+        wait();
+        m_pipeline->bind(commandBuffer);
+    }
+
+    void VkePipelineHandle::wait() {
+        if (!isReady()) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_readyCondition.wait(lock, [this]() { return isReady(); });
+        }
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    VkePipelineRegistry::VkePipelineRegistry(VkeDevice& device) : m_device{ device }, m_layoutCache{ device } {
+        // Leave a core for the render thread
+        uint32_t workerCount = std::clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1;
+        for (uint32_t i = 0; i < workerCount; i++) {
+            m_workers.emplace_back(&VkePipelineRegistry::workerLoop, this);
+        }
+    }
+
+    VkePipelineRegistry::~VkePipelineRegistry() {
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_stopping = true;
+        }
+        m_jobCondition.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+
+        m_pipelines.clear();
+        for (auto& [key, pipelineLayout] : m_pipelineLayouts) {
+            vkDestroyPipelineLayout(m_device.device(), pipelineLayout, nullptr);
+        }
+        for (auto& [name, shaderModule] : m_shaderModules) {
+            vkDestroyShaderModule(m_device.device(), shaderModule.module, nullptr);
+        }
+    }
+
+    PipelineHandle VkePipelineRegistry::requestGraphicsPipeline(
+        const std::string& vertShaderName,
+        const std::string& fragShaderName,
+        const PipelineConfigInfo& configInfo,
+        const bool emptyVertexInput,
+        PipelineHandle fallback) {
+        assert(
+            configInfo.pipelineLayout != VK_NULL_HANDLE &&
+            "----- VKE PIPELINE ERROR ----- : Cannot request graphics pipeline: no pipelinelayout provided in configInfo");
+        assert(
+            configInfo.renderPass != VK_NULL_HANDLE &&
+            "----- VKE PIPELINE ERROR ----- : Cannot request graphics pipeline: no renderpass provided in configInfo");
+
+        const ShaderModule& vertShader = getShaderModule(vertShaderName);
+        const ShaderModule& fragShader = getShaderModule(fragShaderName);
+        assert(
+            declaresSpecializationConstants(configInfo, { &vertShader.reflection, &fragShader.reflection }) &&
+            "----- VKE PIPELINE ERROR ----- : Specialization constant id not declared by either shader");
+        std::string key = hashKey(vertShader.hash, fragShader.hash, configInfo, emptyVertexInput);
+        auto cached = m_pipelines.find(key);
+        if (cached != m_pipelines.end()) {
+            return cached->second;
+        }
+
+        auto job = std::make_unique<PipelineJob>();
+        job->handle = std::make_shared<VkePipelineHandle>();
+        job->handle->m_fallback = fallback;
+        job->vertShaderModule = vertShader.module;
+        job->fragShaderModule = fragShader.module;
+        job->emptyVertexInput = emptyVertexInput;
+        copyConfigInfo(configInfo, *job);
+
+        PipelineHandle handle = job->handle;
+        m_pipelines.emplace(key, handle);
+        submit(std::move(job));
+        return handle;
+    }
+
+    PipelineHandle VkePipelineRegistry::requestComputePipeline(const std::string& compShaderName, VkPipelineLayout pipelineLayout) {
+        assert(
+            pipelineLayout != VK_NULL_HANDLE &&
+            "----- VKE PIPELINE ERROR ----- : Cannot request compute pipeline: no pipelinelayout provided");
+
+        const ShaderModule& compShader = getShaderModule(compShaderName);
+        std::string key;
+        appendKey(key, compShader.hash);
+        appendKey(key, pipelineLayout);
+        auto cached = m_pipelines.find(key);
+        if (cached != m_pipelines.end()) {
+            return cached->second;
+        }
+
+        auto job = std::make_unique<PipelineJob>();
+        job->handle = std::make_shared<VkePipelineHandle>();
+        job->compShaderModule = compShader.module;
+        job->pipelineLayout = pipelineLayout;
+
+        PipelineHandle handle = job->handle;
+        m_pipelines.emplace(key, handle);
+        submit(std::move(job));
+        return handle;
+    }
+
+    bool VkePipelineRegistry::declaresSpecializationConstants(const PipelineConfigInfo& configInfo, std::initializer_list<const ShaderReflection*> stages) {
+        for (auto& entry : configInfo.specializationEntries) {
+            bool declared = std::any_of(stages.begin(), stages.end(), [&entry](const ShaderReflection* stage) {
+                return std::binary_search(stage->specializationConstants.begin(), stage->specializationConstants.end(), entry.constantID);
+            });
+            if (!declared) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void VkePipelineRegistry::waitIdle() {
+        std::unique_lock<std::mutex> lock(m_jobMutex);
+        m_idleCondition.wait(lock, [this]() { return m_jobs.empty() && m_busyWorkers == 0; });
+    }
+
+    const VkePipelineRegistry::ShaderModule& VkePipelineRegistry::getShaderModule(const std::string& shaderName) {
+        auto cached = m_shaderModules.find(shaderName);
+        if (cached != m_shaderModules.end()) {
+            return cached->second;
+        }
+
+        ShaderCode shaderCode = loadShaderCode(shaderName);
+        ShaderModule shaderModule{ VkePipeline::createShaderModule(m_device, shaderCode), shaderCode.hash, reflectShader(shaderCode) };
+        return m_shaderModules.emplace(shaderName, std::move(shaderModule)).first->second;
+    }
+
+    std::shared_ptr<VkeDescriptorSetLayout> VkePipelineRegistry::getSetLayout(
+        const std::vector<std::string>& shaderNames,
+        uint32_t set,
+        VkDescriptorSetLayoutCreateFlags flags) {
+        std::map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+        for (auto& name : shaderNames) {
+            const ShaderReflection& reflection = getShaderModule(name).reflection;
+            for (auto& reflected : reflection.bindings) {
+                if (reflected.set != set) {
+                    continue;
+                }
+
+                auto [it, inserted] = bindings.try_emplace(reflected.binding);
+                VkDescriptorSetLayoutBinding& binding = it->second;
+                if (inserted) {
+                    binding.binding = reflected.binding;
+                    binding.descriptorType = reflected.type;
+                    binding.descriptorCount = reflected.count;
+                }
+                else if (binding.descriptorType != reflected.type || binding.descriptorCount != reflected.count) {
+                    throw std::runtime_error("----- VKE PIPELINE ERROR ----- : Shaders disagree on set " + std::to_string(set) +
+                        " binding " + std::to_string(reflected.binding) + ", see " + name);
+                }
+                binding.stageFlags |= reflection.stage;
+            }
+        }
+
+        VkeDescriptorSetLayout::Builder builder(m_device);
+        builder.setFlags(flags);
+        for (auto& [index, binding] : bindings) {
+            builder.addBinding(binding.binding, binding.descriptorType, binding.stageFlags, binding.descriptorCount);
+        }
+        return builder.buildCached(m_layoutCache);
+    }
+
+    PipelineLayoutInfo VkePipelineRegistry::getPipelineLayout(
+        const std::vector<std::string>& shaderNames,
+        const std::vector<VkDescriptorSetLayout>& setLayouts) {
+        PipelineLayoutInfo layoutInfo{};
+        uint32_t setCount = static_cast<uint32_t>(setLayouts.size());
+        for (auto& name : shaderNames) {
+            const ShaderReflection& reflection = getShaderModule(name).reflection;
+            for (auto& binding : reflection.bindings) {
+                setCount = std::max(setCount, binding.set + 1);
+            }
+            if (reflection.pushConstantSize > 0) {
+                layoutInfo.pushConstantRange.stageFlags |= reflection.stage;
+                layoutInfo.pushConstantRange.size = std::max(layoutInfo.pushConstantRange.size, reflection.pushConstantSize);
+            }
+        }
+
+        std::vector<VkDescriptorSetLayout> layouts = setLayouts;
+        for (uint32_t set = static_cast<uint32_t>(setLayouts.size()); set < setCount; set++) {
+            layouts.push_back(getSetLayout(shaderNames, set)->getDescriptorSetLayout());
+        }
+
+        std::string key;
+        for (VkDescriptorSetLayout layout : layouts) {
+            appendKey(key, layout);
+        }
+        appendKey(key, layoutInfo.pushConstantRange.stageFlags);
+        appendKey(key, layoutInfo.pushConstantRange.size);
+        auto cached = m_pipelineLayouts.find(key);
+        if (cached != m_pipelineLayouts.end()) {
+            layoutInfo.layout = cached->second;
+            return layoutInfo;
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
+        pipelineLayoutInfo.pSetLayouts = layouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = layoutInfo.pushConstantRange.size > 0 ? 1 : 0;
+        pipelineLayoutInfo.pPushConstantRanges = &layoutInfo.pushConstantRange;
+
+        if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &layoutInfo.layout) != VK_SUCCESS) {
+            throw std::runtime_error("----- VKE PIPELINE ERROR ----- : failed to create pipeline layout");
+        }
+        m_pipelineLayouts.emplace(key, layoutInfo.layout);
+        return layoutInfo;
+    }
+
+    // Every field createGraphicsPipeline reads, appended one by one so struct padding never reaches the key
+    std::string VkePipelineRegistry::hashKey(uint64_t vertHash, uint64_t fragHash, const PipelineConfigInfo& configInfo, bool emptyVertexInput) {
+        std::string key;
+        appendKey(key, vertHash);
+        appendKey(key, fragHash);
+        appendKey(key, emptyVertexInput);
+
+        if (!emptyVertexInput) {
+            appendKey(key, configInfo.bindingDescriptions.size());
+            for (auto& binding : configInfo.bindingDescriptions) {
+                appendKey(key, binding.binding);
+                appendKey(key, binding.stride);
+                appendKey(key, binding.inputRate);
+            }
+            appendKey(key, configInfo.attributeDescriptions.size());
+            for (auto& attribute : configInfo.attributeDescriptions) {
+                appendKey(key, attribute.location);
+                appendKey(key, attribute.binding);
+                appendKey(key, attribute.format);
+                appendKey(key, attribute.offset);
+            }
+        }
+
+        appendKey(key, configInfo.inputAssemblyInfo.topology);
+        appendKey(key, configInfo.inputAssemblyInfo.primitiveRestartEnable);
+        appendKey(key, configInfo.viewportInfo.viewportCount);
+        appendKey(key, configInfo.viewportInfo.scissorCount);
+
+        auto& raster = configInfo.rasterizationInfo;
+        appendKey(key, raster.depthClampEnable);
+        appendKey(key, raster.rasterizerDiscardEnable);
+        appendKey(key, raster.polygonMode);
+        appendKey(key, raster.cullMode);
+        appendKey(key, raster.frontFace);
+        appendKey(key, raster.depthBiasEnable);
+        appendKey(key, raster.depthBiasConstantFactor);
+        appendKey(key, raster.depthBiasClamp);
+        appendKey(key, raster.depthBiasSlopeFactor);
+        appendKey(key, raster.lineWidth);
+
+        appendKey(key, configInfo.multisampleInfo.rasterizationSamples);
+        appendKey(key, configInfo.multisampleInfo.sampleShadingEnable);
+        appendKey(key, configInfo.multisampleInfo.minSampleShading);
+        appendKey(key, configInfo.multisampleInfo.alphaToCoverageEnable);
+        appendKey(key, configInfo.multisampleInfo.alphaToOneEnable);
+
+        auto& blend = configInfo.colorBlendInfo;
+        appendKey(key, blend.logicOpEnable);
+        appendKey(key, blend.logicOp);
+        appendKey(key, blend.attachmentCount);
+        for (uint32_t i = 0; i < blend.attachmentCount; i++) {
+            auto& attachment = blend.pAttachments[i];
+            appendKey(key, attachment.blendEnable);
+            appendKey(key, attachment.srcColorBlendFactor);
+            appendKey(key, attachment.dstColorBlendFactor);
+            appendKey(key, attachment.colorBlendOp);
+            appendKey(key, attachment.srcAlphaBlendFactor);
+            appendKey(key, attachment.dstAlphaBlendFactor);
+            appendKey(key, attachment.alphaBlendOp);
+            appendKey(key, attachment.colorWriteMask);
+        }
+        appendKey(key, blend.blendConstants);
+
+        auto& depth = configInfo.depthStencilInfo;
+        appendKey(key, depth.depthTestEnable);
+        appendKey(key, depth.depthWriteEnable);
+        appendKey(key, depth.depthCompareOp);
+        appendKey(key, depth.depthBoundsTestEnable);
+        appendKey(key, depth.stencilTestEnable);
+        appendKey(key, depth.front);
+        appendKey(key, depth.back);
+        appendKey(key, depth.minDepthBounds);
+        appendKey(key, depth.maxDepthBounds);
+
+        appendKey(key, configInfo.dynamicStateInfo.dynamicStateCount);
+        for (uint32_t i = 0; i < configInfo.dynamicStateInfo.dynamicStateCount; i++) {
+            appendKey(key, configInfo.dynamicStateInfo.pDynamicStates[i]);
+        }
+
+        appendKey(key, configInfo.pipelineLayout);
+        appendKey(key, configInfo.renderPass);
+        appendKey(key, configInfo.subpass);
+
+        // Keyed by id and value, the order constants were added in doesn't make a new variant
+        std::map<uint32_t, uint32_t> constants;
+        for (auto& entry : configInfo.specializationEntries) {
+            constants[entry.constantID] = configInfo.specializationData[entry.offset / sizeof(uint32_t)];
+        }
+        appendKey(key, constants.size());
+        for (auto& [constantId, value] : constants) {
+            appendKey(key, constantId);
+            appendKey(key, value);
+        }
+        return key;
+    }
+
+    // PipelineConfigInfo isn't copyable since its create infos point into itself, rebuild those pointers for the copy
+    void VkePipelineRegistry::copyConfigInfo(const PipelineConfigInfo& source, PipelineJob& job) {
+        PipelineConfigInfo& config = job.configInfo;
+        config.bindingDescriptions = source.bindingDescriptions;
+        config.attributeDescriptions = source.attributeDescriptions;
+        config.viewportInfo = source.viewportInfo;
+        config.inputAssemblyInfo = source.inputAssemblyInfo;
+        config.rasterizationInfo = source.rasterizationInfo;
+        config.multisampleInfo = source.multisampleInfo;
+        config.colorBlendAttachment = source.colorBlendAttachment;
+        config.colorBlendInfo = source.colorBlendInfo;
+        config.depthStencilInfo = source.depthStencilInfo;
+        config.dynamicStateEnables.assign(
+            source.dynamicStateInfo.pDynamicStates,
+            source.dynamicStateInfo.pDynamicStates + source.dynamicStateInfo.dynamicStateCount);
+        config.dynamicStateInfo = source.dynamicStateInfo;
+        config.pipelineLayout = source.pipelineLayout;
+        config.renderPass = source.renderPass;
+        config.subpass = source.subpass;
+        config.specializationEntries = source.specializationEntries;
+        config.specializationData = source.specializationData;
+
+        job.blendAttachments.assign(
+            source.colorBlendInfo.pAttachments,
+            source.colorBlendInfo.pAttachments + source.colorBlendInfo.attachmentCount);
+        config.colorBlendInfo.pAttachments = job.blendAttachments.data();
+        config.dynamicStateInfo.pDynamicStates = config.dynamicStateEnables.data();
+    }
+
+    void VkePipelineRegistry::submit(std::unique_ptr<PipelineJob> job) {
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_jobCondition.notify_one();
+    }
+
+    void VkePipelineRegistry::workerLoop() {
+        while (true) {
+            std::unique_ptr<PipelineJob> job;
+            {
+                std::unique_lock<std::mutex> lock(m_jobMutex);
+                m_jobCondition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+                if (m_jobs.empty()) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+                m_busyWorkers++;
+            }
+
+            // The pipeline cache is internally synchronized, workers share it without locking
+            VkePipelineHandle& handle = *job->handle;
+            try {
+                if (job->compShaderModule != VK_NULL_HANDLE) {
+                    handle.m_pipeline = std::make_unique<VkePipeline>(m_device, job->compShaderModule, job->pipelineLayout);
+                }
+                else {
+                    handle.m_pipeline = std::make_unique<VkePipeline>(
+                        m_device,
+                        job->vertShaderModule,
+                        job->fragShaderModule,
+                        job->configInfo,
+                        job->emptyVertexInput);
+                }
+            }
+            catch (...) {
+                handle.m_error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(handle.m_mutex);
+                handle.m_ready.store(true, std::memory_order_release);
+            }
+            handle.m_readyCondition.notify_all();
+
+            {
+                std::lock_guard<std::mutex> lock(m_jobMutex);
+                m_busyWorkers--;
+            }
+            m_idleCondition.notify_all();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "vke_pipeline.hpp"
+#include "vke_descriptors.hpp"
+#include "vke_shader_reflection.hpp"
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vke {
+	// A pipeline that may still be compiling on a registry worker thread
+	class VkePipelineHandle {
+	public:
+		bool isReady() const { return m_ready.load(std::memory_order_acquire); }
+
+		// Binds the compiled pipeline, or the fallback while compiling. Without a ready fallback it waits for the compile
+		void bind(VkCommandBuffer commandBuffer);
+		void wait();
+
+	private:
+		friend class VkePipelineRegistry;
+
+		std::unique_ptr<VkePipeline> m_pipeline;
+		std::shared_ptr<VkePipelineHandle> m_fallback;
+		std::exception_ptr m_error;
+		std::atomic<bool> m_ready{ false };
+		std::mutex m_mutex;
+		std::condition_variable m_readyCondition;
+	};
+
+	using PipelineHandle = std::shared_ptr<VkePipelineHandle>;
+
+	// Pipeline layout derived from shader reflection, push constants form one range shared by every stage using them
+	struct PipelineLayoutInfo {
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		VkPushConstantRange pushConstantRange{};
+	};
+
+	// Owns every pipeline, shader module and reflected layout. Identical requests share one pipeline, identical shaders
+	// one module, identical bindings one layout, and new pipelines compile on worker threads against the device pipeline cache
+	class VkePipelineRegistry {
+	public:
+		VkePipelineRegistry(VkeDevice& device);
+		~VkePipelineRegistry();
+
+		VkePipelineRegistry(const VkePipelineRegistry&) = delete;
+		VkePipelineRegistry& operator=(const VkePipelineRegistry&) = delete;
+
+		// The config is copied before returning, so it may point at stack arrays. The fallback is bound until the
+		// pipeline is ready and must be compatible with the same render pass and layout
+		PipelineHandle requestGraphicsPipeline(
+			const std::string& vertShaderName,
+			const std::string& fragShaderName,
+			const PipelineConfigInfo& configInfo,
+			const bool emptyVertexInput = false,
+			PipelineHandle fallback = nullptr);
+		PipelineHandle requestComputePipeline(const std::string& compShaderName, VkPipelineLayout pipelineLayout);
+
+		// Union of the set's bindings across the shaders, stage flags included. Throws when two shaders disagree on a binding
+		std::shared_ptr<VkeDescriptorSetLayout> getSetLayout(
+			const std::vector<std::string>& shaderNames,
+			uint32_t set,
+			VkDescriptorSetLayoutCreateFlags flags = 0);
+
+		// Shared by reflected layouts and hand built ones, see VkeDescriptorSetLayout::Builder::buildCached
+		VkeDescriptorLayoutCache& layoutCache() { return m_layoutCache; }
+
+		// Leading sets use the given layouts (shared engine sets), later sets the shaders use are reflected
+		PipelineLayoutInfo getPipelineLayout(
+			const std::vector<std::string>& shaderNames,
+			const std::vector<VkDescriptorSetLayout>& setLayouts = {});
+
+		// Blocks until every queued pipeline has compiled, call before destroying layouts or render passes still in use by a request
+		void waitIdle();
+
+	private:
+		struct PipelineJob {
+			PipelineHandle handle;
+			VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+			VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+			VkShaderModule compShaderModule = VK_NULL_HANDLE;
+			PipelineConfigInfo configInfo;
+			std::vector<VkPipelineColorBlendAttachmentState> blendAttachments; // Backs configInfo.colorBlendInfo.pAttachments
+			VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+			bool emptyVertexInput = false;
+		};
+
+		struct ShaderModule {
+			VkShaderModule module;
+			uint64_t hash; // SPIR-V content, pipelines are keyed by what the shader is rather than its name
+			ShaderReflection reflection;
+		};
+
+		const ShaderModule& getShaderModule(const std::string& shaderName);
+		static bool declaresSpecializationConstants(const PipelineConfigInfo& configInfo, std::initializer_list<const ShaderReflection*> stages);
+		static std::string hashKey(uint64_t vertHash, uint64_t fragHash, const PipelineConfigInfo& configInfo, bool emptyVertexInput);
+		static void copyConfigInfo(const PipelineConfigInfo& source, PipelineJob& job);
+		void submit(std::unique_ptr<PipelineJob> job);
+		void workerLoop();
+
+		VkeDevice& m_device;
+		VkeDescriptorLayoutCache m_layoutCache;
+
+		// Only touched by the thread making requests
+		std::unordered_map<std::string, ShaderModule> m_shaderModules;
+		std::unordered_map<std::string, PipelineHandle> m_pipelines;
+		std::unordered_map<std::string, VkPipelineLayout> m_pipelineLayouts;
+
+		std::vector<std::thread> m_workers;
+		std::deque<std::unique_ptr<PipelineJob>> m_jobs;
+		std::mutex m_jobMutex;
+		std::condition_variable m_jobCondition;
+		std::condition_variable m_idleCondition;
+		uint32_t m_busyWorkers = 0;
+		bool m_stopping = false;
+	};
+}
\ No newline at end of file
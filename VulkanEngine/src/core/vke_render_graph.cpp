@@ -0,0 +1,583 @@
+#include "vke_render_graph.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace vke {
+    static const VkAccessFlags WRITE_ACCESS_MASK =
+        VK_ACCESS_SHADER_WRITE_BIT |
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_TRANSFER_WRITE_BIT |
+        VK_ACCESS_HOST_WRITE_BIT |
+        VK_ACCESS_MEMORY_WRITE_BIT;
+
+    namespace {
+        template <typename T>
+        void appendKey(std::string& key, const T& value) {
+            key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+
+    // *************** Pass Builder *********************
+
+    VkeRenderGraph::PassBuilder& VkeRenderGraph::PassBuilder::read(RenderResource resource, const ResourceUsage& usage) {
+        m_accesses.push_back({ resource, usage, false });
+        return *this;
+    }
+
+    VkeRenderGraph::PassBuilder& VkeRenderGraph::PassBuilder::write(RenderResource resource, const ResourceUsage& usage) {
+        assert((usage.access & WRITE_ACCESS_MASK) != 0 && "Write usage needs a write access");
+        m_accesses.push_back({ resource, usage, true });
+        return *this;
+    }
+
+    // *************** Render Graph *********************
+
+    VkeRenderGraph::VkeRenderGraph(VkeDevice& device) : m_device{ device } { }
+
+    VkeRenderGraph::~VkeRenderGraph() {
+        // The owner waits for the device before destroying the graph
+        retireTransients(0);
+        for (RetiredTransients& retired : m_retiredTransients) {
+            destroyRetired(retired);
+        }
+    }
+
+    RenderResource VkeRenderGraph::importImage(const std::string& name, VkImage image, const VkImageSubresourceRange& range, VkImageLayout initialLayout) {
+        Resource& resource = m_resources.emplace_back();
+        resource.name = name;
+        resource.type = ResourceType::ImportedImage;
+        resource.image = image;
+        resource.range = range;
+        resource.state.layout = initialLayout;
+        return static_cast<RenderResource>(m_resources.size() - 1);
+    }
+
+    void VkeRenderGraph::replaceImage(RenderResource resource, VkImage image, const VkImageSubresourceRange& range, VkImageLayout initialLayout) {
+        assert(resource < m_resources.size() && m_resources[resource].type == ResourceType::ImportedImage && "Only imported images can be replaced");
+        Resource& imported = m_resources[resource];
+        imported.image = image;
+        imported.range = range;
+        imported.state = ResourceState{};
+        imported.state.layout = initialLayout;
+    }
+
+    RenderResource VkeRenderGraph::importBuffer(const std::string& name, bool perFrame) {
+        Resource& resource = m_resources.emplace_back();
+        resource.name = name;
+        resource.type = ResourceType::Buffer;
+        resource.perFrame = perFrame;
+        return static_cast<RenderResource>(m_resources.size() - 1);
+    }
+
+    RenderResource VkeRenderGraph::createImage(const std::string& name, const TransientImageInfo& info) {
+        Resource& resource = m_resources.emplace_back();
+        resource.name = name;
+        resource.type = ResourceType::TransientImage;
+        resource.transientInfo = info;
+        resource.range = { info.aspectMask, 0, 1, 0, info.layerCount };
+        m_compiled = false;
+        return static_cast<RenderResource>(m_resources.size() - 1);
+    }
+
+    void VkeRenderGraph::setImageInfo(RenderResource resource, const TransientImageInfo& info) {
+        assert(resource < m_resources.size() && m_resources[resource].type == ResourceType::TransientImage && "Only transient images have an info");
+        Resource& transient = m_resources[resource];
+        transient.transientInfo = info;
+        transient.range = { info.aspectMask, 0, 1, 0, info.layerCount };
+        m_compiled = false;
+    }
+
+    VkImage VkeRenderGraph::getImage(RenderResource resource) const {
+        assert(resource < m_resources.size() && "Unknown render graph resource");
+        return m_resources[resource].image;
+    }
+
+    VkImageView VkeRenderGraph::getImageView(RenderResource resource) const {
+        assert(resource < m_resources.size() && "Unknown render graph resource");
+        return m_resources[resource].view;
+    }
+
+    VkeRenderGraph::PassBuilder& VkeRenderGraph::addPass(const std::string& name) {
+        m_compiled = false;
+        PassBuilder& pass = m_passes.emplace_back();
+        pass.m_name = name;
+        return pass;
+    }
+
+    void VkeRenderGraph::clearPasses() {
+        m_passes.clear();
+        m_compiled = false;
+    }
+
+    bool VkeRenderGraph::isCulled(const std::string& passName) const {
+        for (const PassBuilder& pass : m_passes) {
+            if (pass.m_name == passName)
+                return pass.m_culled;
+        }
+        return true;
+    }
+
+    void VkeRenderGraph::compile(uint64_t lastFrame) {
+        cullPasses();
+        scheduleAsync();
+        computeLifetimes();
+        allocateTransients(lastFrame);
+        m_compiled = true;
+    }
+
+    void VkeRenderGraph::releaseRetired(uint64_t completedFrame) {
+        auto released = std::partition(m_retiredTransients.begin(), m_retiredTransients.end(), [completedFrame](const RetiredTransients& retired) {
+            return retired.lastFrame > completedFrame;
+        });
+        for (auto retired = released; retired != m_retiredTransients.end(); retired++) {
+            destroyRetired(*retired);
+        }
+        m_retiredTransients.erase(released, m_retiredTransients.end());
+    }
+
+    void VkeRenderGraph::cullPasses() {
+        // Walk back from the outputs, a pass survives when a surviving pass after it reads something it writes
+        std::vector<bool> needed(m_resources.size(), false);
+        for (size_t i = m_passes.size(); i-- > 0;) {
+            PassBuilder& pass = m_passes[i];
+            bool live = pass.m_output;
+            for (const Access& access : pass.m_accesses) {
+                assert(access.resource < m_resources.size() && "Pass uses an unknown render graph resource");
+                live |= access.write && needed[access.resource];
+            }
+
+            pass.m_culled = !live;
+            if (!live)
+                continue;
+
+            // Its writes satisfy the later reads, earlier writers are only needed if this pass reads the resource too
+            for (const Access& access : pass.m_accesses) {
+                if (access.write) {
+                    needed[access.resource] = false;
+                }
+            }
+            for (const Access& access : pass.m_accesses) {
+                if (!access.write) {
+                    needed[access.resource] = true;
+                }
+            }
+        }
+    }
+
+    void VkeRenderGraph::computeLifetimes() {
+        for (Resource& resource : m_resources) {
+            resource.firstPass = UINT32_MAX;
+            resource.lastPass = 0;
+        }
+
+        for (uint32_t i = 0; i < m_passes.size(); i++) {
+            if (m_passes[i].m_culled)
+                continue;
+
+            for (const Access& access : m_passes[i].m_accesses) {
+                Resource& resource = m_resources[access.resource];
+                resource.firstPass = std::min(resource.firstPass, i);
+                resource.lastPass = std::max(resource.lastPass, i);
+            }
+        }
+    }
+
+    std::vector<RenderResource> VkeRenderGraph::liveTransients() const {
+        std::vector<RenderResource> transients;
+        for (RenderResource i = 0; i < m_resources.size(); i++) {
+            if (m_resources[i].type == ResourceType::TransientImage && m_resources[i].firstPass != UINT32_MAX) {
+                transients.push_back(i);
+            }
+        }
+        std::stable_sort(transients.begin(), transients.end(), [this](RenderResource a, RenderResource b) {
+            return m_resources[a].firstPass < m_resources[b].firstPass;
+        });
+        return transients;
+    }
+
+    void VkeRenderGraph::allocateTransients(uint64_t lastFrame) {
+        std::vector<RenderResource> transients = liveTransients();
+
+        // Most recompiles only toggle passes that don't touch a transient, the placement would come out the same
+        std::string key;
+        for (RenderResource index : transients) {
+            const Resource& resource = m_resources[index];
+            appendKey(key, index);
+            appendKey(key, resource.firstPass);
+            appendKey(key, resource.lastPass);
+            appendKey(key, resource.transientInfo.format);
+            appendKey(key, resource.transientInfo.extent);
+            appendKey(key, resource.transientInfo.layerCount);
+            appendKey(key, resource.transientInfo.usage);
+            appendKey(key, resource.transientInfo.aspectMask);
+        }
+        if (key == m_transientKey)
+            return;
+
+        retireTransients(lastFrame);
+        m_transientKey = key;
+
+        // Greedy first fit, every image is bound at offset 0 of its block so alignment never comes into it
+        for (RenderResource index : transients) {
+            Resource& resource = m_resources[index];
+            const TransientImageInfo& info = resource.transientInfo;
+
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = info.format;
+            imageInfo.extent = { info.extent.width, info.extent.height, 1 };
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = info.layerCount;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = info.usage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (vkCreateImage(m_device.device(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image!");
+            }
+
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(m_device.device(), resource.image, &requirements);
+
+            uint32_t blockIndex = UINT32_MAX;
+            for (uint32_t i = 0; i < m_memoryBlocks.size(); i++) {
+                const MemoryBlock& block = m_memoryBlocks[i];
+                if (block.lastPass < resource.firstPass && (block.memoryTypeBits & requirements.memoryTypeBits) != 0) {
+                    blockIndex = i;
+                    break;
+                }
+            }
+            if (blockIndex == UINT32_MAX) {
+                blockIndex = static_cast<uint32_t>(m_memoryBlocks.size());
+                m_memoryBlocks.emplace_back();
+            }
+
+            MemoryBlock& block = m_memoryBlocks[blockIndex];
+            block.size = std::max(block.size, requirements.size);
+            block.memoryTypeBits &= requirements.memoryTypeBits;
+            block.lastPass = resource.lastPass;
+            resource.memoryBlock = blockIndex;
+            resource.aliasPredecessor = block.lastOccupant;
+            resource.state = ResourceState{};
+            block.lastOccupant = index;
+        }
+
+        // The first occupant of a block follows the last one of the previous frame
+        for (RenderResource index : transients) {
+            Resource& resource = m_resources[index];
+            if (resource.aliasPredecessor == RENDER_GRAPH_INVALID_RESOURCE) {
+                RenderResource last = m_memoryBlocks[resource.memoryBlock].lastOccupant;
+                resource.aliasPredecessor = (last != index) ? last : RENDER_GRAPH_INVALID_RESOURCE;
+            }
+        }
+
+        for (MemoryBlock& block : m_memoryBlocks) {
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = block.size;
+            allocInfo.memoryTypeIndex = m_device.findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (vkAllocateMemory(m_device.device(), &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate render graph memory!");
+            }
+        }
+
+        for (RenderResource index : transients) {
+            Resource& resource = m_resources[index];
+            if (vkBindImageMemory(m_device.device(), resource.image, m_memoryBlocks[resource.memoryBlock].memory, 0) != VK_SUCCESS) {
+                throw std::runtime_error("failed to bind render graph image memory!");
+            }
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.image;
+            viewInfo.viewType = (resource.range.layerCount == 1) ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+            viewInfo.format = resource.transientInfo.format;
+            viewInfo.subresourceRange = resource.range;
+            if (vkCreateImageView(m_device.device(), &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image view!");
+            }
+        }
+
+#ifndef NDEBUG
+        validateAliasing();
+#endif
+    }
+
+    void VkeRenderGraph::validateAliasing() const {
+        std::vector<RenderResource> transients = liveTransients();
+        for (size_t i = 0; i < transients.size(); i++) {
+            const Resource& resource = m_resources[transients[i]];
+            const MemoryBlock& block = m_memoryBlocks[resource.memoryBlock];
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(m_device.device(), resource.image, &requirements);
+            assert(requirements.size <= block.size && (requirements.memoryTypeBits & block.memoryTypeBits) != 0 &&
+                "Transient doesn't fit its memory block");
+
+            // Placed in order, the latest earlier occupant of a block is the one it had when this transient was placed
+            std::vector<uint32_t> blockLastPass(m_memoryBlocks.size(), UINT32_MAX);
+            for (size_t j = 0; j < i; j++) {
+                const Resource& earlier = m_resources[transients[j]];
+                assert((earlier.memoryBlock != resource.memoryBlock || earlier.lastPass < resource.firstPass) &&
+                    "Transients sharing memory have overlapping lifetimes");
+                blockLastPass[earlier.memoryBlock] = earlier.lastPass;
+            }
+
+            // Opening a block is only right when every block the image could live in was still in use
+            if (blockLastPass[resource.memoryBlock] != UINT32_MAX)
+                continue;
+            for (uint32_t other = 0; other < resource.memoryBlock; other++) {
+                bool compatible = (m_memoryBlocks[other].memoryTypeBits & requirements.memoryTypeBits) != 0;
+                assert((!compatible || blockLastPass[other] >= resource.firstPass) && "Transient skipped a free memory block");
+            }
+        }
+    }
+
+    void VkeRenderGraph::retireTransients(uint64_t lastFrame) {
+        RetiredTransients retired{};
+        retired.lastFrame = lastFrame;
+        for (Resource& resource : m_resources) {
+            if (resource.type != ResourceType::TransientImage || resource.image == VK_NULL_HANDLE)
+                continue;
+
+            retired.views.push_back(resource.view);
+            retired.images.push_back(resource.image);
+            resource.view = VK_NULL_HANDLE;
+            resource.image = VK_NULL_HANDLE;
+            resource.memoryBlock = UINT32_MAX;
+            resource.aliasPredecessor = RENDER_GRAPH_INVALID_RESOURCE;
+        }
+
+        for (MemoryBlock& block : m_memoryBlocks) {
+            retired.memory.push_back(block.memory);
+        }
+        m_memoryBlocks.clear();
+        m_transientKey.clear();
+
+        if (!retired.images.empty()) {
+            m_retiredTransients.push_back(std::move(retired));
+        }
+    }
+
+    void VkeRenderGraph::destroyRetired(RetiredTransients& retired) {
+        for (VkImageView view : retired.views) {
+            vkDestroyImageView(m_device.device(), view, nullptr);
+        }
+        for (VkImage image : retired.images) {
+            vkDestroyImage(m_device.device(), image, nullptr);
+        }
+        for (VkDeviceMemory memory : retired.memory) {
+            vkFreeMemory(m_device.device(), memory, nullptr);
+        }
+    }
+
+    void VkeRenderGraph::scheduleAsync() {
+        m_asyncWork = false;
+        m_asyncWaitStages = 0;
+        m_splitPass = UINT32_MAX;
+
+        std::vector<bool> graphicsUsed(m_resources.size(), false);
+        std::vector<bool> asyncWritten(m_resources.size(), false);
+        for (uint32_t i = 0; i < m_passes.size(); i++) {
+            const PassBuilder& pass = m_passes[i];
+            if (pass.m_culled)
+                continue;
+
+            if (pass.m_async) {
+                for (const Access& access : pass.m_accesses) {
+                    const Resource& resource = m_resources[access.resource];
+                    assert(resource.type == ResourceType::Buffer && resource.perFrame && "Async compute passes may only use per frame buffers");
+                    assert(!graphicsUsed[access.resource] && "Async compute passes can't depend on graphics work of the same frame");
+                    asyncWritten[access.resource] = asyncWritten[access.resource] || access.write;
+                }
+                m_asyncWork = m_asyncWork || m_device.hasAsyncCompute();
+                continue;
+            }
+
+            for (const Access& access : pass.m_accesses) {
+                graphicsUsed[access.resource] = true;
+                if (!asyncWritten[access.resource])
+                    continue;
+
+                m_asyncWaitStages |= access.usage.stages;
+                m_splitPass = std::min(m_splitPass, i);
+            }
+        }
+
+        // Without a consumer nothing waits for the async work and every graphics pass stays in the main batch
+        if (!m_asyncWork || m_splitPass == UINT32_MAX) {
+            m_asyncWaitStages = 0;
+            m_splitPass = 0;
+        }
+    }
+
+    void VkeRenderGraph::execute(FrameInfo& frameInfo) {
+        GraphCommandBuffers commandBuffers{};
+        commandBuffers.graphics = frameInfo.commandBuffer;
+        execute(frameInfo, commandBuffers);
+    }
+
+    void VkeRenderGraph::execute(FrameInfo& frameInfo, const GraphCommandBuffers& commandBuffers) {
+        assert(m_compiled && "Render graph must be compiled before it is executed");
+        assert((!m_asyncWork || commandBuffers.compute != VK_NULL_HANDLE) && "Async compute passes need a compute command buffer");
+
+        for (Resource& resource : m_resources) {
+            if (resource.type == ResourceType::Buffer && resource.perFrame) {
+                resource.state = ResourceState{};
+            }
+            else if (resource.type == ResourceType::TransientImage) {
+                // Contents never survive a frame, the stages still order against last frame's use of the memory
+                resource.state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+        }
+
+        for (uint32_t i = 0; i < m_passes.size(); i++) {
+            PassBuilder& pass = m_passes[i];
+            if (pass.m_culled)
+                continue;
+
+            bool async = m_asyncWork && pass.m_async;
+            VkCommandBuffer commandBuffer = commandBuffers.graphics;
+            if (async) {
+                commandBuffer = commandBuffers.compute;
+            }
+            else if (commandBuffers.early != VK_NULL_HANDLE && i < m_splitPass) {
+                commandBuffer = commandBuffers.early;
+            }
+
+            recordBarriers(commandBuffer, i);
+            frameInfo.commandBuffer = commandBuffer;
+            if (pass.m_callback) {
+                pass.m_callback(frameInfo);
+            }
+
+            // The graphics submission's semaphore wait makes the writes visible, no barrier is left to record
+            if (async) {
+                for (const Access& access : pass.m_accesses) {
+                    if (access.write) {
+                        m_resources[access.resource].state = ResourceState{};
+                    }
+                }
+            }
+        }
+        frameInfo.commandBuffer = commandBuffers.graphics;
+    }
+
+    void VkeRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, uint32_t passIndex) {
+        // One entry per resource, a read and a write of the same resource in one pass share a layout
+        m_mergedAccesses.clear();
+        for (const Access& access : m_passes[passIndex].m_accesses) {
+            auto merged = std::find_if(m_mergedAccesses.begin(), m_mergedAccesses.end(), [&](const Access& other) {
+                return other.resource == access.resource;
+            });
+            if (merged == m_mergedAccesses.end()) {
+                m_mergedAccesses.push_back(access);
+                continue;
+            }
+
+            assert(merged->usage.layout == access.usage.layout && "A pass must use one layout per image");
+            merged->usage.stages |= access.usage.stages;
+            merged->usage.access |= access.usage.access;
+            merged->write |= access.write;
+        }
+
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkMemoryBarrier memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        m_imageBarriers.clear();
+
+        for (const Access& access : m_mergedAccesses) {
+            Resource& resource = m_resources[access.resource];
+            ResourceState& state = resource.state;
+            const ResourceUsage& usage = access.usage;
+            bool isImage = resource.type != ResourceType::Buffer;
+            bool layoutChange = isImage && state.layout != usage.layout;
+
+            VkPipelineStageFlags waitStages = 0;
+            VkAccessFlags waitAccess = 0;
+
+            // Read or write after write, skipped for readers the write is already visible to
+            if (state.writeStages != 0 && (access.write || layoutChange || (usage.stages & ~state.visibleStages) != 0)) {
+                waitStages |= state.writeStages;
+                waitAccess |= state.writeAccess;
+            }
+
+            // Write after read only needs execution ordering, a layout transition counts as a write
+            if (access.write || layoutChange) {
+                waitStages |= state.readStages;
+            }
+
+            // The aliased memory was last used by another transient
+            if (resource.type == ResourceType::TransientImage && passIndex == resource.firstPass &&
+                resource.aliasPredecessor != RENDER_GRAPH_INVALID_RESOURCE) {
+                const ResourceState& previous = m_resources[resource.aliasPredecessor].state;
+                waitStages |= previous.writeStages | previous.readStages;
+                waitAccess |= previous.writeAccess;
+            }
+
+            bool barrier = waitStages != 0 || layoutChange;
+            if (layoutChange) {
+                VkImageMemoryBarrier imageBarrier{};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.srcAccessMask = waitAccess;
+                imageBarrier.dstAccessMask = usage.access;
+                imageBarrier.oldLayout = state.layout;
+                imageBarrier.newLayout = usage.layout;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = resource.image;
+                imageBarrier.subresourceRange = resource.range;
+                m_imageBarriers.push_back(imageBarrier);
+            }
+            else if (waitStages != 0) {
+                memoryBarrier.srcAccessMask |= waitAccess;
+                memoryBarrier.dstAccessMask |= usage.access;
+            }
+
+            if (barrier) {
+                srcStages |= waitStages;
+                dstStages |= usage.stages;
+            }
+
+            if (access.write) {
+                state.writeStages = usage.stages;
+                state.writeAccess = usage.access & WRITE_ACCESS_MASK;
+                state.readStages = 0;
+                state.visibleStages = 0;
+            }
+            else if (layoutChange) {
+                // Later readers chain onto the stages the transition was made visible to
+                state.writeStages = usage.stages;
+                state.writeAccess = 0;
+                state.readStages = usage.stages;
+                state.visibleStages = usage.stages;
+            }
+            else {
+                state.readStages |= usage.stages;
+                if (barrier) {
+                    state.visibleStages |= usage.stages;
+                }
+            }
+            state.layout = isImage ? usage.layout : state.layout;
+        }
+
+        if (dstStages == 0)
+            return;
+
+        bool hasMemoryBarrier = memoryBarrier.srcAccessMask != 0 || memoryBarrier.dstAccessMask != 0;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+            dstStages,
+            0,
+            hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &memoryBarrier : nullptr,
+            0, nullptr,
+            static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "vke_device.hpp"
+#include "vke_frame_info.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define RENDER_GRAPH_INVALID_RESOURCE UINT32_MAX
+
+namespace vke {
+	using RenderResource = uint32_t;
+
+	// How a pass touches a resource. Images are expected in layout when the pass starts and must be left in it,
+	// a pass may change layouts internally as long as it restores the declared one
+	struct ResourceUsage {
+		VkPipelineStageFlags stages = 0;
+		VkAccessFlags access = 0;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	// Graph owned image, its memory is shared with other transients whose lifetimes don't overlap
+	struct TransientImageInfo {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+		uint32_t layerCount = 1;
+		VkImageUsageFlags usage = 0;
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	};
+
+	// Where one execution records. Without a compute command buffer async passes run on graphics, without an early
+	// one every graphics pass goes into the graphics command buffer
+	struct GraphCommandBuffers {
+		VkCommandBuffer early = VK_NULL_HANDLE;		// Graphics passes before the first consumer of async results, mustn't touch the swap chain image
+		VkCommandBuffer graphics = VK_NULL_HANDLE;
+		VkCommandBuffer compute = VK_NULL_HANDLE;
+	};
+
+	// Passes declare what they read and write, compile() culls the passes nothing depends on and execute()
+	// records the survivors in declaration order with one batched pipeline barrier in front of each
+	class VkeRenderGraph {
+	private:
+		struct Access {
+			RenderResource resource;
+			ResourceUsage usage;
+			bool write;
+		};
+
+	public:
+		class PassBuilder {
+		public:
+			PassBuilder& read(RenderResource resource, const ResourceUsage& usage);
+			PassBuilder& write(RenderResource resource, const ResourceUsage& usage);
+
+			// Never culled, e.g. the pass that renders to the swap chain
+			PassBuilder& markOutput() { m_output = true; return *this; }
+			// Runs on the async compute queue when the device has one. Limited to per frame buffers no graphics pass
+			// touches before it, the consumers then only need the semaphore wait instead of ownership transfers
+			PassBuilder& asyncCompute() { m_async = true; return *this; }
+			PassBuilder& execute(std::function<void(FrameInfo&)> callback) { m_callback = std::move(callback); return *this; }
+
+		private:
+			friend class VkeRenderGraph;
+
+			std::string m_name;
+			std::vector<Access> m_accesses;
+			std::function<void(FrameInfo&)> m_callback;
+			bool m_output = false;
+			bool m_async = false;
+			bool m_culled = false;
+		};
+
+		VkeRenderGraph(VkeDevice& device);
+		~VkeRenderGraph();
+
+		VkeRenderGraph(const VkeRenderGraph&) = delete;
+		VkeRenderGraph& operator=(const VkeRenderGraph&) = delete;
+
+		// Imported images keep their tracked state across executions, hazards with the previous frame are covered
+		RenderResource importImage(const std::string& name, VkImage image, const VkImageSubresourceRange& range,
+			VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+		// Points an imported image at a recreated one, e.g. after a swap chain resize. Its tracked state restarts
+		void replaceImage(RenderResource resource, VkImage image, const VkImageSubresourceRange& range,
+			VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+		// Synchronized with global memory barriers. Per frame buffers start every execution without history
+		RenderResource importBuffer(const std::string& name, bool perFrame);
+		RenderResource createImage(const std::string& name, const TransientImageInfo& info);
+		// E.g. a new extent after a swap chain resize, the next compile() reallocates
+		void setImageInfo(RenderResource resource, const TransientImageInfo& info);
+
+		// Transients are only backed by memory after compile(), and only while a surviving pass uses them. Their
+		// handles stay the same across compiles that leave every transient's info and lifetime unchanged
+		VkImage getImage(RenderResource resource) const;
+		VkImageView getImageView(RenderResource resource) const;
+
+		// The returned builder is only valid until the next addPass
+		PassBuilder& addPass(const std::string& name);
+
+		// Drops every pass, resources and their tracked state stay. Call compile() again before executing
+		void clearPasses();
+		// lastFrame is the newest frame number that may still use the current transients. When compile() has to
+		// reallocate them the old ones are kept until releaseRetired() is passed a completed frame at least as new
+		void compile(uint64_t lastFrame);
+		void releaseRetired(uint64_t completedFrame);
+		// Points frameInfo.commandBuffer at each pass's command buffer, restores the graphics one afterwards
+		void execute(FrameInfo& frameInfo);
+		void execute(FrameInfo& frameInfo, const GraphCommandBuffers& commandBuffers);
+
+		// Whether execute() needs a compute command buffer, and the stages the graphics command buffer has to wait for
+		// its submission at
+		bool hasAsyncWork() const { return m_asyncWork; }
+		VkPipelineStageFlags getAsyncWaitStages() const { return m_asyncWaitStages; }
+
+		bool isCulled(const std::string& passName) const;
+
+	private:
+		enum class ResourceType {
+			ImportedImage,
+			TransientImage,
+			Buffer
+		};
+
+		// Last writer and the readers since, what the next barrier on the resource has to wait for
+		struct ResourceState {
+			VkPipelineStageFlags writeStages = 0;
+			VkAccessFlags writeAccess = 0;
+			VkPipelineStageFlags readStages = 0;
+			VkPipelineStageFlags visibleStages = 0; // Readers the last write has already been made visible to
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		};
+
+		struct Resource {
+			std::string name;
+			ResourceType type;
+			bool perFrame = false;
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkImageSubresourceRange range{};
+			TransientImageInfo transientInfo{};
+			uint32_t memoryBlock = UINT32_MAX;
+			RenderResource aliasPredecessor = RENDER_GRAPH_INVALID_RESOURCE; // Previous occupant of the same memory, wraps to the previous frame
+			uint32_t firstPass = UINT32_MAX;
+			uint32_t lastPass = 0;
+			ResourceState state{};
+		};
+
+		struct MemoryBlock {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			uint32_t memoryTypeBits = UINT32_MAX;
+			uint32_t lastPass = 0;
+			RenderResource lastOccupant = RENDER_GRAPH_INVALID_RESOURCE;
+		};
+
+		// Transients replaced by a recompile, frames up to lastFrame may still use them
+		struct RetiredTransients {
+			std::vector<VkImageView> views;
+			std::vector<VkImage> images;
+			std::vector<VkDeviceMemory> memory;
+			uint64_t lastFrame = 0;
+		};
+
+		void cullPasses();
+		void scheduleAsync();
+		void computeLifetimes();
+		std::vector<RenderResource> liveTransients() const; // Ordered by first pass, the order they are placed in
+		void allocateTransients(uint64_t lastFrame);
+		void retireTransients(uint64_t lastFrame);
+		void destroyRetired(RetiredTransients& retired);
+		// Debug check of the placement, no two transients in a block overlap and a block is only added when every
+		// compatible one is still in use
+		void validateAliasing() const;
+		void recordBarriers(VkCommandBuffer commandBuffer, uint32_t passIndex);
+
+		VkeDevice& m_device;
+		std::vector<Resource> m_resources;
+		std::vector<PassBuilder> m_passes;
+		std::vector<MemoryBlock> m_memoryBlocks;
+		std::vector<RetiredTransients> m_retiredTransients;
+		std::string m_transientKey; // Infos and lifetimes the current transients were allocated for
+		bool m_compiled = false;
+
+		bool m_asyncWork = false;
+		VkPipelineStageFlags m_asyncWaitStages = 0;
+		uint32_t m_splitPass = 0; // First graphics pass reading async results, the early passes end before it
+
+		// Scratch space reused by every barrier batch
+		std::vector<Access> m_mergedAccesses;
+		std::vector<VkImageMemoryBarrier> m_imageBarriers;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "vke_render_packet.hpp"
+
+// std
+#include <algorithm>
+
+namespace vke {
+    void RenderPacket::extract(VkeGameObject::Map& gameObjects) {
+        objects.clear();
+        pointLights.clear();
+        directionalLights.clear();
+        hasDynamicObjects = false;
+
+        for (auto& kv : gameObjects) {
+            auto& obj = kv.second;
+
+            if (obj.model != nullptr) {
+                RenderObject& object = objects.emplace_back();
+                object.modelMatrix = obj.transform->getModelMatrix();
+                object.normalMatrix = obj.transform->getNormalMatrix();
+                object.model = obj.model.get();
+                object.textureIndex = obj.texture != nullptr ? obj.texture->getBindlessIndex() : BINDLESS_INVALID_INDEX;
+                object.isStatic = obj.isStatic;
+                hasDynamicObjects |= !obj.isStatic;
+
+                // Largest axis scale keeps the sphere conservative under non uniform scaling
+                const glm::mat4& m = object.modelMatrix;
+                float scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+                glm::vec3 center = glm::vec3(m * glm::vec4(obj.model->getBoundingCenter(), 1.0f));
+                object.boundingSphere = glm::vec4(center, obj.model->getBoundingRadius() * scale);
+            }
+
+            if (obj.pointLight != nullptr) {
+                RenderPointLight& light = pointLights.emplace_back();
+                light.position = obj.transform->translation;
+                light.radius = obj.transform->scale.x;
+                light.color = obj.color;
+                light.intensity = obj.pointLight->lightIntensity;
+                light.castsShadows = obj.pointLight->castsShadows;
+            }
+
+            if (obj.directionalLight != nullptr) {
+                RenderDirectionalLight& light = directionalLights.emplace_back();
+                light.position = obj.transform->translation;
+                light.color = obj.color;
+                light.intensity = obj.directionalLight->lightIntensity;
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../scene/vke_game_object.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace vke {
+	struct RenderObject {
+		glm::mat4 modelMatrix{ 1.0f };
+		glm::mat4 normalMatrix{ 1.0f };
+		glm::vec4 boundingSphere{ 0.0f }; // World space center in xyz, radius in w
+		VkeModel* model = nullptr; // Kept alive by its game object for the whole frame
+		uint32_t textureIndex = BINDLESS_INVALID_INDEX; // Albedo slot in the bindless heap
+		bool isStatic = false;
+	};
+
+	struct RenderPointLight {
+		glm::vec3 position{ 0.0f };
+		float radius = 0.0f; // Halo size, the shading range is derived from color and intensity
+		glm::vec3 color{ 0.0f };
+		float intensity = 0.0f;
+		bool castsShadows = false;
+	};
+
+	struct RenderDirectionalLight {
+		glm::vec3 position{ 0.0f }; // Looks at the origin
+		glm::vec3 color{ 0.0f };
+		float intensity = 0.0f;
+	};
+
+	// Everything the passes need from the scene, copied out of the game objects once per frame. Passes read only
+	// the packet, so recording never touches game objects and packets can be read from any thread. One packet per
+	// frame in flight acts as that frame's arena: extract clears the arrays but keeps their capacity, so once the
+	// scene size settles extracting never allocates
+	struct RenderPacket {
+		std::vector<RenderObject> objects;
+		std::vector<RenderPointLight> pointLights;
+		std::vector<RenderDirectionalLight> directionalLights;
+		bool hasDynamicObjects = false;
+
+		void extract(VkeGameObject::Map& gameObjects);
+	};
+}
\ No newline at end of file
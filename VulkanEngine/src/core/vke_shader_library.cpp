@@ -0,0 +1,62 @@
+#include "vke_shader_library.hpp"
+#include "../shaders/embedded_shaders.gen.hpp"
+
+// std
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace vke {
+    static bool readOverride(const std::string& name, ShaderCode& shader) {
+        const char* overrideDir = std::getenv(SHADER_OVERRIDE_ENV);
+        if (overrideDir == nullptr || overrideDir[0] == '\0') {
+            return false;
+        }
+
+        std::ifstream file(std::string(overrideDir) + "/" + name, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("----- VKE SHADER ERROR ----- : Override is not SPIR-V! File: " + name);
+        }
+        shader.overrideStorage.resize(fileSize / sizeof(uint32_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(shader.overrideStorage.data()), fileSize);
+
+        shader.code = shader.overrideStorage.data();
+        shader.size = fileSize;
+        shader.hash = hashShaderCode(shader.code, shader.size);
+        return true;
+    }
+
+    ShaderCode loadShaderCode(const std::string& name) {
+        ShaderCode shader{};
+        if (readOverride(name, shader)) {
+            return shader;
+        }
+
+        for (const EmbeddedShader& embedded : embeddedShaders) {
+            if (name == embedded.name) {
+                shader.code = embedded.code;
+                shader.size = embedded.size;
+                shader.hash = embedded.hash;
+                return shader;
+            }
+        }
+        throw std::runtime_error("----- VKE SHADER ERROR ----- : Shader was not embedded, rerun compile_shaders.bat! Shader: " + name);
+    }
+
+    uint64_t hashShaderCode(const uint32_t* code, size_t size) {
+        uint64_t hash = 14695981039346656037ull;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(code);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Directory searched before the embedded SPIR-V, lets a build run shaders compiled after it was linked. Read when a
+// shader is first requested, the pipeline registry keeps the module for the rest of the run
+#define SHADER_OVERRIDE_ENV "VKE_SHADER_DIR"
+
+namespace vke {
+	// Compiled into the binary by embed_shaders.ps1, see shaders/embedded_shaders.gen.hpp
+	struct EmbeddedShader {
+		const char* name;
+		const uint32_t* code;
+		size_t size;	// Bytes
+		uint64_t hash;	// FNV-1a of the code
+	};
+
+	// SPIR-V for one shader, pointing at the embedded array or at storage holding an override file
+	struct ShaderCode {
+		ShaderCode() = default;
+		ShaderCode(const ShaderCode&) = delete;
+		ShaderCode& operator=(const ShaderCode&) = delete;
+		ShaderCode(ShaderCode&&) = default;
+		ShaderCode& operator=(ShaderCode&&) = default;
+
+		const uint32_t* code = nullptr;
+		size_t size = 0;
+		uint64_t hash = 0;
+		std::vector<uint32_t> overrideStorage;
+	};
+
+	// Looks a shader up by file name ("simple_shader.vert.spv"), the override directory wins over the embedded copy
+	ShaderCode loadShaderCode(const std::string& name);
+	uint64_t hashShaderCode(const uint32_t* code, size_t size);
+}
\ No newline at end of file
@@ -0,0 +1,273 @@
+#include "vke_shader_reflection.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+// SPIR-V enum values used below, from spirv.hpp in the Vulkan SDK
+#define SPV_MAGIC 0x07230203
+#define SPV_OP_ENTRY_POINT 15
+#define SPV_OP_TYPE_INT 21
+#define SPV_OP_TYPE_FLOAT 22
+#define SPV_OP_TYPE_VECTOR 23
+#define SPV_OP_TYPE_MATRIX 24
+#define SPV_OP_TYPE_IMAGE 25
+#define SPV_OP_TYPE_SAMPLER 26
+#define SPV_OP_TYPE_SAMPLED_IMAGE 27
+#define SPV_OP_TYPE_ARRAY 28
+#define SPV_OP_TYPE_RUNTIME_ARRAY 29
+#define SPV_OP_TYPE_STRUCT 30
+#define SPV_OP_TYPE_POINTER 32
+#define SPV_OP_CONSTANT 43
+#define SPV_OP_VARIABLE 59
+#define SPV_OP_DECORATE 71
+#define SPV_OP_MEMBER_DECORATE 72
+
+#define SPV_DECORATION_SPEC_ID 1
+#define SPV_DECORATION_BLOCK 2
+#define SPV_DECORATION_BUFFER_BLOCK 3
+#define SPV_DECORATION_ARRAY_STRIDE 6
+#define SPV_DECORATION_MATRIX_STRIDE 7
+#define SPV_DECORATION_BINDING 33
+#define SPV_DECORATION_DESCRIPTOR_SET 34
+#define SPV_DECORATION_OFFSET 35
+
+#define SPV_STORAGE_UNIFORM_CONSTANT 0
+#define SPV_STORAGE_UNIFORM 2
+#define SPV_STORAGE_PUSH_CONSTANT 9
+#define SPV_STORAGE_STORAGE_BUFFER 12
+
+#define SPV_DIM_BUFFER 5
+#define SPV_DIM_SUBPASS_DATA 6
+
+namespace vke {
+    namespace {
+        struct SpvType {
+            uint32_t opcode = 0;
+            std::vector<uint32_t> operands; // Instruction words after the result id
+        };
+
+        struct SpvMember {
+            uint32_t offset = 0;
+            uint32_t matrixStride = 0;
+        };
+
+        class SpirvModule {
+        public:
+            SpirvModule(const ShaderCode& shaderCode) {
+                const uint32_t* words = shaderCode.code;
+                size_t wordCount = shaderCode.size / sizeof(uint32_t);
+                if (wordCount < 5 || words[0] != SPV_MAGIC) {
+                    throw std::runtime_error("----- VKE SHADER ERROR ----- : Not SPIR-V, can't reflect shader");
+                }
+
+                for (size_t i = 5; i < wordCount;) {
+                    uint32_t opcode = words[i] & 0xffff;
+                    uint32_t length = words[i] >> 16;
+                    if (length == 0 || i + length > wordCount) {
+                        throw std::runtime_error("----- VKE SHADER ERROR ----- : Truncated SPIR-V instruction");
+                    }
+                    parseInstruction(opcode, words + i + 1, length - 1);
+                    i += length;
+                }
+            }
+
+            ShaderReflection reflect() const {
+                ShaderReflection reflection{};
+                reflection.stage = m_stage;
+
+                for (auto& [id, variable] : m_variables) {
+                    uint32_t storage = variable.storage;
+                    if (storage != SPV_STORAGE_UNIFORM_CONSTANT && storage != SPV_STORAGE_UNIFORM &&
+                        storage != SPV_STORAGE_STORAGE_BUFFER && storage != SPV_STORAGE_PUSH_CONSTANT) {
+                        continue;
+                    }
+                    uint32_t type = m_types.at(variable.pointerType).operands[1];
+
+                    if (storage == SPV_STORAGE_PUSH_CONSTANT) {
+                        reflection.pushConstantSize = std::max(reflection.pushConstantSize, sizeOf(type, 0));
+                        continue;
+                    }
+
+                    ReflectedBinding binding{};
+                    binding.set = decoration(id, SPV_DECORATION_DESCRIPTOR_SET);
+                    binding.binding = decoration(id, SPV_DECORATION_BINDING);
+                    binding.count = 1;
+
+                    // Arrays of resources become a descriptor count, runtime arrays leave it at 0 for the caller to size
+                    while (m_types.at(type).opcode == SPV_OP_TYPE_ARRAY || m_types.at(type).opcode == SPV_OP_TYPE_RUNTIME_ARRAY) {
+                        const SpvType& array = m_types.at(type);
+                        binding.count = array.opcode == SPV_OP_TYPE_ARRAY ? binding.count * m_constants.at(array.operands[1]) : 0;
+                        type = array.operands[0];
+                    }
+                    binding.type = descriptorType(type, storage);
+                    reflection.bindings.push_back(binding);
+                }
+
+                auto specIds = m_decorations.find(SPV_DECORATION_SPEC_ID);
+                if (specIds != m_decorations.end()) {
+                    for (auto& [id, constantId] : specIds->second) {
+                        reflection.specializationConstants.push_back(constantId);
+                    }
+                    std::sort(reflection.specializationConstants.begin(), reflection.specializationConstants.end());
+                }
+
+                std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b) {
+                    return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+                });
+                return reflection;
+            }
+
+        private:
+            struct Variable {
+                uint32_t pointerType;
+                uint32_t storage;
+            };
+
+            void parseInstruction(uint32_t opcode, const uint32_t* operands, uint32_t count) {
+                switch (opcode) {
+                case SPV_OP_ENTRY_POINT:
+                    if (m_entryPoints++ > 0) {
+                        throw std::runtime_error("----- VKE SHADER ERROR ----- : Reflection expects one entry point per module");
+                    }
+                    m_stage = shaderStage(operands[0]);
+                    break;
+                case SPV_OP_DECORATE:
+                    m_decorations[operands[1]][operands[0]] = count > 2 ? operands[2] : 1;
+                    break;
+                case SPV_OP_MEMBER_DECORATE:
+                    if (operands[2] == SPV_DECORATION_OFFSET) {
+                        m_members[operands[0]].resize(std::max<size_t>(m_members[operands[0]].size(), operands[1] + 1));
+                        m_members[operands[0]][operands[1]].offset = operands[3];
+                    }
+                    else if (operands[2] == SPV_DECORATION_MATRIX_STRIDE) {
+                        m_members[operands[0]].resize(std::max<size_t>(m_members[operands[0]].size(), operands[1] + 1));
+                        m_members[operands[0]][operands[1]].matrixStride = operands[3];
+                    }
+                    break;
+                case SPV_OP_TYPE_INT:
+                case SPV_OP_TYPE_FLOAT:
+                case SPV_OP_TYPE_VECTOR:
+                case SPV_OP_TYPE_MATRIX:
+                case SPV_OP_TYPE_IMAGE:
+                case SPV_OP_TYPE_SAMPLER:
+                case SPV_OP_TYPE_SAMPLED_IMAGE:
+                case SPV_OP_TYPE_ARRAY:
+                case SPV_OP_TYPE_RUNTIME_ARRAY:
+                case SPV_OP_TYPE_STRUCT:
+                case SPV_OP_TYPE_POINTER:
+                    m_types[operands[0]] = { opcode, std::vector<uint32_t>(operands + 1, operands + count) };
+                    break;
+                case SPV_OP_CONSTANT:
+                    m_constants[operands[1]] = operands[2];
+                    break;
+                case SPV_OP_VARIABLE:
+                    m_variables[operands[1]] = { operands[0], operands[2] };
+                    break;
+                }
+            }
+
+            uint32_t decoration(uint32_t id, uint32_t decoration) const {
+                auto decorations = m_decorations.find(decoration);
+                if (decorations == m_decorations.end()) {
+                    return 0;
+                }
+                auto value = decorations->second.find(id);
+                return value == decorations->second.end() ? 0 : value->second;
+            }
+
+            bool hasDecoration(uint32_t id, uint32_t decoration) const {
+                auto decorations = m_decorations.find(decoration);
+                return decorations != m_decorations.end() && decorations->second.count(id) > 0;
+            }
+
+            // Bytes the type occupies in a block, matrices take the stride of the member holding them
+            uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride) const {
+                const SpvType& type = m_types.at(typeId);
+                switch (type.opcode) {
+                case SPV_OP_TYPE_INT:
+                case SPV_OP_TYPE_FLOAT:
+                    return type.operands[0] / 8;
+                case SPV_OP_TYPE_VECTOR:
+                    return type.operands[1] * sizeOf(type.operands[0], 0);
+                case SPV_OP_TYPE_MATRIX:
+                    return type.operands[1] * (matrixStride != 0 ? matrixStride : sizeOf(type.operands[0], 0));
+                case SPV_OP_TYPE_ARRAY: {
+                    uint32_t stride = decoration(typeId, SPV_DECORATION_ARRAY_STRIDE);
+                    return m_constants.at(type.operands[1]) * (stride != 0 ? stride : sizeOf(type.operands[0], matrixStride));
+                }
+                case SPV_OP_TYPE_STRUCT: {
+                    uint32_t size = 0;
+                    auto members = m_members.find(typeId);
+                    for (uint32_t i = 0; i < type.operands.size(); i++) {
+                        SpvMember member = members != m_members.end() && i < members->second.size() ? members->second[i] : SpvMember{};
+                        size = std::max(size, member.offset + sizeOf(type.operands[i], member.matrixStride));
+                    }
+                    return size;
+                }
+                default:
+                    return 0;
+                }
+            }
+
+            VkDescriptorType descriptorType(uint32_t typeId, uint32_t storage) const {
+                const SpvType& type = m_types.at(typeId);
+                if (storage == SPV_STORAGE_STORAGE_BUFFER ||
+                    (storage == SPV_STORAGE_UNIFORM && hasDecoration(typeId, SPV_DECORATION_BUFFER_BLOCK))) {
+                    return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                }
+                if (storage == SPV_STORAGE_UNIFORM) {
+                    return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                }
+
+                switch (type.opcode) {
+                case SPV_OP_TYPE_SAMPLED_IMAGE:
+                    return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                case SPV_OP_TYPE_SAMPLER:
+                    return VK_DESCRIPTOR_TYPE_SAMPLER;
+                case SPV_OP_TYPE_IMAGE: {
+                    // Operands: sampled type, dim, depth, arrayed, multisampled, sampled (1 sampled, 2 storage), format
+                    uint32_t dim = type.operands[1];
+                    bool storageImage = type.operands[5] == 2;
+                    if (dim == SPV_DIM_SUBPASS_DATA) {
+                        return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                    }
+                    if (dim == SPV_DIM_BUFFER) {
+                        return storageImage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                    }
+                    return storageImage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                }
+                default:
+                    throw std::runtime_error("----- VKE SHADER ERROR ----- : Unsupported resource type, opcode " + std::to_string(type.opcode));
+                }
+            }
+
+            static VkShaderStageFlagBits shaderStage(uint32_t executionModel) {
+                switch (executionModel) {
+                case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+                case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+                case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+                case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+                case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+                case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+                default:
+                    throw std::runtime_error("----- VKE SHADER ERROR ----- : Unsupported execution model " + std::to_string(executionModel));
+                }
+            }
+
+            VkShaderStageFlagBits m_stage = VK_SHADER_STAGE_ALL;
+            uint32_t m_entryPoints = 0;
+            std::unordered_map<uint32_t, SpvType> m_types;
+            std::unordered_map<uint32_t, uint32_t> m_constants;
+            std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>> m_decorations; // Decoration, id, value
+            std::unordered_map<uint32_t, std::vector<SpvMember>> m_members;
+            std::unordered_map<uint32_t, Variable> m_variables;
+        };
+    }
+
+    ShaderReflection reflectShader(const ShaderCode& shaderCode) {
+        return SpirvModule(shaderCode).reflect();
+    }
+}
\ No newline at end of file
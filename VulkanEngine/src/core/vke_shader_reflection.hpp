@@ -0,0 +1,29 @@
+#pragma once
+
+#include "vke_shader_library.hpp"
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <vector>
+
+namespace vke {
+	struct ReflectedBinding {
+		uint32_t set;
+		uint32_t binding;
+		VkDescriptorType type;
+		uint32_t count;
+	};
+
+	// Resource interface of one shader stage, read straight from the SPIR-V decorations
+	struct ShaderReflection {
+		VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+		std::vector<ReflectedBinding> bindings;
+		uint32_t pushConstantSize = 0; // Bytes, 0 without a push constant block
+		std::vector<uint32_t> specializationConstants; // constant_id of every specialization constant, sorted
+	};
+
+	// Throws on SPIR-V this engine doesn't bind: multiple entry points or unsupported resource types
+	ShaderReflection reflectShader(const ShaderCode& shaderCode);
+}
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "vke_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -10,13 +12,43 @@
 #include <stdexcept>
 
 namespace vke {
-    VkeSwapChain::VkeSwapChain(VkeDevice& deviceRef, VkExtent2D extent)
-        : m_device{ deviceRef }, m_windowExtent{ extent } {
+    static const VkPresentModeKHR PRESENT_MODES[] = {
+        VK_PRESENT_MODE_FIFO_KHR,
+        VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+        VK_PRESENT_MODE_MAILBOX_KHR,
+        VK_PRESENT_MODE_IMMEDIATE_KHR
+    };
+
+    // Orders the scene color's final layout transition before later color output, the render graph's barrier to
+    // the upscale chains onto it
+    static VkSubpassDependency sceneColorOutDependency(uint32_t lastSubpass) {
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = lastSubpass;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.dstAccessMask = 0;
+        return dependency;
+    }
+
+    const char* presentModeName(PresentMode mode) {
+        switch (mode) {
+        case PresentMode::Fifo: return "V-Sync";
+        case PresentMode::FifoRelaxed: return "Relaxed V-Sync";
+        case PresentMode::Mailbox: return "Mailbox";
+        case PresentMode::Immediate: return "Immediate";
+        default: return "Unknown";
+        }
+    }
+
+    VkeSwapChain::VkeSwapChain(VkeDevice& deviceRef, VkExtent2D extent, const SwapChainConfig& config)
+        : m_device{ deviceRef }, m_windowExtent{ extent }, m_config{ config } {
         init();
     }
 
-    VkeSwapChain::VkeSwapChain(VkeDevice& deviceRef, VkExtent2D extent, std::shared_ptr<VkeSwapChain> previous)
-        : m_device{ deviceRef }, m_windowExtent{ extent }, m_oldSwapChain{ previous } {
+    VkeSwapChain::VkeSwapChain(VkeDevice& deviceRef, VkExtent2D extent, const SwapChainConfig& config, std::shared_ptr<VkeSwapChain> previous)
+        : m_device{ deviceRef }, m_windowExtent{ extent }, m_config{ config }, m_oldSwapChain{ previous } {
         init();
         m_oldSwapChain = nullptr;
     }
@@ -25,7 +57,10 @@ namespace vke {
         createSwapChain();
         createImageViews();
         createRenderPass();
+        createDeferredRenderPass();
+        createPresentRenderPass();
         createDepthResources();
+        createGBufferResources();
         createFramebuffers();
         createSyncObjects();
     }
@@ -47,27 +82,64 @@ namespace vke {
             vkFreeMemory(m_device.device(), m_depthImageMemorys[i], nullptr);
         }
 
+        for (auto* attachments : { &m_albedoAttachments, &m_normalAttachments }) {
+            for (auto& attachment : *attachments) {
+                vkDestroyImageView(m_device.device(), attachment.view, nullptr);
+                vkDestroyImage(m_device.device(), attachment.image, nullptr);
+                vkFreeMemory(m_device.device(), attachment.memory, nullptr);
+            }
+        }
+
         for (auto framebuffer : m_swapChainFramebuffers) {
             vkDestroyFramebuffer(m_device.device(), framebuffer, nullptr);
         }
 
+        for (auto framebuffer : m_deferredFramebuffers) {
+            vkDestroyFramebuffer(m_device.device(), framebuffer, nullptr);
+        }
+
+        for (auto framebuffer : m_presentFramebuffers) {
+            vkDestroyFramebuffer(m_device.device(), framebuffer, nullptr);
+        }
+
+        // Destroyed once its frames have completed, like the swap chain itself
+        releaseSceneFramebuffers(std::numeric_limits<uint64_t>::max());
+
         vkDestroyRenderPass(m_device.device(), m_renderPass, nullptr);
+        vkDestroyRenderPass(m_device.device(), m_deferredRenderPass, nullptr);
+        vkDestroyRenderPass(m_device.device(), m_presentRenderPass, nullptr);
 
         // cleanup synchronization objects
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < m_config.framesInFlight; i++) {
             vkDestroySemaphore(m_device.device(), m_renderFinishedSemaphores[i], nullptr);
             vkDestroySemaphore(m_device.device(), m_imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(m_device.device(), m_inFlightFences[i], nullptr);
         }
+        // Null once a newer swap chain has taken the timeline over
+        vkDestroySemaphore(m_device.device(), m_frameTimeline, nullptr);
+    }
+
+    uint64_t VkeSwapChain::getCompletedFrame() const {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(m_device.device(), m_frameTimeline, &value);
+        return value;
+    }
+
+    void VkeSwapChain::waitForFrame(uint64_t frameNumber) const {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_frameTimeline;
+        waitInfo.pValues = &frameNumber;
+        vkWaitSemaphores(m_device.device(), &waitInfo, std::numeric_limits<uint64_t>::max());
     }
 
     VkResult VkeSwapChain::acquireNextImage(uint32_t* imageIndex) {
-        vkWaitForFences(
-            m_device.device(),
-            1,
-            &m_inFlightFences[m_currentFrame],
-            VK_TRUE,
-            std::numeric_limits<uint64_t>::max());
+        // The next frame reuses the slot of the frame m_config.framesInFlight submissions back
+        uint64_t nextFrame = m_frameNumber + 1;
+        if (nextFrame > m_config.framesInFlight) {
+            waitForFrame(nextFrame - m_config.framesInFlight);
+        }
+        releaseSceneFramebuffers(getCompletedFrame());
 
         VkResult result = vkAcquireNextImageKHR(
             m_device.device(),
@@ -80,33 +152,54 @@ namespace vke {
         return result;
     }
 
-    VkResult VkeSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) {
-        if (m_imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-            vkWaitForFences(m_device.device(), 1, &m_imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+    VkResult VkeSwapChain::submitCommandBuffers(const FrameSubmission& submission, uint32_t* imageIndex) {
+        // Images can come back out of order, wait if another slot's frame still renders to this one
+        if (m_imageFrameNumbers[*imageIndex] != 0) {
+            waitForFrame(m_imageFrameNumbers[*imageIndex]);
         }
-        m_imagesInFlight[*imageIndex] = m_inFlightFences[m_currentFrame];
-
-        VkSubmitInfo submitInfo = {};
+        uint64_t frameNumber = m_frameNumber + 1;
+        m_imageFrameNumbers[*imageIndex] = frameNumber;
+
+        // Values are ignored for the binary semaphores
+        bool waitForCompute = submission.computeTimeline != VK_NULL_HANDLE;
+        uint64_t waitValues[] = { 0, submission.computeValue };
+        uint64_t signalValues[] = { 0, frameNumber };
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = waitForCompute ? 2 : 1;
+        timelineInfo.pWaitSemaphoreValues = waitValues;
+        timelineInfo.signalSemaphoreValueCount = 2;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
+
+        // The frame timeline is signaled after both batches, signals wait for all earlier work on the queue
+        std::array<VkSubmitInfo, 2> submitInfos{};
+        VkSubmitInfo& earlyInfo = submitInfos[0];
+        earlyInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        earlyInfo.commandBufferCount = 1;
+        earlyInfo.pCommandBuffers = &submission.earlyCommandBuffer;
+
+        VkSubmitInfo& submitInfo = submitInfos[1];
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
 
-        VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame] };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
+        VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame], submission.computeTimeline };
+        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, submission.computeWaitStages };
+        submitInfo.waitSemaphoreCount = waitForCompute ? 2 : 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = buffers;
+        submitInfo.pCommandBuffers = &submission.commandBuffer;
 
-        VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[m_currentFrame] };
-        submitInfo.signalSemaphoreCount = 1;
+        VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[m_currentFrame], m_frameTimeline };
+        submitInfo.signalSemaphoreCount = 2;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
-        vkResetFences(m_device.device(), 1, &m_inFlightFences[m_currentFrame]);
-        if (vkQueueSubmit(m_device.graphicsQueue(), 1, &submitInfo, m_inFlightFences[m_currentFrame]) !=
-            VK_SUCCESS) {
+        bool hasEarly = submission.earlyCommandBuffer != VK_NULL_HANDLE;
+        if (vkQueueSubmit(m_device.graphicsQueue(), hasEarly ? 2 : 1, hasEarly ? submitInfos.data() : &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
+        m_frameNumber = frameNumber;
 
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -122,7 +215,7 @@ namespace vke {
 
         auto result = vkQueuePresentKHR(m_device.presentQueue(), &presentInfo);
 
-        m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        m_currentFrame = (m_currentFrame + 1) % m_config.framesInFlight;
 
         return result;
     }
@@ -131,14 +224,10 @@ namespace vke {
         SwapChainSupportDetails swapChainSupport = m_device.getSwapChainSupport();
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-        VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+        m_presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+        VkPresentModeKHR presentMode = PRESENT_MODES[static_cast<uint32_t>(m_presentMode)];
         VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
-
-        uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-        if (swapChainSupport.capabilities.maxImageCount > 0 &&
-            imageCount > swapChainSupport.capabilities.maxImageCount) {
-            imageCount = swapChainSupport.capabilities.maxImageCount;
-        }
+        uint32_t imageCount = chooseImageCount(swapChainSupport.capabilities);
 
         VkSwapchainCreateInfoKHR createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -233,7 +322,7 @@ namespace vke {
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         VkAttachmentReference colorAttachmentRef = {};
         colorAttachmentRef.attachment = 0;
@@ -245,16 +334,17 @@ namespace vke {
         subpass.pColorAttachments = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.srcAccessMask = 0;
-        dependency.srcStageMask =
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].srcAccessMask = 0;
+        dependencies[0].srcStageMask =
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstSubpass = 0;
-        dependency.dstStageMask =
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].dstStageMask =
             VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstAccessMask =
+        dependencies[0].dstAccessMask =
             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1] = sceneColorOutDependency(0);
 
         std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
         VkRenderPassCreateInfo renderPassInfo = {};
@@ -263,18 +353,166 @@ namespace vke {
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
 
         if (vkCreateRenderPass(m_device.device(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
     }
 
-    void VkeSwapChain::createFramebuffers() {
+    void VkeSwapChain::createDeferredRenderPass() {
+        std::array<VkAttachmentDescription, 4> attachments{};
+
+        // 0: scene color, written by the lighting subpass
+        attachments[0].format = getSwapChainImageFormat();
+        attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        // 1: depth, 2: albedo, 3: normal. Nothing is stored, they never leave the render pass
+        attachments[1].format = findDepthFormat();
+        attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        attachments[2].format = GBUFFER_ALBEDO_FORMAT;
+        attachments[2].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        attachments[3].format = GBUFFER_NORMAL_FORMAT;
+        attachments[3].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        for (size_t i = 1; i < attachments.size(); i++) {
+            attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+            attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+
+        // G-buffer subpass
+        std::array<VkAttachmentReference, 2> gbufferColorRefs = {{
+            { 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+            { 3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }
+        }};
+        VkAttachmentReference gbufferDepthRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+        // Lighting subpass, depth is both an input and a read only depth test for the light volumes
+        VkAttachmentReference lightingColorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        std::array<VkAttachmentReference, 3> lightingInputRefs = {{
+            { 2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            { 3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+            { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL }
+        }};
+        VkAttachmentReference lightingDepthRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+        std::array<VkSubpassDescription, 2> subpasses{};
+        subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[0].colorAttachmentCount = static_cast<uint32_t>(gbufferColorRefs.size());
+        subpasses[0].pColorAttachments = gbufferColorRefs.data();
+        subpasses[0].pDepthStencilAttachment = &gbufferDepthRef;
+
+        subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[1].colorAttachmentCount = 1;
+        subpasses[1].pColorAttachments = &lightingColorRef;
+        subpasses[1].inputAttachmentCount = static_cast<uint32_t>(lightingInputRefs.size());
+        subpasses[1].pInputAttachments = lightingInputRefs.data();
+        subpasses[1].pDepthStencilAttachment = &lightingDepthRef;
+
+        std::array<VkSubpassDependency, 3> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].srcAccessMask = 0;
+        dependencies[0].srcStageMask =
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].dstStageMask =
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask =
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // G-buffer writes are visible to the lighting subpass at the same pixel only
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].srcStageMask =
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].srcAccessMask =
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstSubpass = 1;
+        dependencies[1].dstStageMask =
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[1].dstAccessMask =
+            VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+        dependencies[2] = sceneColorOutDependency(1);
+
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+        renderPassInfo.pSubpasses = subpasses.data();
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(m_device.device(), &renderPassInfo, nullptr, &m_deferredRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create deferred render pass!");
+        }
+    }
+
+    void VkeSwapChain::createPresentRenderPass() {
+        // Every pixel is overwritten by the upscale, the old contents are never loaded
+        VkAttachmentDescription colorAttachment = {};
+        colorAttachment.format = getSwapChainImageFormat();
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        VkAttachmentReference colorAttachmentRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+        VkSubpassDescription subpass = {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+
+        // The acquire semaphore is waited on at color attachment output, the layout transition has to wait with it
+        VkSubpassDependency dependency = {};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.srcAccessMask = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.dstSubpass = 0;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &colorAttachment;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
+
+        if (vkCreateRenderPass(m_device.device(), &renderPassInfo, nullptr, &m_presentRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create present render pass!");
+        }
+    }
+
+    void VkeSwapChain::setSceneColor(VkImageView sceneColor) {
+        // The graph reallocates the target between frames, the previous one's framebuffers may still be in flight
+        if (!m_swapChainFramebuffers.empty()) {
+            RetiredFramebuffers retired{};
+            retired.framebuffers = m_swapChainFramebuffers;
+            retired.framebuffers.insert(retired.framebuffers.end(), m_deferredFramebuffers.begin(), m_deferredFramebuffers.end());
+            retired.lastFrame = m_frameNumber;
+            m_retiredFramebuffers.push_back(std::move(retired));
+        }
+
         m_swapChainFramebuffers.resize(imageCount());
         for (size_t i = 0; i < imageCount(); i++) {
-            std::array<VkImageView, 2> attachments = { m_swapChainImageViews[i], m_depthImageViews[i] };
+            std::array<VkImageView, 2> attachments = { sceneColor, m_depthImageViews[i] };
 
             VkExtent2D swapChainExtent = getSwapChainExtent();
             VkFramebufferCreateInfo framebufferInfo = {};
@@ -294,6 +532,68 @@ namespace vke {
                 throw std::runtime_error("failed to create framebuffer!");
             }
         }
+
+        m_deferredFramebuffers.resize(imageCount());
+        for (size_t i = 0; i < imageCount(); i++) {
+            std::array<VkImageView, 4> attachments = {
+                sceneColor,
+                m_depthImageViews[i],
+                m_albedoAttachments[i].view,
+                m_normalAttachments[i].view };
+
+            VkExtent2D swapChainExtent = getSwapChainExtent();
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = m_deferredRenderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferInfo.pAttachments = attachments.data();
+            framebufferInfo.width = swapChainExtent.width;
+            framebufferInfo.height = swapChainExtent.height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(
+                m_device.device(),
+                &framebufferInfo,
+                nullptr,
+                &m_deferredFramebuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create deferred framebuffer!");
+            }
+        }
+    }
+
+    void VkeSwapChain::releaseSceneFramebuffers(uint64_t completedFrame) {
+        auto released = std::partition(m_retiredFramebuffers.begin(), m_retiredFramebuffers.end(), [completedFrame](const RetiredFramebuffers& retired) {
+            return retired.lastFrame > completedFrame;
+        });
+        for (auto retired = released; retired != m_retiredFramebuffers.end(); retired++) {
+            for (auto framebuffer : retired->framebuffers) {
+                vkDestroyFramebuffer(m_device.device(), framebuffer, nullptr);
+            }
+        }
+        m_retiredFramebuffers.erase(released, m_retiredFramebuffers.end());
+    }
+
+    void VkeSwapChain::createFramebuffers() {
+        m_presentFramebuffers.resize(imageCount());
+        for (size_t i = 0; i < imageCount(); i++) {
+            VkExtent2D swapChainExtent = getSwapChainExtent();
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = m_presentRenderPass;
+            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.pAttachments = &m_swapChainImageViews[i];
+            framebufferInfo.width = swapChainExtent.width;
+            framebufferInfo.height = swapChainExtent.height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(
+                m_device.device(),
+                &framebufferInfo,
+                nullptr,
+                &m_presentFramebuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create present framebuffer!");
+            }
+        }
     }
 
     void VkeSwapChain::createDepthResources() {
@@ -317,14 +617,15 @@ namespace vke {
             imageInfo.format = depthFormat;
             imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
             imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            // Never stored by either render pass, the deferred lighting subpass reads it as an input attachment
+            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+                VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
             imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
             imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
             imageInfo.flags = 0;
 
-            m_device.createImageWithInfo(
+            m_device.createTransientImageWithInfo(
                 imageInfo,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 m_depthImages[i],
                 m_depthImageMemorys[i]);
 
@@ -345,28 +646,93 @@ namespace vke {
         }
     }
 
+    void VkeSwapChain::createGBufferResources() {
+        VkExtent2D swapChainExtent = getSwapChainExtent();
+        m_albedoAttachments.resize(imageCount());
+        m_normalAttachments.resize(imageCount());
+
+        auto createAttachment = [&](VkFormat format, OffscreenAttachment& attachment) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent.width = swapChainExtent.width;
+            imageInfo.extent.height = swapChainExtent.height;
+            imageInfo.extent.depth = 1;
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+                VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.flags = 0;
+
+            m_device.createTransientImageWithInfo(imageInfo, attachment.image, attachment.memory);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = attachment.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = format;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(m_device.device(), &viewInfo, nullptr, &attachment.view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create G-buffer image view!");
+            }
+        };
+
+        for (size_t i = 0; i < imageCount(); i++) {
+            createAttachment(GBUFFER_ALBEDO_FORMAT, m_albedoAttachments[i]);
+            createAttachment(GBUFFER_NORMAL_FORMAT, m_normalAttachments[i]);
+        }
+    }
+
     void VkeSwapChain::createSyncObjects() {
-        m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        m_imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+        assert(m_config.framesInFlight >= MIN_FRAMES_IN_FLIGHT && m_config.framesInFlight <= MAX_FRAMES_IN_FLIGHT && "Frames in flight out of range");
+        m_imageAvailableSemaphores.resize(m_config.framesInFlight);
+        m_renderFinishedSemaphores.resize(m_config.framesInFlight);
+        m_imageFrameNumbers.assign(imageCount(), 0);
 
         VkSemaphoreCreateInfo semaphoreInfo = {};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fenceInfo = {};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < m_config.framesInFlight; i++) {
             if (vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) !=
                 VK_SUCCESS ||
                 vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) !=
-                VK_SUCCESS ||
-                vkCreateFence(m_device.device(), &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
+                VK_SUCCESS) {
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
         }
+
+        // Frame numbering continues across recreation, frames still in flight on the previous swap chain keep
+        // signaling the same timeline and the per frame slots stay in step
+        if (m_oldSwapChain != nullptr) {
+            assert(m_oldSwapChain->m_config.framesInFlight == m_config.framesInFlight && "Frames in flight can't change on recreation");
+            m_frameTimeline = m_oldSwapChain->m_frameTimeline;
+            m_frameNumber = m_oldSwapChain->m_frameNumber;
+            m_currentFrame = m_oldSwapChain->m_currentFrame;
+            m_oldSwapChain->m_frameTimeline = VK_NULL_HANDLE;
+            return;
+        }
+
+        VkSemaphoreTypeCreateInfo timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        timelineInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo timelineSemaphoreInfo = {};
+        timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        timelineSemaphoreInfo.pNext = &timelineInfo;
+        if (vkCreateSemaphore(m_device.device(), &timelineSemaphoreInfo, nullptr, &m_frameTimeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame timeline semaphore!");
+        }
     }
 
     VkSurfaceFormatKHR VkeSwapChain::chooseSwapSurfaceFormat(
@@ -381,24 +747,29 @@ namespace vke {
         return availableFormats[0];
     }
 
-    VkPresentModeKHR VkeSwapChain::chooseSwapPresentMode(
+    PresentMode VkeSwapChain::chooseSwapPresentMode(
         const std::vector<VkPresentModeKHR>& availablePresentModes) {
+        assert(m_config.presentMode < PresentMode::Count && "Invalid present mode");
+        VkPresentModeKHR requested = PRESENT_MODES[static_cast<uint32_t>(m_config.presentMode)];
         for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                std::cout << "Present mode: Mailbox" << std::endl;
-                return availablePresentMode;
+            if (availablePresentMode == requested) {
+                std::cout << "Present mode: " << presentModeName(m_config.presentMode) << std::endl;
+                return m_config.presentMode;
             }
         }
 
-        // for (const auto &availablePresentMode : availablePresentModes) {
-        //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-        //     std::cout << "Present mode: Immediate" << std::endl;
-        //     return availablePresentMode;
-        //   }
-        // }
+        std::cout << "Present mode: " << presentModeName(m_config.presentMode) << " unsupported, using "
+            << presentModeName(PresentMode::Fifo) << std::endl;
+        return PresentMode::Fifo;
+    }
 
-        std::cout << "Present mode: V-Sync" << std::endl;
-        return VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t VkeSwapChain::chooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities) {
+        uint32_t imageCount = m_config.imageCount != 0 ? m_config.imageCount : capabilities.minImageCount + 1;
+        imageCount = std::max(imageCount, capabilities.minImageCount);
+        if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+            imageCount = capabilities.maxImageCount;
+        }
+        return imageCount;
     }
 
     VkExtent2D VkeSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
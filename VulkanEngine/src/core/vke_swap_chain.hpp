@@ -10,21 +10,73 @@
 #include <vector>
 #include <memory>
 
+// Deferred G-buffer, lives only inside the deferred render pass
+#define GBUFFER_ALBEDO_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+#define GBUFFER_NORMAL_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+
+// Frames the CPU may record ahead of the GPU. One is lowest latency, more hide CPU spikes at the cost of latency
+#define MIN_FRAMES_IN_FLIGHT 1
+#define MAX_FRAMES_IN_FLIGHT 4
+#define DEFAULT_FRAMES_IN_FLIGHT 2
+
 namespace vke {
+    // Falls back to Fifo, the only mode every surface supports, when the requested one is unavailable
+    enum class PresentMode : uint32_t {
+        Fifo = 0,           // V-Sync, frames queue behind each other
+        FifoRelaxed = 1,    // V-Sync, a frame that misses the blank presents immediately and may tear
+        Mailbox = 2,        // V-Sync, a newer frame replaces the queued one
+        Immediate = 3,      // No waiting, tears
+        Count
+    };
+
+    const char* presentModeName(PresentMode mode);
+
+    struct SwapChainConfig {
+        uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+        PresentMode presentMode = PresentMode::Mailbox;
+        uint32_t imageCount = 0; // Clamped to the surface's limits, 0 requests one more than the minimum
+    };
+
+    // One frame's graphics work. The early command buffer neither waits for the swap chain image nor for async
+    // compute, so it overlaps both. The main one waits for the image and, when computeTimeline is set, for
+    // computeValue at computeWaitStages
+    struct FrameSubmission {
+        VkCommandBuffer earlyCommandBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkSemaphore computeTimeline = VK_NULL_HANDLE;
+        uint64_t computeValue = 0;
+        VkPipelineStageFlags computeWaitStages = 0;
+    };
+
     class VkeSwapChain {
     public:
-        static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-        VkeSwapChain(VkeDevice& deviceRef, VkExtent2D windowExtent);
-        VkeSwapChain(VkeDevice& deviceRef, VkExtent2D windowExtent, std::shared_ptr<VkeSwapChain> previous);;
+        VkeSwapChain(VkeDevice& deviceRef, VkExtent2D windowExtent, const SwapChainConfig& config);
+        // Retires previous, which may still have frames in flight. Takes over its frame timeline, previous must be kept
+        // alive until getCompletedFrame() reaches its last submitted frame
+        VkeSwapChain(VkeDevice& deviceRef, VkExtent2D windowExtent, const SwapChainConfig& config, std::shared_ptr<VkeSwapChain> previous);
         ~VkeSwapChain();
 
         VkeSwapChain(const VkeSwapChain&) = delete;
         VkeSwapChain operator=(const VkeSwapChain&) = delete;
 
+        // Both scene render passes draw into the scene color target, left in SHADER_READ_ONLY_OPTIMAL for the
+        // present pass to upscale from. The target is owned by the render graph and needs the swap chain's extent,
+        // scenes may cover less of it. Their framebuffers only exist once it has been set
+        void setSceneColor(VkImageView sceneColor);
         VkFramebuffer getFrameBuffer(int index) { return m_swapChainFramebuffers[index]; }
         VkRenderPass getRenderPass() { return m_renderPass; }
+
+        // Subpass 0 fills the G-buffer, subpass 1 reads it back as input attachments and shades
+        VkFramebuffer getDeferredFrameBuffer(int index) { return m_deferredFramebuffers[index]; }
+        VkRenderPass getDeferredRenderPass() { return m_deferredRenderPass; }
+        VkImageView getDepthImageView(int index) { return m_depthImageViews[index]; }
+        VkImageView getAlbedoImageView(int index) { return m_albedoAttachments[index].view; }
+        VkImageView getNormalImageView(int index) { return m_normalAttachments[index].view; }
         VkImageView getImageView(int index) { return m_swapChainImageViews[index]; }
+
+        // Single color attachment, the swap chain image, left ready to present
+        VkFramebuffer getPresentFrameBuffer(int index) { return m_presentFramebuffers[index]; }
+        VkRenderPass getPresentRenderPass() { return m_presentRenderPass; }
         size_t imageCount() { return m_swapChainImages.size(); }
         VkFormat getSwapChainImageFormat() { return m_swapChainImageFormat; }
         VkExtent2D getSwapChainExtent() { return m_swapChainExtent; }
@@ -34,8 +86,22 @@ namespace vke {
         float extentAspectRatio() { return static_cast<float>(m_swapChainExtent.width) / static_cast<float>(m_swapChainExtent.height); }
         VkFormat findDepthFormat();
 
+        // Blocks until the frame that last used the current slot has finished on the GPU
         VkResult acquireNextImage(uint32_t* imageIndex);
-        VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+        VkResult submitCommandBuffers(const FrameSubmission& submission, uint32_t* imageIndex);
+
+        // Slot of the frame being recorded, indexes every per frame resource
+        uint32_t getCurrentFrame() const { return m_currentFrame; }
+        uint32_t getFramesInFlight() const { return m_config.framesInFlight; }
+
+        // Mode actually in use, differs from the config's when the surface doesn't support it
+        PresentMode getPresentMode() const { return m_presentMode; }
+
+        // Frames are numbered from 1 in submission order, the timeline semaphore reaches a frame's number once the GPU
+        // has finished it
+        uint64_t getSubmittedFrame() const { return m_frameNumber; }
+        uint64_t getCompletedFrame() const;
+        void waitForFrame(uint64_t frameNumber) const;
 
         bool compareSwapFormats(const VkeSwapChain& swapChain) {
             return swapChain.m_swapChainDepthFormat == m_swapChainDepthFormat && 
@@ -48,14 +114,19 @@ namespace vke {
         void createImageViews();
         void createDepthResources();
         void createRenderPass();
+        void createDeferredRenderPass();
+        void createPresentRenderPass();
+        void createGBufferResources();
         void createFramebuffers();
+        void releaseSceneFramebuffers(uint64_t completedFrame);
         void createSyncObjects();
 
         // Helper functions
         VkSurfaceFormatKHR chooseSwapSurfaceFormat(
             const std::vector<VkSurfaceFormatKHR>& availableFormats);
-        VkPresentModeKHR chooseSwapPresentMode(
+        PresentMode chooseSwapPresentMode(
             const std::vector<VkPresentModeKHR>& availablePresentModes);
+        uint32_t chooseImageCount(const VkSurfaceCapabilitiesKHR& capabilities);
         VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
         VkFormat m_swapChainImageFormat;
@@ -71,16 +142,43 @@ namespace vke {
         std::vector<VkImage> m_swapChainImages;
         std::vector<VkImageView> m_swapChainImageViews;
 
+        struct OffscreenAttachment {
+            VkImage image;
+            VkDeviceMemory memory;
+            VkImageView view;
+        };
+
+        std::vector<VkFramebuffer> m_deferredFramebuffers;
+        VkRenderPass m_deferredRenderPass;
+        std::vector<OffscreenAttachment> m_albedoAttachments;
+        std::vector<OffscreenAttachment> m_normalAttachments;
+
+        // Framebuffers of a replaced scene color target, frames up to lastFrame may still use them
+        struct RetiredFramebuffers {
+            std::vector<VkFramebuffer> framebuffers;
+            uint64_t lastFrame = 0;
+        };
+        std::vector<RetiredFramebuffers> m_retiredFramebuffers;
+
+        std::vector<VkFramebuffer> m_presentFramebuffers;
+        VkRenderPass m_presentRenderPass;
+
         VkeDevice& m_device;
         VkExtent2D m_windowExtent;
+        SwapChainConfig m_config;
+        PresentMode m_presentMode;
 
         VkSwapchainKHR m_swapChain;
         std::shared_ptr<VkeSwapChain> m_oldSwapChain;
 
+        // Binary semaphores for the presentation engine, one per slot
         std::vector<VkSemaphore> m_imageAvailableSemaphores;
         std::vector<VkSemaphore> m_renderFinishedSemaphores;
-        std::vector<VkFence> m_inFlightFences;
-        std::vector<VkFence> m_imagesInFlight;
-        size_t m_currentFrame = 0;
+
+        // Signaled with each frame's number, replaces per frame fences
+        VkSemaphore m_frameTimeline = VK_NULL_HANDLE;
+        uint64_t m_frameNumber = 0;
+        std::vector<uint64_t> m_imageFrameNumbers; // Last frame that rendered to each swap chain image
+        uint32_t m_currentFrame = 0;
     };
 }
@@ -0,0 +1,47 @@
+#include "dynamic_resolution.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace vke {
+    VkeDynamicResolution::VkeDynamicResolution(const DynamicResolutionConfig& config) {
+        setConfig(config);
+    }
+
+    void VkeDynamicResolution::setConfig(const DynamicResolutionConfig& config) {
+        assert(config.minScale > 0.0f && config.minScale <= config.maxScale && config.maxScale <= 1.0f && "Resolution scale bounds out of range");
+        assert(config.targetFrameMs > 0.0f && "Target frame time must be positive");
+        m_config = config;
+        m_scale = config.maxScale;
+    }
+
+    void VkeDynamicResolution::update(float fixedMs, float scaledMs) {
+        if (!m_config.enabled) {
+            m_scale = m_config.maxScale;
+            return;
+        }
+        if (scaledMs <= 0.0f)
+            return;
+
+        // Whatever the fixed cost leaves of the budget goes to the scaled passes
+        float budgetMs = m_config.targetFrameMs * DYNAMIC_RESOLUTION_HEADROOM - fixedMs;
+        float ideal = (budgetMs > 0.0f) ? m_scale * std::sqrt(budgetMs / scaledMs) : m_config.minScale;
+        ideal = std::clamp(ideal, m_config.minScale, m_config.maxScale);
+
+        float delta = ideal - m_scale;
+        if (std::abs(delta) < DYNAMIC_RESOLUTION_DEADBAND && ideal != m_config.minScale && ideal != m_config.maxScale)
+            return;
+
+        float rate = (delta < 0.0f) ? DYNAMIC_RESOLUTION_DOWN_RATE : DYNAMIC_RESOLUTION_UP_RATE;
+        m_scale = std::clamp(m_scale + delta * rate, m_config.minScale, m_config.maxScale);
+    }
+
+    VkExtent2D VkeDynamicResolution::scaledExtent(VkExtent2D fullExtent) const {
+        VkExtent2D extent{};
+        extent.width = std::clamp(static_cast<uint32_t>(std::lround(fullExtent.width * m_scale)), 1u, fullExtent.width);
+        extent.height = std::clamp(static_cast<uint32_t>(std::lround(fullExtent.height * m_scale)), 1u, fullExtent.height);
+        return extent;
+    }
+}
\ No newline at end of file
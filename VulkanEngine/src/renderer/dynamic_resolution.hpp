@@ -0,0 +1,46 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+#define DEFAULT_TARGET_FRAME_MS (1000.0f / 60.0f)
+
+// Share of the target the GPU aims to use, measurements lag a few frames behind and the margin absorbs spikes
+#define DYNAMIC_RESOLUTION_HEADROOM 0.9f
+
+// Per measurement, the scale drops quickly to recover from a hitch and climbs back slowly to avoid oscillating
+#define DYNAMIC_RESOLUTION_DOWN_RATE 0.5f
+#define DYNAMIC_RESOLUTION_UP_RATE 0.05f
+
+// Changes smaller than this are ignored, the resolution settles instead of jittering by a pixel
+#define DYNAMIC_RESOLUTION_DEADBAND 0.02f
+
+namespace vke {
+	// Scales apply to both axes of the swap chain extent
+	struct DynamicResolutionConfig {
+		bool enabled = true;
+		float minScale = 0.5f;
+		float maxScale = 1.0f; // At most 1, the scene color target has the swap chain's extent
+		float targetFrameMs = DEFAULT_TARGET_FRAME_MS;
+	};
+
+	// Picks the scene resolution that keeps the GPU frame time at the target. Cost is assumed proportional to
+	// the pixel count, so the scale follows the square root of the time ratio
+	class VkeDynamicResolution {
+	public:
+		VkeDynamicResolution(const DynamicResolutionConfig& config = DynamicResolutionConfig{});
+
+		// fixedMs is GPU time independent of the resolution (shadow maps, the upscale), scaledMs the time that follows it
+		void update(float fixedMs, float scaledMs);
+
+		VkExtent2D scaledExtent(VkExtent2D fullExtent) const;
+		float getScale() const { return m_scale; }
+
+		void setConfig(const DynamicResolutionConfig& config);
+		const DynamicResolutionConfig& getConfig() const { return m_config; }
+
+	private:
+		DynamicResolutionConfig m_config;
+		float m_scale;
+	};
+}
\ No newline at end of file
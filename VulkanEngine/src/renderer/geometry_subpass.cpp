@@ -4,17 +4,44 @@ namespace vke {
     struct PushModelData {
         glm::mat4 modelMatrix{ 1.0f };
         glm::mat4 normalMatrix{ 1.0f };
+        uint32_t textureIndex = BINDLESS_INVALID_INDEX; // Albedo slot in the bindless heap
     };
 
-    GeometrySubpass::GeometrySubpass(VkeDevice& device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout>& setLayouts) : m_device { device } {
+    GeometrySubpass::GeometrySubpass(VkeDevice& device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout>& setLayouts) : m_device { device }, m_renderPass{ renderPass } {
         createPipelineLayout(setLayouts);
         createPipeline(renderPass);
     }
 
-    GeometrySubpass::~GeometrySubpass() { vkDestroyPipelineLayout(m_device.device(), m_pipelineLayout, nullptr); }
+    void GeometrySubpass::setShadingVariant(const ShadingVariant& variant) {
+        m_shadingVariant = variant;
+        createPipeline(m_renderPass);
+    }
+
+    GeometrySubpass::~GeometrySubpass() { }
     
     void GeometrySubpass::draw(FrameInfo& frameInfo) {
-        m_pipeline->bind(frameInfo.commandBuffer);
+        // With a prepass the depth buffer already holds the closest surface, so only visible fragments get shaded
+        if (m_depthPrepassEnabled) {
+            m_depthEqualPipeline->bind(frameInfo.commandBuffer);
+        }
+        else {
+            m_pipeline->bind(frameInfo.commandBuffer);
+        }
+        drawObjects(frameInfo);
+    }
+
+    void GeometrySubpass::drawDepthPrepass(FrameInfo& frameInfo) {
+        m_depthPrepassPipeline->bind(frameInfo.commandBuffer);
+        drawObjects(frameInfo);
+    }
+
+    void GeometrySubpass::drawGBuffer(FrameInfo& frameInfo) {
+        assert(m_gbufferPipeline != nullptr && "G-buffer pipeline was never initialized");
+        m_gbufferPipeline->bind(frameInfo.commandBuffer);
+        drawObjects(frameInfo);
+    }
+
+    void GeometrySubpass::drawObjects(FrameInfo& frameInfo) {
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -25,20 +52,16 @@ namespace vke {
             0,
             nullptr);
 
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
-
-            if (obj.model == nullptr)
-                continue;
-         
+        for (const RenderObject& obj : frameInfo.renderPacket.objects) {
             PushModelData push{};
-            push.modelMatrix = obj.transform->getModelMatrix();
-            push.normalMatrix = obj.transform->getNormalMatrix();
+            push.modelMatrix = obj.modelMatrix;
+            push.normalMatrix = obj.normalMatrix;
+            push.textureIndex = obj.textureIndex;
             
             vkCmdPushConstants(
                 frameInfo.commandBuffer,
                 m_pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                m_pushConstantStages,
                 0,
                 sizeof(PushModelData),
                 &push);
@@ -60,28 +83,70 @@ namespace vke {
         VkePipeline::defaultPipelineConfigInfo(pipelineConfig);
         pipelineConfig.renderPass = renderPass;
         pipelineConfig.pipelineLayout = m_pipelineLayout;
-        m_pipeline = std::make_unique<VkePipeline>(
-            m_device,
-            "VulkanEngine/src/shaders/simple_shader.vert.spv",
-            "VulkanEngine/src/shaders/simple_shader.frag.spv",
-            pipelineConfig);
+        m_shadingVariant.apply(pipelineConfig);
+        m_pipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "simple_shader.vert.spv",
+            "simple_shader.frag.spv",
+            pipelineConfig,
+            false,
+            m_pipeline);
+
+        // Main pass after a prepass: depth is final, test for equality and leave it untouched
+        PipelineConfigInfo equalConfig{};
+        VkePipeline::defaultPipelineConfigInfo(equalConfig);
+        equalConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        equalConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        equalConfig.renderPass = renderPass;
+        equalConfig.pipelineLayout = m_pipelineLayout;
+        m_shadingVariant.apply(equalConfig);
+        m_depthEqualPipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "simple_shader.vert.spv",
+            "simple_shader.frag.spv",
+            equalConfig,
+            false,
+            m_depthEqualPipeline);
+
+        // Depth prepass, same position only path as the shadow pipeline. The subpass still has
+        // a color attachment so writes to it are masked off instead of removing the attachment
+        PipelineConfigInfo prepassConfig{};
+        VkePipeline::defaultPipelineConfigInfo(prepassConfig);
+        VkePipeline::enablePositionOnlyInput(prepassConfig);
+        prepassConfig.colorBlendAttachment.colorWriteMask = 0;
+        prepassConfig.renderPass = renderPass;
+        prepassConfig.pipelineLayout = m_pipelineLayout;
+        m_depthPrepassPipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "depth_prepass.vert.spv",
+            "blank.frag.spv",
+            prepassConfig);
+    }
+
+    void GeometrySubpass::initDeferredPipeline(VkRenderPass renderPass, uint32_t subpass) {
+        assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        // Two G-buffer color attachments, neither blended
+        PipelineConfigInfo gbufferConfig{};
+        VkePipeline::defaultPipelineConfigInfo(gbufferConfig);
+        std::array<VkPipelineColorBlendAttachmentState, 2> blendAttachments = {
+            gbufferConfig.colorBlendAttachment,
+            gbufferConfig.colorBlendAttachment };
+        gbufferConfig.colorBlendInfo.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+        gbufferConfig.colorBlendInfo.pAttachments = blendAttachments.data();
+
+        gbufferConfig.renderPass = renderPass;
+        gbufferConfig.subpass = subpass;
+        gbufferConfig.pipelineLayout = m_pipelineLayout;
+        m_gbufferPipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "simple_shader.vert.spv",
+            "gbuffer.frag.spv",
+            gbufferConfig);
     }
 
     void GeometrySubpass::createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(PushModelData);
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) !=
-            VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
+        PipelineLayoutInfo layoutInfo = m_device.pipelineRegistry().getPipelineLayout(
+            { "simple_shader.vert.spv", "simple_shader.frag.spv", "depth_prepass.vert.spv", "blank.frag.spv", "gbuffer.frag.spv" },
+            setLayouts);
+        assert(layoutInfo.pushConstantRange.size == sizeof(PushModelData) && "PushModelData doesn't match the shaders' push constant block");
+        m_pipelineLayout = layoutInfo.layout;
+        m_pushConstantStages = layoutInfo.pushConstantRange.stageFlags;
     }
 }
\ No newline at end of file
@@ -1,9 +1,10 @@
 #pragma once
 
 #include "../core/vke_device.hpp"
-#include "../core/vke_pipeline.hpp"
+#include "../core/vke_pipeline_registry.hpp"
 #include "../core/vke_frame_info.hpp"
 #include "../core/vke_swap_chain.hpp"
+#include "../renderer/shading_variant.hpp"
 #include "../scene/components/vke_camera.hpp"
 #include "../scene/vke_game_object.hpp"
 
@@ -28,14 +29,37 @@ namespace vke {
 		GeometrySubpass(const GeometrySubpass&) = delete;
 		GeometrySubpass& operator=(const GeometrySubpass&) = delete;
 		void draw(FrameInfo& frameInfo);
+		void drawDepthPrepass(FrameInfo& frameInfo);
+
+		// Deferred path, writes albedo and normals into the G-buffer subpass of the deferred render pass
+		void initDeferredPipeline(VkRenderPass renderPass, uint32_t subpass);
+		void drawGBuffer(FrameInfo& frameInfo);
+
+		// When enabled, drawDepthPrepass must be recorded before draw in the same subpass
+		void setDepthPrepass(bool enabled) { m_depthPrepassEnabled = enabled; }
+		bool isDepthPrepassEnabled() const { return m_depthPrepassEnabled; }
+
+		// Requests the forward pipelines of the variant, the previous variant draws until they compile
+		void setShadingVariant(const ShadingVariant& variant);
+		// The forward render pass of a recreated swap chain, later pipeline requests are made against it
+		void setRenderPass(VkRenderPass renderPass) { m_renderPass = renderPass; }
 
 		void updateUniform(FrameInfo& frameInfo);
 	private:
 		void createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts);
 		void createPipeline(VkRenderPass renderPass);
+		void drawObjects(FrameInfo& frameInfo);
 
 		VkeDevice& m_device;
-		std::unique_ptr<VkePipeline> m_pipeline;
-		VkPipelineLayout m_pipelineLayout;
+		PipelineHandle m_pipeline;
+		PipelineHandle m_depthPrepassPipeline;
+		PipelineHandle m_depthEqualPipeline;
+		PipelineHandle m_gbufferPipeline;
+		VkPipelineLayout m_pipelineLayout; // Owned by the pipeline registry
+		VkShaderStageFlags m_pushConstantStages = 0;
+		VkRenderPass m_renderPass;
+
+		bool m_depthPrepassEnabled = false;
+		ShadingVariant m_shadingVariant;
 	};
 }
\ No newline at end of file
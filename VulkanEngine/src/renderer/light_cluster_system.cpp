@@ -0,0 +1,158 @@
+#include "light_cluster_system.hpp"
+
+#define MIN_CLUSTER_LIGHTS 256
+
+namespace vke {
+    VkeLightClusterSystem::VkeLightClusterSystem(VkeDevice& device, std::vector<VkDescriptorSetLayout>& setLayouts) : m_device{ device } {
+        createPipelineLayout(setLayouts);
+        createPipeline();
+    }
+
+    VkeLightClusterSystem::~VkeLightClusterSystem() { }
+
+    void VkeLightClusterSystem::buildClusterDescriptorSets(VkeCore& core, uint32_t framesInFlight) {
+        m_infoBuffers.resize(framesInFlight);
+        m_lightBuffers.resize(framesInFlight);
+        m_gridBuffers.resize(framesInFlight);
+        m_indexBuffers.resize(framesInFlight);
+
+        // The grid is built on the async compute queue and read by the forward pass, every buffer is shared
+        for (int i = 0; i < (int)framesInFlight; i++) {
+            m_infoBuffers[i] = std::make_unique<VkeBuffer>(
+                m_device,
+                sizeof(ClusterInfo),
+                1,
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                1,
+                true
+                );
+            m_infoBuffers[i]->map();
+
+            m_lightBuffers[i] = std::make_unique<VkeBuffer>(
+                m_device,
+                sizeof(PointLight),
+                MIN_CLUSTER_LIGHTS,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                1,
+                true
+                );
+            m_lightBuffers[i]->map();
+
+            // Written and read on the GPU only
+            m_gridBuffers[i] = std::make_unique<VkeBuffer>(
+                m_device,
+                sizeof(uint32_t),
+                CLUSTER_COUNT,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                1,
+                true
+                );
+
+            m_indexBuffers[i] = std::make_unique<VkeBuffer>(
+                m_device,
+                sizeof(uint32_t),
+                CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                1,
+                true
+                );
+
+            auto infoBuffer = m_infoBuffers[i]->descriptorInfo();
+            auto lightBuffer = m_lightBuffers[i]->descriptorInfo();
+            auto gridBuffer = m_gridBuffers[i]->descriptorInfo();
+            auto indexBuffer = m_indexBuffers[i]->descriptorInfo();
+
+            VkeDescriptorWriter(*core.clusterSetLayout, *core.descriptorAllocator)
+                .writeBuffer(0, &infoBuffer)
+                .writeBuffer(1, &lightBuffer)
+                .writeBuffer(2, &gridBuffer)
+                .writeBuffer(3, &indexBuffer)
+                .build(core.clusterSet[i]);
+        }
+
+        core.descriptorSets[2] = core.clusterSet;
+    }
+
+    void VkeLightClusterSystem::updateDescriptors(FrameInfo& frameInfo, VkeCore& core, const std::vector<PointLight>& lights, VkExtent2D extent) {
+        uint32_t lightCount = static_cast<uint32_t>(lights.size());
+        reserveLights(core, frameInfo.frameIndex, lightCount);
+
+        if (lightCount > 0) {
+            auto& lightBuffer = m_lightBuffers[frameInfo.frameIndex];
+            lightBuffer->writeToBuffer((void*)lights.data(), lightCount * sizeof(PointLight));
+            lightBuffer->flush();
+        }
+
+        ClusterInfo info{};
+        info.inverseProjection = glm::inverse(frameInfo.camera.getProjection());
+        info.view = frameInfo.camera.getView();
+        info.gridSize = glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, MAX_LIGHTS_PER_CLUSTER);
+        info.screenSize = glm::vec2(extent.width, extent.height);
+        info.zNear = frameInfo.camera.zNear;
+        info.zFar = frameInfo.camera.zFar;
+        info.lightCount = lightCount;
+
+        m_infoBuffers[frameInfo.frameIndex]->writeToBuffer(&info);
+        m_infoBuffers[frameInfo.frameIndex]->flush();
+    }
+
+    void VkeLightClusterSystem::reserveLights(VkeCore& core, int frameIndex, uint32_t lightCount) {
+        auto& lightBuffer = m_lightBuffers[frameIndex];
+        if (lightBuffer->getInstanceCount() >= lightCount)
+            return;
+
+        uint32_t capacity = lightBuffer->getInstanceCount();
+        while (capacity < lightCount) {
+            capacity *= 2;
+        }
+
+        // This frame's slot has been waited on, neither the buffer nor the set are in use by the GPU
+        lightBuffer = std::make_unique<VkeBuffer>(
+            m_device,
+            sizeof(PointLight),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            1,
+            true
+            );
+        lightBuffer->map();
+
+        auto lightBufferInfo = lightBuffer->descriptorInfo();
+        VkeDescriptorWriter(*core.clusterSetLayout, *core.descriptorAllocator)
+            .writeBuffer(1, &lightBufferInfo)
+            .overwrite(core.clusterSet[frameIndex]);
+    }
+
+    void VkeLightClusterSystem::dispatch(FrameInfo& frameInfo) {
+        m_pipeline->bind(frameInfo.commandBuffer);
+        vkCmdBindDescriptorSets(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            m_pipelineLayout,
+            0,
+            static_cast<uint32_t>(frameInfo.descriptorSets.size()),
+            frameInfo.descriptorSets.data(),
+            0,
+            nullptr);
+
+        uint32_t groupCount = (CLUSTER_COUNT + CLUSTER_LOCAL_SIZE - 1) / CLUSTER_LOCAL_SIZE;
+        vkCmdDispatch(frameInfo.commandBuffer, groupCount, 1, 1);
+    }
+
+    void VkeLightClusterSystem::createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts) {
+        m_pipelineLayout = m_device.pipelineRegistry().getPipelineLayout({ "light_cluster.comp.spv" }, setLayouts).layout;
+    }
+
+    void VkeLightClusterSystem::createPipeline() {
+        assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        m_pipeline = m_device.pipelineRegistry().requestComputePipeline(
+            "light_cluster.comp.spv",
+            m_pipelineLayout);
+    }
+}
\ No newline at end of file
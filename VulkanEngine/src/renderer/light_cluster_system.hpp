@@ -0,0 +1,65 @@
+#pragma once
+// REFERENCE MATERIAL: Olsson et al. "Clustered Deferred and Forward Shading"
+#include "../core/vke_pipeline_registry.hpp"
+#include "../core/vke_frame_info.hpp"
+#include "../core/vke_descriptors.hpp"
+#include "../core/vke_buffer.hpp"
+#include "../core/vke_core.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+// Froxel grid, screen tiles in x/y and exponential depth slices in z
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define MAX_LIGHTS_PER_CLUSTER 128
+#define CLUSTER_LOCAL_SIZE 64
+
+namespace vke {
+	// Binds point lights into the froxel grid with a compute pass, the forward shader only loops over its cluster's list
+	class VkeLightClusterSystem {
+	public:
+		VkeLightClusterSystem(VkeDevice& device, std::vector<VkDescriptorSetLayout>& setLayouts);
+		~VkeLightClusterSystem();
+
+		VkeLightClusterSystem(const VkeLightClusterSystem&) = delete;
+		VkeLightClusterSystem& operator=(const VkeLightClusterSystem&) = delete;
+
+		void buildClusterDescriptorSets(VkeCore& core, uint32_t framesInFlight);
+		void updateDescriptors(FrameInfo& frameInfo, VkeCore& core, const std::vector<PointLight>& lights, VkExtent2D extent);
+
+		// Must be recorded outside of a render pass, only touches the per frame cluster buffers so it can run on the
+		// async compute queue. The render graph makes the light grid visible to its readers
+		void dispatch(FrameInfo& frameInfo);
+
+	private:
+		void createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts);
+		void createPipeline();
+		void reserveLights(VkeCore& core, int frameIndex, uint32_t lightCount);
+
+		// Mirrors ClusterInfo in light_cluster.comp and simple_shader.frag (std140)
+		struct ClusterInfo {
+			glm::mat4 inverseProjection{ 1.0f };
+			glm::mat4 view{ 1.0f };
+			glm::uvec4 gridSize{ 0 };
+			glm::vec2 screenSize{ 0.0f };
+			float zNear;
+			float zFar;
+			uint32_t lightCount;
+			uint32_t padding[3];
+		};
+
+		VkeDevice& m_device;
+		VkPipelineLayout m_pipelineLayout; // Owned by the pipeline registry
+		PipelineHandle m_pipeline;
+
+		// Per frame in flight
+		std::vector<std::unique_ptr<VkeBuffer>> m_infoBuffers;
+		std::vector<std::unique_ptr<VkeBuffer>> m_lightBuffers;
+		std::vector<std::unique_ptr<VkeBuffer>> m_gridBuffers;
+		std::vector<std::unique_ptr<VkeBuffer>> m_indexBuffers;
+	};
+}
\ No newline at end of file
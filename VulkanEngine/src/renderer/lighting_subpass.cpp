@@ -0,0 +1,151 @@
+#include "lighting_subpass.hpp"
+
+#define INPUT_ATTACHMENT_SET 4
+
+namespace vke {
+    static const std::vector<std::string> LIGHTING_SHADERS = {
+        "fullscreen.vert.spv", "deferred_ambient.frag.spv", "deferred_light_volume.vert.spv", "deferred_light_volume.frag.spv"
+    };
+
+    LightingSubpass::LightingSubpass(VkeDevice& device, VkeSwapChain& swapChain, uint32_t subpass, std::vector<VkDescriptorSetLayout>& setLayouts)
+        : m_device{ device }, m_renderPass{ swapChain.getDeferredRenderPass() }, m_subpass{ subpass } {
+        // Albedo, normal and depth input attachments
+        m_pushInputs = device.pushDescriptorsSupported();
+        m_inputSetLayout = device.pipelineRegistry().getSetLayout(
+            LIGHTING_SHADERS,
+            INPUT_ATTACHMENT_SET,
+            m_pushInputs ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0);
+        createPipelineLayout(setLayouts);
+
+        VkeDescriptorUpdateTemplate::Builder templateBuilder(device, *m_inputSetLayout);
+        templateBuilder
+            .addEntry(0, offsetof(InputAttachments, albedo))
+            .addEntry(1, offsetof(InputAttachments, normal))
+            .addEntry(2, offsetof(InputAttachments, depth));
+        if (m_pushInputs) {
+            templateBuilder.setPushTarget(VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, INPUT_ATTACHMENT_SET);
+        }
+        m_inputTemplate = templateBuilder.build();
+
+        createPipelines(swapChain.getDeferredRenderPass(), subpass);
+        updateInputAttachments(swapChain);
+    }
+
+    LightingSubpass::~LightingSubpass() { }
+
+    void LightingSubpass::updateInputAttachments(VkeSwapChain& swapChain) {
+        m_inputAttachments.resize(swapChain.imageCount());
+        for (int i = 0; i < (int)swapChain.imageCount(); i++) {
+            InputAttachments& inputs = m_inputAttachments[i];
+            inputs.albedo = { VK_NULL_HANDLE, swapChain.getAlbedoImageView(i), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+            inputs.normal = { VK_NULL_HANDLE, swapChain.getNormalImageView(i), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+            inputs.depth = { VK_NULL_HANDLE, swapChain.getDepthImageView(i), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+        }
+    }
+
+    void LightingSubpass::draw(FrameInfo& frameInfo, uint32_t imageIndex, uint32_t lightCount) {
+        vkCmdBindDescriptorSets(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            m_pipelineLayout,
+            0,
+            static_cast<uint32_t>(frameInfo.descriptorSets.size()),
+            frameInfo.descriptorSets.data(),
+            0,
+            nullptr);
+
+        if (m_pushInputs) {
+            m_inputTemplate->push(frameInfo.commandBuffer, &m_inputAttachments[imageIndex]);
+        }
+        else {
+            // Transient, frames recorded before a swap chain recreation keep their sets for the old attachments
+            VkDescriptorSet inputSet;
+            if (!frameInfo.frameDescriptorAllocator.allocate(m_inputSetLayout->getDescriptorSetLayout(), inputSet)) {
+                throw std::runtime_error("failed to allocate input attachment descriptor set!");
+            }
+            m_inputTemplate->update(inputSet, &m_inputAttachments[imageIndex]);
+            vkCmdBindDescriptorSets(
+                frameInfo.commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                m_pipelineLayout,
+                INPUT_ATTACHMENT_SET,
+                1,
+                &inputSet,
+                0,
+                nullptr);
+        }
+
+        // Fullscreen triangle
+        m_ambientPipeline->bind(frameInfo.commandBuffer);
+        vkCmdDraw(frameInfo.commandBuffer, 3, 1, 0, 0);
+
+        // One cube per light, 36 vertices generated in the vertex shader
+        if (lightCount > 0) {
+            m_lightVolumePipeline->bind(frameInfo.commandBuffer);
+            vkCmdDraw(frameInfo.commandBuffer, 36, lightCount, 0, 0);
+        }
+    }
+
+    void LightingSubpass::createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts) {
+        // Input attachment set goes after the shared ones, passed explicitly since the reflected layout
+        // would lack the push descriptor flag
+        std::vector<VkDescriptorSetLayout> layouts = setLayouts;
+        assert(layouts.size() == INPUT_ATTACHMENT_SET && "Input attachment set must follow the shared sets");
+        layouts.push_back(m_inputSetLayout->getDescriptorSetLayout());
+        m_pipelineLayout = m_device.pipelineRegistry().getPipelineLayout(LIGHTING_SHADERS, layouts).layout;
+    }
+
+    void LightingSubpass::setShadingVariant(const ShadingVariant& variant) {
+        m_shadingVariant = variant;
+        createPipelines(m_renderPass, m_subpass);
+    }
+
+    void LightingSubpass::createPipelines(VkRenderPass renderPass, uint32_t subpass) {
+        assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        // Every covered pixel exactly once, no depth test
+        PipelineConfigInfo ambientConfig{};
+        VkePipeline::defaultPipelineConfigInfo(ambientConfig);
+        ambientConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+        ambientConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        ambientConfig.renderPass = renderPass;
+        ambientConfig.subpass = subpass;
+        ambientConfig.pipelineLayout = m_pipelineLayout;
+        m_shadingVariant.apply(ambientConfig);
+        m_ambientPipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "fullscreen.vert.spv",
+            "deferred_ambient.frag.spv",
+            ambientConfig,
+            true,
+            m_ambientPipeline);
+
+        // Back faces of the volume pass where scene depth lies in front of them. Works with the camera inside
+        // the volume and skips the sky, which stays at the cleared depth of 1
+        PipelineConfigInfo volumeConfig{};
+        VkePipeline::defaultPipelineConfigInfo(volumeConfig);
+        volumeConfig.rasterizationInfo.cullMode = VK_CULL_MODE_FRONT_BIT;
+        volumeConfig.rasterizationInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        volumeConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+        volumeConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+        // Additive, each light adds to the ambient result
+        volumeConfig.colorBlendAttachment.blendEnable = VK_TRUE;
+        volumeConfig.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        volumeConfig.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        volumeConfig.colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        volumeConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        volumeConfig.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        volumeConfig.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+        volumeConfig.renderPass = renderPass;
+        volumeConfig.subpass = subpass;
+        volumeConfig.pipelineLayout = m_pipelineLayout;
+        m_shadingVariant.apply(volumeConfig);
+        m_lightVolumePipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "deferred_light_volume.vert.spv",
+            "deferred_light_volume.frag.spv",
+            volumeConfig,
+            true,
+            m_lightVolumePipeline);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../core/vke_device.hpp"
+#include "../core/vke_pipeline_registry.hpp"
+#include "../core/vke_frame_info.hpp"
+#include "../core/vke_descriptors.hpp"
+#include "../core/vke_swap_chain.hpp"
+#include "../renderer/shading_variant.hpp"
+
+// std
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace vke {
+	// Second subpass of the deferred render pass. Reads the G-buffer as input attachments, shades ambient and
+	// directional light once per pixel and adds every point light as an instanced cube covering its range
+	class LightingSubpass {
+		// Packed for the update template, bindings 0, 1 and 2 of the input attachment set
+		struct InputAttachments {
+			VkDescriptorImageInfo albedo;
+			VkDescriptorImageInfo normal;
+			VkDescriptorImageInfo depth;
+		};
+
+	public:
+		LightingSubpass(VkeDevice& device, VkeSwapChain& swapChain, uint32_t subpass, std::vector<VkDescriptorSetLayout>& setLayouts);
+		~LightingSubpass();
+
+		LightingSubpass(const LightingSubpass&) = delete;
+		LightingSubpass& operator=(const LightingSubpass&) = delete;
+
+		// Input attachments are per swap chain image, rebuild after the swap chain is recreated
+		void updateInputAttachments(VkeSwapChain& swapChain);
+		void draw(FrameInfo& frameInfo, uint32_t imageIndex, uint32_t lightCount);
+
+		// Requests both lighting pipelines of the variant, the previous variant draws until they compile
+		void setShadingVariant(const ShadingVariant& variant);
+		// The deferred render pass of a recreated swap chain, later pipeline requests are made against it
+		void setRenderPass(VkRenderPass renderPass) { m_renderPass = renderPass; }
+
+	private:
+		void createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts);
+		void createPipelines(VkRenderPass renderPass, uint32_t subpass);
+
+		VkeDevice& m_device;
+		VkPipelineLayout m_pipelineLayout; // Owned by the pipeline registry
+		VkRenderPass m_renderPass;
+		uint32_t m_subpass;
+		ShadingVariant m_shadingVariant;
+		PipelineHandle m_ambientPipeline;
+		PipelineHandle m_lightVolumePipeline;
+
+		// set = 4, one per swap chain image. Pushed at draw time with push descriptors, otherwise written into a set
+		// from the frame's transient allocator
+		bool m_pushInputs;
+		std::shared_ptr<VkeDescriptorSetLayout> m_inputSetLayout;
+		std::unique_ptr<VkeDescriptorUpdateTemplate> m_inputTemplate;
+		std::vector<InputAttachments> m_inputAttachments;
+	};
+}
\ No newline at end of file
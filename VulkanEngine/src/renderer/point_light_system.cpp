@@ -1,58 +1,94 @@
 #include "point_light_system.hpp"
 
-#include <map>
+#include <cstring>
 
-namespace vke {
-    struct PointLightPushConstant {
-        glm::vec4 posiiton;
-        glm::vec4 color{};
-        float radius;
-    };
+#define MIN_LIGHT_INSTANCES 64
 
-    PointLightSystem::PointLightSystem(VkeDevice& device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout>& setLayouts) : m_device{ device } {
+namespace vke {
+    PointLightSystem::PointLightSystem(VkeDevice& device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t framesInFlight)
+        : m_device{ device } {
         createPipelineLayout(setLayouts);
-        createPipeline(renderPass);
+        m_pipeline = createPipeline(renderPass, 0);
+
+        m_instanceBuffers.resize(framesInFlight);
+        for (int i = 0; i < (int)framesInFlight; i++) {
+            reserveInstances(i, MIN_LIGHT_INSTANCES);
+        }
     }
 
-    PointLightSystem::~PointLightSystem() { vkDestroyPipelineLayout(m_device.device(), m_pipelineLayout, nullptr); }
+    PointLightSystem::~PointLightSystem() { }
 
     void PointLightSystem::updateDescriptors(FrameInfo& frameInfo, UniformBufferScene& ubs) {
-        int lightIndex = 0;
-        auto rotateLight = glm::rotate(glm::mat4(1.0f), frameInfo.deltaTime, { 0.0f, -1.0f, 0.0f });
-
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
-            if (obj.pointLight == nullptr)
-                continue;
-
-            assert(lightIndex < MAX_LIGHTS && "Point lights exceeding maximum!");
-
-            // update (temp)
-            //obj.transform->setTranslation(glm::vec3(rotateLight * glm::vec4(obj.transform->getTranslation(), 1.0f)));
-            obj.transform->translation = glm::vec3(rotateLight * glm::vec4(obj.transform->translation, 1.0f));
-
-            ubs.pointLights[lightIndex].position = glm::vec4(obj.transform->translation, 1.0f);
-            ubs.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-            lightIndex += 1;
+        m_lights.clear();
+        m_shadowCandidates.clear();
+
+        for (const RenderPointLight& obj : frameInfo.renderPacket.pointLights) {
+            // Inverse square falloff reaches the cutoff at sqrt(I / cutoff)
+            float brightest = std::max(obj.color.r, std::max(obj.color.g, obj.color.b));
+            float range = glm::sqrt(obj.intensity * brightest / LIGHT_CUTOFF);
+
+            PointLight light{};
+            light.position = glm::vec4(obj.position, range);
+            light.color = glm::vec4(obj.color, obj.intensity);
+            if (obj.castsShadows) {
+                m_shadowCandidates.push_back(static_cast<uint32_t>(m_lights.size()));
+            }
+            m_lights.push_back(light);
         }
         
-        ubs.numLights = lightIndex;
+        ubs.numLights = static_cast<int>(m_lights.size());
     }
 
-    void PointLightSystem::render(FrameInfo& frameInfo) {
-        // light sorting (temp) for point light halo
-        std::map<float, VkeGameObject::id_t> sorted;
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
-            if (obj.pointLight == nullptr) continue;
+    void PointLightSystem::initDeferredPipeline(VkRenderPass renderPass, uint32_t subpass) {
+        m_deferredPipeline = createPipeline(renderPass, subpass);
+    }
 
-            // distance calculation
-            auto offset = frameInfo.camera.position - obj.transform->translation;
+    void PointLightSystem::render(FrameInfo& frameInfo, bool deferred) {
+        // Gather visible halos, keyed by camera distance
+        uint32_t count = 0;
+        for (const RenderPointLight& obj : frameInfo.renderPacket.pointLights) {
+            float radius = obj.radius;
+            auto offset = obj.position - frameInfo.camera.position;
+            if (glm::dot(offset, frameInfo.camera.forward) < -radius) continue;
+
+            if (count == m_instances.size()) {
+                m_instances.resize(std::max<size_t>(MIN_LIGHT_INSTANCES, m_instances.size() * 2));
+                m_sortKeys.resize(m_instances.size());
+            }
+
+            PointLightInstance& instance = m_instances[count];
+            instance.position = glm::vec4(obj.position, 1.0f);
+            instance.color = glm::vec4(obj.color, obj.intensity);
+            instance.radius = radius;
+
+            // Squared distances are non negative, so their IEEE bits already sort like unsigned integers
             float distSquared = glm::dot(offset, offset);
-            sorted[distSquared] = obj.getId();
+            uint32_t key;
+            std::memcpy(&key, &distSquared, sizeof(key));
+            m_sortKeys[count] = key;
+            count++;
+        }
+
+        if (count == 0)
+            return;
+
+        sortBackToFront(count);
+
+        reserveInstances(frameInfo.frameIndex, count);
+        auto& instanceBuffer = m_instanceBuffers[frameInfo.frameIndex];
+        auto* mapped = static_cast<PointLightInstance*>(instanceBuffer->getMappedMemory());
+        for (uint32_t i = 0; i < count; i++) {
+            mapped[i] = m_instances[m_sortIndices[i]];
         }
+        instanceBuffer->flush();
 
-        m_pipeline->bind(frameInfo.commandBuffer);
+        if (deferred) {
+            assert(m_deferredPipeline != nullptr && "Deferred halo pipeline was never initialized");
+            m_deferredPipeline->bind(frameInfo.commandBuffer);
+        }
+        else {
+            m_pipeline->bind(frameInfo.commandBuffer);
+        }
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -63,61 +99,104 @@ namespace vke {
             0,
             nullptr);
 
-        // Iterate through sorted lights in reverse order
-        for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-            auto& obj = frameInfo.gameObjects.at(it->second);
-
-            PointLightPushConstant push{};
-            push.posiiton = glm::vec4(obj.transform->translation, 1.0f);
-            push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-            push.radius = obj.transform->scale.x;
-
-            vkCmdPushConstants(
-                frameInfo.commandBuffer,
-                m_pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(PointLightPushConstant),
-                &push
-                );
-
-            vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+        VkBuffer buffers[] = { instanceBuffer->getBuffer() };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, buffers, offsets);
+        vkCmdDraw(frameInfo.commandBuffer, 6, count, 0, 0);
+    }
+
+    // LSD radix sort, 8 bits per pass, of m_sortKeys into m_sortIndices (farthest first for blending)
+    void PointLightSystem::sortBackToFront(uint32_t count) {
+        if (m_sortIndices.size() < count) {
+            m_sortIndices.resize(m_sortKeys.size());
+            m_sortKeysScratch.resize(m_sortKeys.size());
+            m_sortIndicesScratch.resize(m_sortKeys.size());
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            m_sortKeys[i] = ~m_sortKeys[i];
+            m_sortIndices[i] = i;
+        }
+
+        uint32_t* keys = m_sortKeys.data();
+        uint32_t* indices = m_sortIndices.data();
+        uint32_t* keysOut = m_sortKeysScratch.data();
+        uint32_t* indicesOut = m_sortIndicesScratch.data();
+
+        for (uint32_t shift = 0; shift < 32; shift += 8) {
+            uint32_t offsets[256] = {};
+            for (uint32_t i = 0; i < count; i++) {
+                offsets[(keys[i] >> shift) & 0xFF]++;
+            }
+
+            uint32_t sum = 0;
+            for (uint32_t& offset : offsets) {
+                uint32_t bucketSize = offset;
+                offset = sum;
+                sum += bucketSize;
+            }
+
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t destination = offsets[(keys[i] >> shift) & 0xFF]++;
+                keysOut[destination] = keys[i];
+                indicesOut[destination] = indices[i];
+            }
+
+            std::swap(keys, keysOut);
+            std::swap(indices, indicesOut);
         }
+        // Four passes, the sorted result ends up back in m_sortKeys / m_sortIndices
     }
 
-    void PointLightSystem::createPipeline(VkRenderPass renderPass) {
+    void PointLightSystem::reserveInstances(int frameIndex, uint32_t instanceCount) {
+        auto& instanceBuffer = m_instanceBuffers[frameIndex];
+        if (instanceBuffer != nullptr && instanceBuffer->getInstanceCount() >= instanceCount)
+            return;
+
+        // This frame's slot has been waited on, the old buffer is no longer in use by the GPU
+        uint32_t capacity = instanceBuffer == nullptr ? instanceCount : instanceBuffer->getInstanceCount();
+        while (capacity < instanceCount) {
+            capacity *= 2;
+        }
+
+        instanceBuffer = std::make_unique<VkeBuffer>(
+            m_device,
+            sizeof(PointLightInstance),
+            capacity,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        instanceBuffer->map();
+    }
+
+    PipelineHandle PointLightSystem::createPipeline(VkRenderPass renderPass, uint32_t subpass) {
         assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
         PipelineConfigInfo pipelineConfig{};
         VkePipeline::defaultPipelineConfigInfo(pipelineConfig);
         VkePipeline::enableAlphaBlending(pipelineConfig);
-        pipelineConfig.attributeDescriptions.clear();
-        pipelineConfig.bindingDescriptions.clear();
+
+        // Billboard corners come from gl_VertexIndex, the light itself is per instance
+        pipelineConfig.bindingDescriptions = { { 0, sizeof(PointLightInstance), VK_VERTEX_INPUT_RATE_INSTANCE } };
+        pipelineConfig.attributeDescriptions = {
+            { 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(PointLightInstance, position) },
+            { 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(PointLightInstance, color) },
+            { 2, 0, VK_FORMAT_R32_SFLOAT, offsetof(PointLightInstance, radius) },
+        };
+
+        // Halos are sorted, blended and drawn last, they only test against depth. Also lets the
+        // deferred lighting subpass keep its depth attachment read only
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
 
         pipelineConfig.renderPass = renderPass;
+        pipelineConfig.subpass = subpass;
         pipelineConfig.pipelineLayout = m_pipelineLayout;
-        m_pipeline = std::make_unique<VkePipeline>(
-            m_device,
-            "VulkanEngine/src/shaders/point_light.vert.spv",
-            "VulkanEngine/src/shaders/point_light.frag.spv",
+        return m_device.pipelineRegistry().requestGraphicsPipeline(
+            "point_light.vert.spv",
+            "point_light.frag.spv",
             pipelineConfig);
     }
 
     void PointLightSystem::createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(PointLightPushConstant);
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) !=
-            VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
+        m_pipelineLayout = m_device.pipelineRegistry().getPipelineLayout({ "point_light.vert.spv", "point_light.frag.spv" }, setLayouts).layout;
     }
 }
\ No newline at end of file
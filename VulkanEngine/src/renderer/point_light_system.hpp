@@ -1,8 +1,9 @@
 #pragma once
 
 #include "../core/vke_device.hpp"
-#include "../core/vke_pipeline.hpp"
+#include "../core/vke_pipeline_registry.hpp"
 #include "../core/vke_frame_info.hpp"
+#include "../core/vke_swap_chain.hpp"
 #include "../scene/vke_game_object.hpp"
 #include "../scene/components/vke_camera.hpp"
 
@@ -12,45 +13,59 @@
 #include <array>
 #include <stdexcept>
 
-#define MAX_LIGHTS 10
+// Contribution below which a light is treated as out of range when binning
+#define LIGHT_CUTOFF 0.01f
 
 namespace vke {
 	class PointLightSystem {
 	public:
-		PointLightSystem(VkeDevice& device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout>& setLayouts);
+		PointLightSystem(VkeDevice& device, VkRenderPass renderPass, std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t framesInFlight);
 		~PointLightSystem();
 
 		PointLightSystem(const PointLightSystem&) = delete;
 		PointLightSystem& operator=(const PointLightSystem&) = delete;
 
 		void updateDescriptors(FrameInfo& frameInfo, UniformBufferScene& ubs);
-		void render(FrameInfo& frameInfo);
+		// Halos drawn inside the deferred lighting subpass use their own pipeline
+		void initDeferredPipeline(VkRenderPass renderPass, uint32_t subpass);
+		void render(FrameInfo& frameInfo, bool deferred = false);
+
+		// Lights gathered by the last updateDescriptors call, uploaded by the light cluster system
+		const std::vector<PointLight>& getLights() const { return m_lights; }
+		std::vector<PointLight>& getLights() { return m_lights; }
+		// Indices into getLights() of lights that want a shadow, the point shadow system assigns the slots
+		const std::vector<uint32_t>& getShadowCandidates() const { return m_shadowCandidates; }
 
 	private:
 		void createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts);
-		void createPipeline(VkRenderPass renderPass);
+		PipelineHandle createPipeline(VkRenderPass renderPass, uint32_t subpass);
+		void reserveInstances(int frameIndex, uint32_t instanceCount);
+		void sortBackToFront(uint32_t count);
 
 		VkeDevice& m_device;
-		std::unique_ptr<VkePipeline> m_pipeline;
-		VkPipelineLayout m_pipelineLayout;
+		PipelineHandle m_pipeline;
+		PipelineHandle m_deferredPipeline;
+		VkPipelineLayout m_pipelineLayout; // Owned by the pipeline registry
+
+		std::vector<PointLight> m_lights;
+		std::vector<uint32_t> m_shadowCandidates;
 
-		struct PointLight {
+		// Per instance vertex input of the halo billboards, see point_light.vert
+		struct PointLightInstance {
 			glm::vec4 position{};
 			glm::vec4 color{};
+			float radius;
 		};
 
-		struct DirectionalLight {
-			glm::vec4 position{};
-			glm::mat4 viewProjection{ 1.0f };
-		};
+		// One instance buffer per frame in flight, grown on demand
+		std::vector<std::unique_ptr<VkeBuffer>> m_instanceBuffers;
 
-		struct UniformBufferLights {
-			glm::mat4 inverseView{ 1.0f };
-			glm::vec4 ambientLightColor{ 1.0f, 1.0f, 1.0f, 0.02f };
-			PointLight pointLights[MAX_LIGHTS];
-			DirectionalLight directionalLight;
-			int numLights;
-		}m_UBL;
+		// Sort scratch space, reused every frame so sorting never allocates once the light count settles
+		std::vector<PointLightInstance> m_instances;
+		std::vector<uint32_t> m_sortKeys;
+		std::vector<uint32_t> m_sortIndices;
+		std::vector<uint32_t> m_sortKeysScratch;
+		std::vector<uint32_t> m_sortIndicesScratch;
 
 		std::unique_ptr<VkeDescriptorPool>		m_lightPool;
 		std::unique_ptr<VkeDescriptorSetLayout> m_lightLayout;
@@ -0,0 +1,275 @@
+#include "point_shadow_system.hpp"
+#include <algorithm>
+#include <functional>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace vke {
+    struct PointShadowPushConstant {
+        glm::mat4 modelMatrix{ 1.0f };
+        int shadowIndex;
+        uint32_t faceMask; // Faces the object can touch, the rest are clipped in point_shadow.vert
+    };
+
+    // Cube face order +X -X +Y -Y +Z -Z, must match pointShadow in shadow_sampling.glsl
+    static const glm::vec3 faceDirections[POINT_SHADOW_FACES] = {
+        { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+    };
+    static const glm::vec3 faceUps[POINT_SHADOW_FACES] = {
+        { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+        { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+    };
+
+    VkePointShadowSystem::VkePointShadowSystem(VkeDevice& device) : m_device{ device } { }
+
+    VkePointShadowSystem::~VkePointShadowSystem() { }
+
+    void VkePointShadowSystem::initFrameBuffer() {
+        m_frameBuffer = std::make_unique<VkeFrameBuffer>(m_device);
+        m_frameBuffer->width = POINT_SHADOW_ATLAS_DIM;
+        m_frameBuffer->height = POINT_SHADOW_ATLAS_DIM;
+        m_frameBuffer->viewCount = POINT_SHADOW_FACES;
+
+        if (m_frameBuffer->createSampler(VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create point shadow sampler!");
+        }
+
+        AttachmentCreateInfo depthAttachment{};
+        depthAttachment.format = DEPTH_FORMAT;
+        depthAttachment.width = m_frameBuffer->width;
+        depthAttachment.height = m_frameBuffer->height;
+        depthAttachment.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        depthAttachment.imageSampleCount = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.layerCount = POINT_SHADOW_FACES;
+        m_frameBuffer->addAttachment(depthAttachment);
+        m_frameBuffer->createRenderPass();
+    }
+
+    VkDescriptorImageInfo VkePointShadowSystem::getFrameBufferImageInfo() {
+        VkDescriptorImageInfo descriptorImageInfo{};
+        descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        descriptorImageInfo.imageView = m_frameBuffer->attachments[0].view;
+        descriptorImageInfo.sampler = m_frameBuffer->sampler;
+        return descriptorImageInfo;
+    }
+
+    void VkePointShadowSystem::updateDescriptors(FrameInfo& frameInfo, UniformBufferScene& ubs, std::vector<PointLight>& lights, const std::vector<uint32_t>& candidates) {
+        // Fraction of the screen the light's range covers, 1 once the camera is inside it
+        glm::vec3 cameraPosition = frameInfo.camera.position;
+        m_sortedCandidates.clear();
+        for (uint32_t index : candidates) {
+            float range = lights[index].position.w;
+            float distance = glm::length(glm::vec3(lights[index].position) - cameraPosition);
+            m_sortedCandidates.push_back({ range / std::max(distance, range), index });
+        }
+        std::sort(m_sortedCandidates.begin(), m_sortedCandidates.end(), std::greater<std::pair<float, uint32_t>>());
+        if (m_sortedCandidates.size() > MAX_SHADOWED_POINT_LIGHTS) {
+            m_sortedCandidates.resize(MAX_SHADOWED_POINT_LIGHTS);
+        }
+
+        // Smallest power of two tile covering the light's share of the largest tile, never increasing down the sorted list
+        m_tiles.clear();
+        for (auto& candidate : m_sortedCandidates) {
+            uint32_t size = POINT_SHADOW_MIN_TILE;
+            while (size < POINT_SHADOW_MAX_TILE && size < candidate.first * POINT_SHADOW_MAX_TILE) {
+                size *= 2;
+            }
+            m_tiles.push_back({ 0, 0, size });
+        }
+        packTiles();
+
+        m_shadowedLights.clear();
+        for (size_t slot = 0; slot < m_tiles.size(); slot++) {
+            PointLight& light = lights[m_sortedCandidates[slot].second];
+            light.shadowIndex = static_cast<int>(slot);
+            m_shadowedLights.push_back(light.position);
+
+            ShadowTile& tile = m_tiles[slot];
+            ubs.pointShadowTiles[slot] = glm::vec4(tile.x, tile.y, tile.size, tile.size) / static_cast<float>(POINT_SHADOW_ATLAS_DIM);
+
+            // 90 degree faces tile the sphere exactly, the light range is the far plane
+            glm::vec3 lightPosition = glm::vec3(light.position);
+            glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, POINT_SHADOW_NEAR, light.position.w);
+            for (int face = 0; face < POINT_SHADOW_FACES; face++) {
+                glm::mat4 faceView = glm::lookAt(lightPosition, lightPosition + faceDirections[face], faceUps[face]);
+                ubs.pointShadowMatrices[slot * POINT_SHADOW_FACES + face] = faceProjection * faceView;
+            }
+        }
+    }
+
+    void VkePointShadowSystem::packTiles() {
+        // Work in units of the smallest tile, the atlas holds atlasUnits^2 of them
+        const uint32_t atlasUnits = POINT_SHADOW_ATLAS_DIM / POINT_SHADOW_MIN_TILE;
+        auto usedUnits = [&]() {
+            uint32_t used = 0;
+            for (auto& tile : m_tiles) {
+                uint32_t units = tile.size / POINT_SHADOW_MIN_TILE;
+                used += units * units;
+            }
+            return used;
+        };
+
+        // Over budget, shrink the least important tile that can still shrink, then drop lights
+        while (usedUnits() > atlasUnits * atlasUnits) {
+            auto shrink = std::find_if(m_tiles.rbegin(), m_tiles.rend(), [](const ShadowTile& tile) {
+                return tile.size > POINT_SHADOW_MIN_TILE;
+            });
+            if (shrink == m_tiles.rend()) {
+                m_tiles.pop_back();
+            }
+            else {
+                shrink->size /= 2;
+            }
+        }
+
+        // Tiles are powers of two sorted largest first, so walking Z order keeps every tile aligned and gap free
+        uint32_t cursor = 0;
+        for (auto& tile : m_tiles) {
+            uint32_t units = tile.size / POINT_SHADOW_MIN_TILE;
+            uint32_t x = 0, y = 0;
+            for (uint32_t bit = 0; (1u << (2 * bit)) < atlasUnits * atlasUnits; bit++) {
+                x |= ((cursor >> (2 * bit)) & 1u) << bit;
+                y |= ((cursor >> (2 * bit + 1)) & 1u) << bit;
+            }
+            tile.x = x * POINT_SHADOW_MIN_TILE;
+            tile.y = y * POINT_SHADOW_MIN_TILE;
+            cursor += units * units;
+        }
+    }
+
+    uint32_t VkePointShadowSystem::faceMask(glm::vec3 center, float radius, uint32_t slot) {
+        glm::vec3 offset = center - glm::vec3(m_shadowedLights[slot]);
+        float range = m_shadowedLights[slot].w;
+        if (glm::length(offset) - radius > range)
+            return 0;
+
+        // A face frustum is bounded by the four 45 degree planes between its axis and the two perpendicular axes
+        uint32_t mask = 0;
+        for (int face = 0; face < POINT_SHADOW_FACES; face++) {
+            glm::vec3 axis = faceDirections[face];
+            glm::vec3 side0 = faceUps[face];
+            glm::vec3 side1 = glm::cross(axis, side0);
+
+            bool inside =
+                glm::dot(offset, glm::normalize(axis + side0)) >= -radius &&
+                glm::dot(offset, glm::normalize(axis - side0)) >= -radius &&
+                glm::dot(offset, glm::normalize(axis + side1)) >= -radius &&
+                glm::dot(offset, glm::normalize(axis - side1)) >= -radius;
+            if (inside) {
+                mask |= 1u << face;
+            }
+        }
+        return mask;
+    }
+
+    void VkePointShadowSystem::render(FrameInfo& frameInfo) {
+        if (m_shadowedLights.empty())
+            return;
+
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        VkExtent2D extent{ m_frameBuffer->width, m_frameBuffer->height };
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_frameBuffer->renderPass;
+        renderPassInfo.framebuffer = m_frameBuffer->framebuffer;
+        renderPassInfo.renderArea.extent = extent;
+
+        VkClearValue clearValue{};
+        clearValue.depthStencil = { 1.0f, 0 };
+        renderPassInfo.pClearValues = &clearValue;
+        renderPassInfo.clearValueCount = 1;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdSetDepthBias(commandBuffer, depthBiasConstant, depthBiasClamp, depthBiasSlope);
+
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            m_pipelineLayout,
+            0,
+            static_cast<uint32_t>(frameInfo.descriptorSets.size()),
+            frameInfo.descriptorSets.data(),
+            0,
+            nullptr);
+        m_pipeline->bind(commandBuffer);
+
+        for (uint32_t slot = 0; slot < m_shadowedLights.size(); slot++) {
+            // The tile is the viewport in all six face layers
+            ShadowTile& tile = m_tiles[slot];
+            VkViewport viewport{};
+            viewport.x = static_cast<float>(tile.x);
+            viewport.y = static_cast<float>(tile.y);
+            viewport.width = static_cast<float>(tile.size);
+            viewport.height = static_cast<float>(tile.size);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+            VkRect2D scissor{ { static_cast<int32_t>(tile.x), static_cast<int32_t>(tile.y) }, { tile.size, tile.size } };
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+            for (const RenderObject& obj : frameInfo.renderPacket.objects) {
+                PointShadowPushConstant push{};
+                push.faceMask = faceMask(glm::vec3(obj.boundingSphere), obj.boundingSphere.w, slot);
+                if (push.faceMask == 0)
+                    continue;
+
+                push.modelMatrix = obj.modelMatrix;
+                push.shadowIndex = static_cast<int>(slot);
+
+                vkCmdPushConstants(
+                    commandBuffer,
+                    m_pipelineLayout,
+                    m_pushConstantStages,
+                    0,
+                    sizeof(PointShadowPushConstant),
+                    &push);
+
+                obj.model->bind(commandBuffer);
+                obj.model->draw(commandBuffer);
+            }
+        }
+
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    void VkePointShadowSystem::initPipeline(std::vector<VkDescriptorSetLayout>& setLayouts) {
+        createPipelineLayout(setLayouts);
+        createPipeline(m_frameBuffer->renderPass);
+    }
+
+    void VkePointShadowSystem::createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts) {
+        PipelineLayoutInfo layoutInfo = m_device.pipelineRegistry().getPipelineLayout({ "point_shadow.vert.spv", "blank.frag.spv" }, setLayouts);
+        assert(layoutInfo.pushConstantRange.size == sizeof(PointShadowPushConstant) && "PointShadowPushConstant doesn't match the shader push constant block");
+        m_pipelineLayout = layoutInfo.layout;
+        m_pushConstantStages = layoutInfo.pushConstantRange.stageFlags;
+    }
+
+    void VkePointShadowSystem::createPipeline(VkRenderPass renderPass) {
+        assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        PipelineConfigInfo pipelineConfig{};
+        VkePipeline::defaultPipelineConfigInfo(pipelineConfig);
+        VkePipeline::enablePositionOnlyInput(pipelineConfig);
+
+        pipelineConfig.colorBlendInfo.attachmentCount = 0;
+        pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        pipelineConfig.rasterizationInfo.depthBiasEnable = VK_TRUE;
+
+        pipelineConfig.dynamicStateEnables.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
+        pipelineConfig.dynamicStateInfo.pDynamicStates = pipelineConfig.dynamicStateEnables.data();
+        pipelineConfig.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(pipelineConfig.dynamicStateEnables.size());
+        pipelineConfig.dynamicStateInfo.flags = 0;
+
+        pipelineConfig.renderPass = renderPass;
+        pipelineConfig.pipelineLayout = m_pipelineLayout;
+        m_pipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "point_shadow.vert.spv",
+            "blank.frag.spv",
+            pipelineConfig);
+    }
+}
\ No newline at end of file
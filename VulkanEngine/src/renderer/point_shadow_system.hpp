@@ -0,0 +1,61 @@
+#pragma once
+#include "../core/vke_pipeline_registry.hpp"
+#include "../core/vke_frame_info.hpp"
+#include "../core/vke_frame_buffer.hpp"
+#include "shadow_map_system.hpp"
+#include <array>
+#include <vector>
+
+// Shadow atlas, POINT_SHADOW_FACES layers with one square tile per shadowed light at the same spot in every layer.
+// The atlas size is the memory budget, tiles are powers of two between the min and max tile size
+#define POINT_SHADOW_ATLAS_DIM 1024
+#define POINT_SHADOW_MIN_TILE 64
+#define POINT_SHADOW_MAX_TILE 512
+#define POINT_SHADOW_NEAR 0.05f
+
+namespace vke {
+	// Cube shadow maps for the most visible shadow casting point lights, all lights and faces drawn by one multiview pass
+	class VkePointShadowSystem {
+	public:
+		VkePointShadowSystem(VkeDevice& device);
+		~VkePointShadowSystem();
+
+		VkePointShadowSystem(const VkePointShadowSystem&) = delete;
+		VkePointShadowSystem& operator=(const VkePointShadowSystem&) = delete;
+
+		void initFrameBuffer();
+		void initPipeline(std::vector<VkDescriptorSetLayout>& setLayouts);
+		VkDescriptorImageInfo getFrameBufferImageInfo();
+		VkImage getAtlasImage() const { return m_frameBuffer->attachments[0].image; }
+		VkImageSubresourceRange getAtlasRange() const { return m_frameBuffer->attachments[0].subReourceRange; }
+
+		// Sizes an atlas tile for every candidate by screen coverage and packs them, lights that don't fit stay unshadowed
+		void updateDescriptors(FrameInfo& frameInfo, UniformBufferScene& ubs, std::vector<PointLight>& lights, const std::vector<uint32_t>& candidates);
+		// Leaves the atlas in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+		void render(FrameInfo& frameInfo);
+
+		const float depthBiasConstant = 1.25f;
+		const float depthBiasClamp = 0.0f;
+		const float depthBiasSlope = 1.75f;
+	private:
+		void createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts);
+		void createPipeline(VkRenderPass renderPass);
+		uint32_t faceMask(glm::vec3 center, float radius, uint32_t slot);
+		void packTiles();
+
+		VkeDevice& m_device;
+		VkPipelineLayout m_pipelineLayout; // Owned by the pipeline registry
+		VkShaderStageFlags m_pushConstantStages = 0;
+		PipelineHandle m_pipeline;
+		std::unique_ptr<VkeFrameBuffer> m_frameBuffer;
+
+		struct ShadowTile {
+			uint32_t x, y, size; // Texels
+		};
+
+		// Lights given a tile by the last updateDescriptors call, position w is the range
+		std::vector<glm::vec4> m_shadowedLights;
+		std::vector<ShadowTile> m_tiles;
+		std::vector<std::pair<float, uint32_t>> m_sortedCandidates; // Screen coverage, light index
+	};
+}
\ No newline at end of file
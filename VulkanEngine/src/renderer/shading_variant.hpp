@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../core/vke_pipeline.hpp"
+#include "shadow_map_system.hpp"
+
+// Specialization constant ids, see shadow_sampling.glsl and lighting.glsl
+#define SHADOW_FILTER_CONSTANT_ID 0
+#define SHADOW_AMBIENT_CONSTANT_ID 1
+#define POISSON_RADIUS_CONSTANT_ID 2
+#define SPECULAR_EXPONENT_CONSTANT_ID 3
+#define POINT_SHADOWS_CONSTANT_ID 4
+
+namespace vke {
+	// Shading features baked into the lighting pipelines as specialization constants. The driver folds disabled
+	// features away, and the pipeline registry keys every distinct variant so it is only compiled once
+	struct ShadingVariant {
+		ShadowFilter shadowFilter = ShadowFilter::HardwarePCF;
+		float shadowAmbient = 0.1f;		// Light left in full directional shadow
+		float poissonRadius = 1.5f;		// Texels, Poisson disk filter
+		float specularExponent = 512.0f;
+		bool pointShadows = true;
+
+		void apply(PipelineConfigInfo& configInfo) const {
+			VkePipeline::addSpecializationConstant(configInfo, SHADOW_FILTER_CONSTANT_ID, static_cast<uint32_t>(shadowFilter));
+			VkePipeline::addSpecializationConstant(configInfo, SHADOW_AMBIENT_CONSTANT_ID, shadowAmbient);
+			VkePipeline::addSpecializationConstant(configInfo, POISSON_RADIUS_CONSTANT_ID, poissonRadius);
+			VkePipeline::addSpecializationConstant(configInfo, SPECULAR_EXPONENT_CONSTANT_ID, specularExponent);
+			VkePipeline::addSpecializationConstant(configInfo, POINT_SHADOWS_CONSTANT_ID, pointShadows);
+		}
+	};
+}
\ No newline at end of file
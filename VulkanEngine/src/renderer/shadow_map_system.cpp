@@ -1,24 +1,54 @@
 #pragma once
 #include "shadow_map_system.hpp"
 #include <array>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
 
 namespace vke {
-    struct PushConstantData {
+    struct ShadowPushConstant {
         glm::mat4 modelMatrix{ 1.0f };
-        glm::mat4 normalMatrix{ 1.0f };
+        int cascadeIndex;
     };
 
+    const char* shadowFilterName(ShadowFilter filter) {
+        switch (filter) {
+        case ShadowFilter::HardwarePCF: return "Hardware PCF";
+        case ShadowFilter::PoissonDisk: return "Poisson disk";
+        case ShadowFilter::PCSS: return "PCSS";
+        case ShadowFilter::EVSM: return "EVSM";
+        default: return "Unknown";
+        }
+    }
+
     VkeShadowMapSystem::VkeShadowMapSystem(VkeDevice& device) : m_device{ device } { }
 
     VkeShadowMapSystem::~VkeShadowMapSystem() {
-        vkDestroyPipelineLayout(m_device.device(), m_pipelineLayout, nullptr);
+        vkDestroySampler(m_device.device(), m_depthSampler, nullptr);
+        vkDestroySampler(m_device.device(), m_momentsSampler, nullptr);
+        vkDestroyImageView(m_device.device(), m_momentsStorageView, nullptr);
+        vkDestroyImageView(m_device.device(), m_momentsView, nullptr);
+        vkDestroyImage(m_device.device(), m_momentsImage, nullptr);
+        vkFreeMemory(m_device.device(), m_momentsMemory, nullptr);
     }
     
-    void VkeShadowMapSystem::buildShadowDescriptorSets(VkeCore& core, uint32_t framesInFlight) {
+    void VkeShadowMapSystem::buildShadowDescriptorSets(VkeCore& core, uint32_t framesInFlight, VkDescriptorImageInfo pointShadowImage) {
         auto shadowImage = getFrameBufferImageInfo();
+
+        VkDescriptorImageInfo depthImage = shadowImage;
+        depthImage.sampler = m_depthSampler;
+
+        VkDescriptorImageInfo momentsImage{};
+        momentsImage.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        momentsImage.imageView = m_momentsView;
+        momentsImage.sampler = m_momentsSampler;
+
         for (int i = 0; i < (int)framesInFlight; i++) {
-            VkeDescriptorWriter(*core.shadowSetLayout, *core.shadowDescriptorPool)
+            VkeDescriptorWriter(*core.shadowSetLayout, *core.descriptorAllocator)
                 .writeImage(0, &shadowImage)
+                .writeImage(1, &pointShadowImage)
+                .writeImage(2, &depthImage)
+                .writeImage(3, &momentsImage)
                 .build(core.shadowSet[i]);
         }
 
@@ -34,7 +64,8 @@ namespace vke {
             VK_FILTER_LINEAR :
             VK_FILTER_NEAREST;
 
-        if (m_frameBuffer->createSampler(shadowmap_filter, shadowmap_filter, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE) != VK_SUCCESS) {
+        // Linear filtering on a comparison sampler is the hardware 2x2 PCF
+        if (m_frameBuffer->createSampler(shadowmap_filter, shadowmap_filter, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_TRUE) != VK_SUCCESS) {
             throw std::runtime_error("failed to create shadow depth sampler!");
         }
 
@@ -42,61 +73,456 @@ namespace vke {
         depthAttachment.format = DEPTH_FORMAT;
         depthAttachment.width = m_frameBuffer->width;
         depthAttachment.height = m_frameBuffer->height;
-        depthAttachment.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        depthAttachment.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
         depthAttachment.imageSampleCount = VK_SAMPLE_COUNT_1_BIT;
-        depthAttachment.layerCount = 1;
-        m_frameBuffer->addAttachment(depthAttachment);
+        depthAttachment.layerCount = MAX_SHADOW_CASCADES;
+        uint32_t depthIndex = m_frameBuffer->addAttachment(depthAttachment);
+
+        // Starts from the copied static depth instead of a clear
+        m_frameBuffer->attachments[depthIndex].description.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        m_frameBuffer->attachments[depthIndex].description.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         m_frameBuffer->createRenderPass();
+
+        m_staticFrameBuffer = std::make_unique<VkeFrameBuffer>(m_device);
+        m_staticFrameBuffer->width = SHADOWMAP_DIM;
+        m_staticFrameBuffer->height = SHADOWMAP_DIM;
+
+        AttachmentCreateInfo staticAttachment = depthAttachment;
+        staticAttachment.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        uint32_t staticIndex = m_staticFrameBuffer->addAttachment(staticAttachment);
+        m_staticFrameBuffer->attachments[staticIndex].description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        m_staticFrameBuffer->attachments[staticIndex].description.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        m_staticFrameBuffer->createRenderPass();
+
+        createMomentResources();
+    }
+
+    void VkeShadowMapSystem::createMomentResources() {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.maxLod = 1.0f;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        if (vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_depthSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow raw depth sampler!");
+        }
+
+        m_momentMipLevels = static_cast<uint32_t>(std::floor(std::log2(EVSM_DIM))) + 1;
+
+        // Trilinear, the mip chain is what filters the moments
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.maxLod = static_cast<float>(m_momentMipLevels);
+        if (vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_momentsSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow moments sampler!");
+        }
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = EVSM_FORMAT;
+        imageInfo.extent = { EVSM_DIM, EVSM_DIM, 1 };
+        imageInfo.mipLevels = m_momentMipLevels;
+        imageInfo.arrayLayers = MAX_SHADOW_CASCADES;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        m_device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_momentsImage, m_momentsMemory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_momentsImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewInfo.format = EVSM_FORMAT;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_momentMipLevels, 0, MAX_SHADOW_CASCADES };
+        if (vkCreateImageView(m_device.device(), &viewInfo, nullptr, &m_momentsView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow moments image view!");
+        }
+
+        viewInfo.subresourceRange.levelCount = 1;
+        if (vkCreateImageView(m_device.device(), &viewInfo, nullptr, &m_momentsStorageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow moments storage view!");
+        }
+
+        // Shadow depth and moments mip 0
+        m_momentsSetLayout = m_device.pipelineRegistry().getSetLayout({ "evsm_moments.comp.spv" }, 0);
+        m_momentsPool = VkeDescriptorPool::Builder(m_device)
+            .setMaxSets(1)
+            .addPoolSizes(*m_momentsSetLayout, 1)
+            .build();
+
+        VkDescriptorImageInfo depthImage = getFrameBufferImageInfo();
+        depthImage.sampler = m_depthSampler;
+
+        VkDescriptorImageInfo storageImage{};
+        storageImage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        storageImage.imageView = m_momentsStorageView;
+
+        VkeDescriptorWriter(*m_momentsSetLayout, *m_momentsPool)
+            .writeImage(0, &depthImage)
+            .writeImage(1, &storageImage)
+            .build(m_momentsSet);
+    }
+
+    void VkeShadowMapSystem::generateMoments(VkCommandBuffer commandBuffer) {
+        VkImageSubresourceRange allMips{ VK_IMAGE_ASPECT_COLOR_BIT, 0, m_momentMipLevels, 0, MAX_SHADOW_CASCADES };
+
+        // The render graph made the shadow depth visible, moments are rebuilt from scratch
+        VkImageMemoryBarrier toGeneral{};
+        toGeneral.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        toGeneral.srcAccessMask = 0;
+        toGeneral.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        toGeneral.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        toGeneral.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        toGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toGeneral.image = m_momentsImage;
+        toGeneral.subresourceRange = allMips;
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &toGeneral);
+
+        m_momentsPipeline->bind(commandBuffer);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_momentsPipelineLayout, 0, 1, &m_momentsSet, 0, nullptr);
+        uint32_t groups = (EVSM_DIM + EVSM_LOCAL_SIZE - 1) / EVSM_LOCAL_SIZE;
+        vkCmdDispatch(commandBuffer, groups, groups, static_cast<uint32_t>(m_cascadeCount));
+
+        // Downsample the mip chain with blits, each level becomes a transfer source once written
+        VkImageMemoryBarrier mipBarrier = toGeneral;
+        mipBarrier.subresourceRange.levelCount = 1;
+        for (uint32_t mip = 1; mip < m_momentMipLevels; mip++) {
+            mipBarrier.subresourceRange.baseMipLevel = mip - 1;
+            mipBarrier.srcAccessMask = (mip == 1) ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+            mipBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            mipBarrier.oldLayout = (mip == 1) ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            mipBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            VkImageMemoryBarrier dstBarrier = mipBarrier;
+            dstBarrier.subresourceRange.baseMipLevel = mip;
+            dstBarrier.srcAccessMask = 0;
+            dstBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            dstBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            dstBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            std::array<VkImageMemoryBarrier, 2> barriers = { mipBarrier, dstBarrier };
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                (mip == 1) ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+            int32_t srcDim = static_cast<int32_t>(EVSM_DIM >> (mip - 1));
+            int32_t dstDim = std::max(srcDim / 2, 1);
+            VkImageBlit blit{};
+            blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, static_cast<uint32_t>(m_cascadeCount) };
+            blit.srcOffsets[1] = { srcDim, srcDim, 1 };
+            blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, static_cast<uint32_t>(m_cascadeCount) };
+            blit.dstOffsets[1] = { dstDim, dstDim, 1 };
+            vkCmdBlitImage(
+                commandBuffer,
+                m_momentsImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                m_momentsImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit, VK_FILTER_LINEAR);
+        }
+
+        // Every mip but the last is a transfer source now. Back in the layout the render graph expects, it makes
+        // the moments visible to the passes that sample them
+        std::array<VkImageMemoryBarrier, 2> toRead{};
+        toRead[0] = toGeneral;
+        toRead[0].subresourceRange.levelCount = m_momentMipLevels - 1;
+        toRead[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        toRead[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        toRead[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        toRead[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        toRead[1] = toRead[0];
+        toRead[1].subresourceRange.baseMipLevel = m_momentMipLevels - 1;
+        toRead[1].subresourceRange.levelCount = 1;
+        toRead[1].srcAccessMask = (m_momentMipLevels == 1) ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+        toRead[1].oldLayout = (m_momentMipLevels == 1) ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        uint32_t barrierCount = (m_momentMipLevels == 1) ? 1 : 2;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, barrierCount, (m_momentMipLevels == 1) ? &toRead[1] : toRead.data());
+
+        m_momentsValid = true;
+    }
+
+    void VkeShadowMapSystem::updateDescriptors(FrameInfo& frameInfo, UniformBufferScene& ubs) {
+        ubs.cascadeCount = m_cascadeCount;
+
+        for (const RenderDirectionalLight& light : frameInfo.renderPacket.directionalLights) {
+            // The light looks at the origin
+            ubs.directionalLight.position = glm::vec4(light.position, 1.0f);
+            updateCascades(frameInfo, glm::normalize(-light.position), ubs.directionalLight);
+        }
+
+        m_directionalLight = ubs.directionalLight;
+    }
+
+    // REFERENCE MATERIAL: https://github.com/SaschaWillems/Vulkan/blob/master/examples/shadowmappingcascade/shadowmappingcascade.cpp
+    void VkeShadowMapSystem::updateCascades(FrameInfo& frameInfo, glm::vec3 lightDirection, DirectionalLight& light) {
+        VkeCamera& camera = frameInfo.camera;
+        float nearClip = camera.zNear;
+        float farClip = std::min(camera.zFar, SHADOW_DISTANCE);
+        float clipRange = farClip - nearClip;
+        float ratio = farClip / nearClip;
+
+        // Frustum corners at the camera near and far planes
+        glm::mat4 inverseCamera = glm::inverse(camera.getProjection() * camera.getView());
+        glm::vec3 nearCorners[4];
+        glm::vec3 farCorners[4];
+        const glm::vec2 ndcCorners[4] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+        for (int i = 0; i < 4; i++) {
+            glm::vec4 nearCorner = inverseCamera * glm::vec4(ndcCorners[i], 0.0f, 1.0f);
+            glm::vec4 farCorner = inverseCamera * glm::vec4(ndcCorners[i], 1.0f, 1.0f);
+            nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+            farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+        }
+
+        glm::vec3 up = glm::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        float lastSplitDepth = nearClip;
+        for (int cascade = 0; cascade < m_cascadeCount; cascade++) {
+            // Practical split scheme
+            float p = (cascade + 1) / static_cast<float>(m_cascadeCount);
+            float logSplit = nearClip * std::pow(ratio, p);
+            float uniformSplit = nearClip + clipRange * p;
+            float splitDepth = CASCADE_SPLIT_LAMBDA * (logSplit - uniformSplit) + uniformSplit;
+
+            // View depth is linear along each corner ray between the camera planes
+            float tNear = (lastSplitDepth - camera.zNear) / (camera.zFar - camera.zNear);
+            float tFar = (splitDepth - camera.zNear) / (camera.zFar - camera.zNear);
+            glm::vec3 corners[8];
+            glm::vec3 center{ 0.0f };
+            for (int i = 0; i < 4; i++) {
+                glm::vec3 ray = farCorners[i] - nearCorners[i];
+                corners[i] = nearCorners[i] + ray * tNear;
+                corners[i + 4] = nearCorners[i] + ray * tFar;
+                center += corners[i] + corners[i + 4];
+            }
+            center /= 8.0f;
+
+            // Bounding sphere keeps the cascade size constant while the camera rotates
+            float radius = 0.0f;
+            for (auto& corner : corners) {
+                radius = std::max(radius, glm::length(corner - center));
+            }
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+
+            // Casters between the sphere and the light land in front of the near plane, the shadow pipeline clamps
+            // their depth to it instead of clipping them
+            glm::mat4 lightView = glm::lookAt(center - lightDirection * radius, center, up);
+            glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+
+            // Snap to whole shadow map texels so edges don't shimmer while the camera moves
+            glm::vec4 shadowOrigin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            shadowOrigin *= SHADOWMAP_DIM / 2.0f;
+            glm::vec4 roundOffset = (glm::round(shadowOrigin) - shadowOrigin) * (2.0f / SHADOWMAP_DIM);
+            lightProjection[3][0] += roundOffset.x;
+            lightProjection[3][1] += roundOffset.y;
+
+            light.viewProjection[cascade] = lightProjection * lightView;
+            light.cascadeSplits[cascade] = splitDepth;
+            lastSplitDepth = splitDepth;
+        }
     }
 
     void VkeShadowMapSystem::render(FrameInfo& frameInfo) {
-        beginRenderPass(frameInfo.commandBuffer);
-        vkCmdBindDescriptorSets(
-            frameInfo.commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            m_pipelineLayout,
-            0,
-            static_cast<uint32_t>(frameInfo.descriptorSets.size()),
-            frameInfo.descriptorSets.data(),
-            0,
-            nullptr);
-
-        m_pipeline->bind(frameInfo.commandBuffer);
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
-
-            if (obj.model == nullptr)
+        bool staticDirty = updateStaticCasters(frameInfo);
+
+        bool hasDynamicCasters = frameInfo.renderPacket.hasDynamicObjects;
+
+        bool bound = false;
+        bool drawn = false;
+        for (int cascade = 0; cascade < m_cascadeCount; cascade++) {
+            bool lightMoved = !m_cascadeCached[cascade] || m_cachedViewProjection[cascade] != m_directionalLight.viewProjection[cascade];
+            bool rebuildStatic = staticDirty || lightMoved;
+
+            // Nothing moved and no dynamic casters to redraw or erase, the map from last frame is still valid
+            if (!rebuildStatic && !hasDynamicCasters && !m_hadDynamicCasters)
+                continue;
+
+            if (!bound) {
+                vkCmdBindDescriptorSets(
+                    frameInfo.commandBuffer,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    m_pipelineLayout,
+                    0,
+                    static_cast<uint32_t>(frameInfo.descriptorSets.size()),
+                    frameInfo.descriptorSets.data(),
+                    0,
+                    nullptr);
+
+                m_pipeline->bind(frameInfo.commandBuffer);
+                bound = true;
+            }
+
+            if (rebuildStatic) {
+                // The previous copy out of this layer must finish before it is cleared
+                vkCmdPipelineBarrier(
+                    frameInfo.commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                    0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+                beginRenderPass(frameInfo.commandBuffer, *m_staticFrameBuffer, cascade);
+                drawCasters(frameInfo, cascade, true);
+                endRenderPass(frameInfo.commandBuffer);
+
+                m_cachedViewProjection[cascade] = m_directionalLight.viewProjection[cascade];
+                m_cascadeCached[cascade] = true;
+            }
+
+            copyStaticCascade(frameInfo.commandBuffer, cascade);
+
+            beginRenderPass(frameInfo.commandBuffer, *m_frameBuffer, cascade);
+            drawCasters(frameInfo, cascade, false);
+            endRenderPass(frameInfo.commandBuffer);
+            drawn = true;
+        }
+
+        m_hadDynamicCasters = hasDynamicCasters;
+        m_drawn = drawn;
+    }
+
+    void VkeShadowMapSystem::renderMoments(FrameInfo& frameInfo) {
+        assert(m_filter == ShadowFilter::EVSM && "Moments are only sampled by EVSM");
+        if (m_drawn || !m_momentsValid) {
+            generateMoments(frameInfo.commandBuffer);
+        }
+    }
+
+    void VkeShadowMapSystem::drawCasters(FrameInfo& frameInfo, uint32_t cascadeIndex, bool staticCasters) {
+        for (const RenderObject& obj : frameInfo.renderPacket.objects) {
+            if (obj.isStatic != staticCasters)
                 continue;
 
-            PushConstantData push{};
-            push.modelMatrix = obj.transform->getModelMatrix();;
-            push.normalMatrix = obj.transform->getNormalMatrix();
+            ShadowPushConstant push{};
+            push.modelMatrix = obj.modelMatrix;
+            push.cascadeIndex = cascadeIndex;
 
             vkCmdPushConstants(
                 frameInfo.commandBuffer,
                 m_pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                m_pushConstantStages,
                 0,
-                sizeof(PushConstantData),
+                sizeof(ShadowPushConstant),
                 &push);
 
             // Draw desired objects for depth attachment update
             obj.model->bind(frameInfo.commandBuffer);
             obj.model->draw(frameInfo.commandBuffer);
         }
+    }
+
+    bool VkeShadowMapSystem::updateStaticCasters(FrameInfo& frameInfo) {
+        // Static objects can still be placed, moved by tools, added or removed, compare against the cached transforms
+        bool dirty = false;
+        size_t count = 0;
+        for (const RenderObject& obj : frameInfo.renderPacket.objects) {
+            if (!obj.isStatic)
+                continue;
+
+            const glm::mat4& modelMatrix = obj.modelMatrix;
+            if (count == m_staticCasterMatrices.size()) {
+                m_staticCasterMatrices.push_back(modelMatrix);
+                dirty = true;
+            }
+            else if (m_staticCasterMatrices[count] != modelMatrix) {
+                m_staticCasterMatrices[count] = modelMatrix;
+                dirty = true;
+            }
+            count++;
+        }
+
+        if (count != m_staticCasterMatrices.size()) {
+            m_staticCasterMatrices.resize(count);
+            dirty = true;
+        }
+
+        return dirty;
+    }
 
-        endRenderPass(frameInfo.commandBuffer);
+    void VkeShadowMapSystem::copyStaticCascade(VkCommandBuffer commandBuffer, uint32_t cascadeIndex) {
+        VkImageSubresourceRange layerRange{};
+        layerRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        layerRange.levelCount = 1;
+        layerRange.baseArrayLayer = cascadeIndex;
+        layerRange.layerCount = 1;
+
+        std::array<VkImageMemoryBarrier, 2> toTransfer{};
+        toTransfer[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        toTransfer[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        toTransfer[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        toTransfer[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        toTransfer[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        toTransfer[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toTransfer[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toTransfer[0].image = m_staticFrameBuffer->attachments[0].image;
+        toTransfer[0].subresourceRange = layerRange;
+
+        // Previous contents of the layer are overwritten by the copy
+        toTransfer[1] = toTransfer[0];
+        toTransfer[1].srcAccessMask = 0;
+        toTransfer[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toTransfer[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        toTransfer[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        toTransfer[1].image = m_frameBuffer->attachments[0].image;
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(toTransfer.size()), toTransfer.data());
+
+        VkImageCopy region{};
+        region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        region.srcSubresource.baseArrayLayer = cascadeIndex;
+        region.srcSubresource.layerCount = 1;
+        region.dstSubresource = region.srcSubresource;
+        region.extent = { m_frameBuffer->width, m_frameBuffer->height, 1 };
+
+        vkCmdCopyImage(
+            commandBuffer,
+            m_staticFrameBuffer->attachments[0].image,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            m_frameBuffer->attachments[0].image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &region);
+
+        VkImageMemoryBarrier toDepth = toTransfer[1];
+        toDepth.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toDepth.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        toDepth.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        toDepth.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &toDepth);
     }
 
-    void VkeShadowMapSystem::beginRenderPass(VkCommandBuffer commandBuffer) {
+    void VkeShadowMapSystem::beginRenderPass(VkCommandBuffer commandBuffer, VkeFrameBuffer& frameBuffer, uint32_t cascadeIndex) {
         VkExtent2D extent{};
-        extent.width = m_frameBuffer->width;
-        extent.height = m_frameBuffer->height;
+        extent.width = frameBuffer.width;
+        extent.height = frameBuffer.height;
 
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_frameBuffer->renderPass;
-        renderPassInfo.framebuffer = m_frameBuffer->framebuffer;
+        renderPassInfo.renderPass = frameBuffer.renderPass;
+        renderPassInfo.framebuffer = frameBuffer.layerFramebuffers[cascadeIndex];
         renderPassInfo.renderArea.extent = extent;
 
         VkClearValue clearValues[2];
@@ -136,25 +562,22 @@ namespace vke {
     void VkeShadowMapSystem::initPipeline(std::vector<VkDescriptorSetLayout>& setLayouts) {
         createPipelineLayout(setLayouts);
         createPipeline(m_frameBuffer->renderPass);
+        createMomentPipeline();
     }
 
-    void VkeShadowMapSystem::createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(PushConstantData);
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    void VkeShadowMapSystem::createMomentPipeline() {
+        // Set 0 comes from the same reflection as m_momentsSetLayout, so the cached layout is shared
+        m_momentsPipelineLayout = m_device.pipelineRegistry().getPipelineLayout({ "evsm_moments.comp.spv" }).layout;
+        m_momentsPipeline = m_device.pipelineRegistry().requestComputePipeline(
+            "evsm_moments.comp.spv",
+            m_momentsPipelineLayout);
+    }
 
-        if (vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) !=
-            VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
+    void VkeShadowMapSystem::createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts) {
+        PipelineLayoutInfo layoutInfo = m_device.pipelineRegistry().getPipelineLayout({ "shadow.vert.spv", "blank.frag.spv" }, setLayouts);
+        assert(layoutInfo.pushConstantRange.size == sizeof(ShadowPushConstant) && "ShadowPushConstant doesn't match the shader push constant block");
+        m_pipelineLayout = layoutInfo.layout;
+        m_pushConstantStages = layoutInfo.pushConstantRange.stageFlags;
     }
     
     void VkeShadowMapSystem::createPipeline(VkRenderPass renderPass) {
@@ -162,10 +585,12 @@ namespace vke {
 
         PipelineConfigInfo pipelineConfig{};
         VkePipeline::defaultPipelineConfigInfo(pipelineConfig);
+        VkePipeline::enablePositionOnlyInput(pipelineConfig);
 
         pipelineConfig.colorBlendInfo.attachmentCount = 0;
         pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
         pipelineConfig.rasterizationInfo.depthBiasEnable = VK_TRUE;
+        pipelineConfig.rasterizationInfo.depthClampEnable = VK_TRUE;
 
         pipelineConfig.dynamicStateEnables.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
         pipelineConfig.dynamicStateInfo.pDynamicStates = pipelineConfig.dynamicStateEnables.data();
@@ -174,10 +599,9 @@ namespace vke {
 
         pipelineConfig.renderPass = renderPass;
         pipelineConfig.pipelineLayout = m_pipelineLayout;
-        m_pipeline = std::make_unique<VkePipeline>(
-            m_device,
-            "VulkanEngine/src/shaders/shadow.vert.spv",
-            "VulkanEngine/src/shaders/blank.frag.spv",
+        m_pipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "shadow.vert.spv",
+            "blank.frag.spv",
             pipelineConfig);
     }
 }
\ No newline at end of file
@@ -1,41 +1,122 @@
 #pragma once
 // REFERENCE MATERIAL: https://github.com/SaschaWillems/Vulkan/blob/master/examples/shadowmapping/shadowmapping.cpp
-#include "../core/vke_pipeline.hpp"
+#include "../core/vke_pipeline_registry.hpp"
 #include "../core/vke_frame_info.hpp"
 #include "../core/vke_descriptors.hpp"
 #include "../core/vke_frame_buffer.hpp"
 #include "../core/vke_core.hpp"
+#include <algorithm>
 #include <array>
+#include <cassert>
 
 // Offscreen frame buffer properties
 #define DEFAULT_SHADOWMAP_FILTER VK_FILTER_LINEAR
 #define DEPTH_FORMAT VK_FORMAT_D16_UNORM
 #define SHADOWMAP_DIM 2048
 
+// Cascades cover the camera frustum up to this view depth, split between uniform and logarithmic by lambda
+#define SHADOW_DISTANCE 60.0f
+#define CASCADE_SPLIT_LAMBDA 0.95f
+
+// Exponential variance moments, prefiltered to half the shadow map resolution. 16 bit floats hold
+// the warped depth for exponents up to ~5.5, see evsm.glsl
+#define EVSM_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+#define EVSM_DIM (SHADOWMAP_DIM / 2)
+#define EVSM_LOCAL_SIZE 8
+
 namespace vke {
+	// Directional shadow filtering, baked into the pipelines that sample the shadow map
+	enum class ShadowFilter : uint32_t {
+		HardwarePCF = 0,	// One comparison fetch, bilinear 2x2 PCF
+		PoissonDisk = 1,	// 16 comparison fetches on a per pixel rotated Poisson disk
+		PCSS = 2,			// Blocker search sizes the Poisson disk, contact hardening
+		EVSM = 3,			// Mipmapped exponential variance moments
+		Count
+	};
+
+	const char* shadowFilterName(ShadowFilter filter);
+
 	class VkeShadowMapSystem {
 	public:
 		VkeShadowMapSystem(VkeDevice& device);
 		~VkeShadowMapSystem();
 
+		// Leaves every cascade layer in DEPTH_STENCIL_READ_ONLY_OPTIMAL
 		void render(FrameInfo& frameInfo);
+		// EVSM moments from this frame's shadow map, a pass of its own so the render graph can cull it for other filters
+		void renderMoments(FrameInfo& frameInfo);
+		void updateDescriptors(FrameInfo& frameInfo, UniformBufferScene& ubs);
 		void initPipeline(std::vector<VkDescriptorSetLayout>& setLayouts);
 		void initFrameBuffer();
 		VkDescriptorImageInfo getFrameBufferImageInfo();
-		void buildShadowDescriptorSets(VkeCore& core, uint32_t framesInFlight);
+		VkImage getShadowImage() const { return m_frameBuffer->attachments[0].image; }
+		VkImageSubresourceRange getShadowRange() const { return m_frameBuffer->attachments[0].subReourceRange; }
+		VkImage getMomentsImage() const { return m_momentsImage; }
+		VkImageSubresourceRange getMomentsRange() const { return { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_momentMipLevels, 0, MAX_SHADOW_CASCADES }; }
+		void buildShadowDescriptorSets(VkeCore& core, uint32_t framesInFlight, VkDescriptorImageInfo pointShadowImage);
+
+		// 2 to MAX_SHADOW_CASCADES, layers past the count are left unrendered. The splits move, every cascade and
+		// the moments are redrawn
+		void setCascadeCount(int count) {
+			assert(count >= 2 && count <= MAX_SHADOW_CASCADES && "Cascade count out of range");
+			m_cascadeCount = count;
+			std::fill(std::begin(m_cascadeCached), std::end(m_cascadeCached), false);
+			m_momentsValid = false;
+		}
+		int getCascadeCount() const { return m_cascadeCount; }
+
+		// Only moments for EVSM need extra work here, the sampling pipelines are rebuilt by their owners
+		void setFilter(ShadowFilter filter) { m_filter = filter; m_momentsValid = false; }
+		ShadowFilter getFilter() const { return m_filter; }
 		
 		const float depthBiasConstant = 1.25f;
 		const float depthBiasClamp = 0.0f;
 		const float depthBiasSlope = 3.75f;
 	private:
 		void createPipeline(VkRenderPass renderPass);
+		void updateCascades(FrameInfo& frameInfo, glm::vec3 lightDirection, DirectionalLight& light);
 		void createPipelineLayout(std::vector<VkDescriptorSetLayout>& setLayouts);
-		void beginRenderPass(VkCommandBuffer commandBuffer);
+		bool updateStaticCasters(FrameInfo& frameInfo);
+		void drawCasters(FrameInfo& frameInfo, uint32_t cascadeIndex, bool staticCasters);
+		void copyStaticCascade(VkCommandBuffer commandBuffer, uint32_t cascadeIndex);
+		void beginRenderPass(VkCommandBuffer commandBuffer, VkeFrameBuffer& frameBuffer, uint32_t cascadeIndex);
 		void endRenderPass(VkCommandBuffer commandBuffer);
+		void createMomentResources();
+		void createMomentPipeline();
+		void generateMoments(VkCommandBuffer commandBuffer);
 
 		VkeDevice& m_device;
-		VkPipelineLayout m_pipelineLayout;
-		std::unique_ptr<VkePipeline> m_pipeline;
+		VkPipelineLayout m_pipelineLayout; // Pipeline layouts are owned by the pipeline registry
+		VkShaderStageFlags m_pushConstantStages = 0;
+		PipelineHandle m_pipeline;
 		std::unique_ptr<VkeFrameBuffer> m_frameBuffer;
+
+		// Static casters only, copied into m_frameBuffer before the dynamic casters are drawn on top
+		std::unique_ptr<VkeFrameBuffer> m_staticFrameBuffer;
+		std::vector<glm::mat4> m_staticCasterMatrices;
+		glm::mat4 m_cachedViewProjection[MAX_SHADOW_CASCADES];
+		bool m_cascadeCached[MAX_SHADOW_CASCADES] = {};
+		bool m_hadDynamicCasters = false;
+		bool m_drawn = false; // Some cascade was redrawn this frame, the moments are stale
+
+		DirectionalLight m_directionalLight{};
+		int m_cascadeCount = MAX_SHADOW_CASCADES;
+
+		// Raw depth reads next to the comparison sampler of m_frameBuffer, PCSS blocker search and moment generation
+		VkSampler m_depthSampler = VK_NULL_HANDLE;
+
+		ShadowFilter m_filter = ShadowFilter::HardwarePCF;
+		bool m_momentsValid = false;
+		uint32_t m_momentMipLevels = 1;
+		VkImage m_momentsImage = VK_NULL_HANDLE;
+		VkDeviceMemory m_momentsMemory = VK_NULL_HANDLE;
+		VkImageView m_momentsView = VK_NULL_HANDLE;
+		VkImageView m_momentsStorageView = VK_NULL_HANDLE; // Mip 0 only
+		VkSampler m_momentsSampler = VK_NULL_HANDLE;
+		std::unique_ptr<VkeDescriptorPool> m_momentsPool;
+		std::shared_ptr<VkeDescriptorSetLayout> m_momentsSetLayout;
+		VkDescriptorSet m_momentsSet;
+		VkPipelineLayout m_momentsPipelineLayout = VK_NULL_HANDLE;
+		PipelineHandle m_momentsPipeline;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "upscale_system.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace vke {
+    struct UpscalePushConstant {
+        glm::vec2 uvScale;
+        glm::vec2 outputSize;
+        float sharpness;
+    };
+
+    const char* upscaleFilterName(UpscaleFilter filter) {
+        switch (filter) {
+        case UpscaleFilter::Bilinear: return "Bilinear";
+        case UpscaleFilter::Sharpen: return "Sharpened";
+        default: return "Unknown";
+        }
+    }
+
+    VkeUpscaleSystem::VkeUpscaleSystem(VkeDevice& device, VkRenderPass presentRenderPass) : m_device{ device } {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.maxLod = 0.0f;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+        if (vkCreateSampler(m_device.device(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upscale sampler!");
+        }
+
+        m_setLayout = m_device.pipelineRegistry().getSetLayout({ "fullscreen.vert.spv", "upscale.frag.spv" }, 0);
+
+        createPipelineLayout();
+        createPipeline(presentRenderPass);
+    }
+
+    VkeUpscaleSystem::~VkeUpscaleSystem() {
+        vkDestroySampler(m_device.device(), m_sampler, nullptr);
+    }
+
+    void VkeUpscaleSystem::render(FrameInfo& frameInfo, VkExtent2D renderExtent, VkExtent2D targetExtent, VkExtent2D outputExtent) {
+        assert(m_source != VK_NULL_HANDLE && "Upscale source must be set before rendering");
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = m_source;
+        imageInfo.sampler = m_sampler;
+
+        VkDescriptorSet sourceSet;
+        if (!VkeDescriptorWriter(*m_setLayout, frameInfo.frameDescriptorAllocator).writeImage(0, &imageInfo).build(sourceSet)) {
+            throw std::runtime_error("failed to allocate upscale descriptor set!");
+        }
+
+        VkViewport viewport{};
+        viewport.width = static_cast<float>(outputExtent.width);
+        viewport.height = static_cast<float>(outputExtent.height);
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{ { 0, 0 }, outputExtent };
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        m_pipeline->bind(commandBuffer);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &sourceSet, 0, nullptr);
+
+        UpscalePushConstant push{};
+        push.uvScale = glm::vec2(
+            static_cast<float>(renderExtent.width) / static_cast<float>(targetExtent.width),
+            static_cast<float>(renderExtent.height) / static_cast<float>(targetExtent.height));
+        push.outputSize = glm::vec2(outputExtent.width, outputExtent.height);
+        push.sharpness = (m_filter == UpscaleFilter::Sharpen) ? m_sharpness : 0.0f;
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, m_pushConstantStages, 0, sizeof(UpscalePushConstant), &push);
+
+        // Fullscreen triangle
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    }
+
+    void VkeUpscaleSystem::createPipelineLayout() {
+        PipelineLayoutInfo layoutInfo = m_device.pipelineRegistry().getPipelineLayout({ "fullscreen.vert.spv", "upscale.frag.spv" });
+        assert(layoutInfo.pushConstantRange.size == sizeof(UpscalePushConstant) && "UpscalePushConstant doesn't match the shader push constant block");
+        m_pipelineLayout = layoutInfo.layout;
+        m_pushConstantStages = layoutInfo.pushConstantRange.stageFlags;
+    }
+
+    void VkeUpscaleSystem::createPipeline(VkRenderPass renderPass) {
+        assert(m_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        PipelineConfigInfo pipelineConfig{};
+        VkePipeline::defaultPipelineConfigInfo(pipelineConfig);
+        pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        pipelineConfig.renderPass = renderPass;
+        pipelineConfig.pipelineLayout = m_pipelineLayout;
+        m_pipeline = m_device.pipelineRegistry().requestGraphicsPipeline(
+            "fullscreen.vert.spv",
+            "upscale.frag.spv",
+            pipelineConfig,
+            true);
+    }
+}
\ No newline at end of file
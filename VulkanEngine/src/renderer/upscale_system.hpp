@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../core/vke_device.hpp"
+#include "../core/vke_pipeline_registry.hpp"
+#include "../core/vke_descriptors.hpp"
+#include "../core/vke_frame_info.hpp"
+
+// std
+#include <memory>
+
+#define DEFAULT_UPSCALE_SHARPNESS 0.5f
+
+namespace vke {
+	enum class UpscaleFilter : uint32_t {
+		Bilinear = 0,
+		Sharpen = 1,	// Bilinear followed by contrast adaptive sharpening
+		Count
+	};
+
+	const char* upscaleFilterName(UpscaleFilter filter);
+
+	// Draws the rendered part of the scene color target over the whole swap chain image, a fullscreen triangle
+	// inside the swap chain's present render pass
+	class VkeUpscaleSystem {
+	public:
+		VkeUpscaleSystem(VkeDevice& device, VkRenderPass presentRenderPass);
+		~VkeUpscaleSystem();
+
+		VkeUpscaleSystem(const VkeUpscaleSystem&) = delete;
+		VkeUpscaleSystem& operator=(const VkeUpscaleSystem&) = delete;
+
+		// The scene color target is recreated with the swap chain, call again afterwards. Frames already recorded keep
+		// sampling the old one, the set is allocated per frame
+		void setSource(VkImageView sceneColor) { m_source = sceneColor; }
+
+		// renderExtent is the corner of the targetExtent sized scene color the scene covered, outputExtent the swap chain's
+		void render(FrameInfo& frameInfo, VkExtent2D renderExtent, VkExtent2D targetExtent, VkExtent2D outputExtent);
+
+		void setFilter(UpscaleFilter filter) { m_filter = filter; }
+		UpscaleFilter getFilter() const { return m_filter; }
+		void setSharpness(float sharpness) { m_sharpness = sharpness; }
+		float getSharpness() const { return m_sharpness; }
+
+	private:
+		void createPipelineLayout();
+		void createPipeline(VkRenderPass renderPass);
+
+		VkeDevice& m_device;
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE; // Owned by the pipeline registry
+		VkShaderStageFlags m_pushConstantStages = 0;
+		PipelineHandle m_pipeline;
+
+		VkSampler m_sampler = VK_NULL_HANDLE;
+		std::shared_ptr<VkeDescriptorSetLayout> m_setLayout;
+		VkImageView m_source = VK_NULL_HANDLE;
+
+		UpscaleFilter m_filter = UpscaleFilter::Sharpen;
+		float m_sharpness = DEFAULT_UPSCALE_SHARPNESS;
+	};
+}
\ No newline at end of file
@@ -2,34 +2,170 @@
 
 
 namespace vke {
-    VkeRenderer::VkeRenderer(VkeWindow& window, VkeDevice& device) : m_window{ window }, m_device{ device } {
+    // Same format as the swap chain, sRGB encoding round trips through the upscale unchanged
+    static TransientImageInfo sceneColorInfo(VkeSwapChain& swapChain) {
+        TransientImageInfo info{};
+        info.format = swapChain.getSwapChainImageFormat();
+        info.extent = swapChain.getSwapChainExtent();
+        info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        return info;
+    }
+
+    VkeRenderer::VkeRenderer(VkeWindow& window, VkeDevice& device, const SwapChainConfig& swapChainConfig)
+        : m_window{ window }, m_device{ device }, m_swapChainConfig{ swapChainConfig } {
+        if (m_swapChainConfig.framesInFlight < MIN_FRAMES_IN_FLIGHT || m_swapChainConfig.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+            throw std::runtime_error("frames in flight must be between " + std::to_string(MIN_FRAMES_IN_FLIGHT) +
+                " and " + std::to_string(MAX_FRAMES_IN_FLIGHT));
+        }
+
         recreateSwapChain();
         createCommandBuffers();
+        m_asyncCompute = std::make_unique<VkeAsyncCompute>(m_device, m_swapChainConfig.framesInFlight);
+        m_renderPackets.resize(m_swapChainConfig.framesInFlight);
 
-        m_core.init(m_device);
+        m_core.init(m_device, m_swapChainConfig.framesInFlight);
         m_core.buildCoreDescriptorSets();
+        m_pointShadowSystem = std::make_unique<VkePointShadowSystem>(m_device);
+        m_pointShadowSystem->initFrameBuffer();
         m_shadowMapSystem = std::make_unique<VkeShadowMapSystem>(m_device);
         m_shadowMapSystem->initFrameBuffer();
-        m_shadowMapSystem->buildShadowDescriptorSets(m_core, VkeSwapChain::MAX_FRAMES_IN_FLIGHT);
+        m_shadowMapSystem->buildShadowDescriptorSets(m_core, m_swapChainConfig.framesInFlight, m_pointShadowSystem->getFrameBufferImageInfo());
 
         std::vector<VkDescriptorSetLayout> setLayouts = m_core.getSetLayouts();
 
         // Init render systems
         m_shadowMapSystem->initPipeline(setLayouts);
+        m_pointShadowSystem->initPipeline(setLayouts);
+        m_lightClusterSystem = std::make_unique<VkeLightClusterSystem>(m_device, setLayouts);
+        m_lightClusterSystem->buildClusterDescriptorSets(m_core, m_swapChainConfig.framesInFlight);
         m_geometrySubPass = std::make_unique<GeometrySubpass>(m_device, getSwapChainRenderPass(), setLayouts);
-        m_pointLightSystem = std::make_unique<PointLightSystem>(m_device, getSwapChainRenderPass(), setLayouts);
+        m_pointLightSystem = std::make_unique<PointLightSystem>(m_device, getSwapChainRenderPass(), setLayouts, m_swapChainConfig.framesInFlight);
+
+        // Deferred path
+        m_geometrySubPass->initDeferredPipeline(m_swapChain->getDeferredRenderPass(), 0);
+        m_lightingSubpass = std::make_unique<LightingSubpass>(m_device, *m_swapChain, 1, setLayouts);
+        m_pointLightSystem->initDeferredPipeline(m_swapChain->getDeferredRenderPass(), 1);
+
+        m_upscaleSystem = std::make_unique<VkeUpscaleSystem>(m_device, m_swapChain->getPresentRenderPass());
+        m_renderExtent = m_swapChain->getSwapChainExtent();
+
+        createTimestampPool();
     }
 
     VkeRenderer::~VkeRenderer() {
+        // Queued pipelines still reference the render passes
+        m_device.pipelineRegistry().waitIdle();
+        if (m_timestampPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device.device(), m_timestampPool, nullptr);
+        }
         freeCommandBuffers(); 
     }
 
+    void VkeRenderer::setShadingVariant(const ShadingVariant& variant) {
+        m_shadingVariant = variant;
+        m_renderGraphDirty = true;
+        m_shadowMapSystem->setFilter(variant.shadowFilter);
+        m_geometrySubPass->setShadingVariant(variant);
+        m_lightingSubpass->setShadingVariant(variant);
+    }
+
+    void VkeRenderer::setShadowFilter(ShadowFilter filter) {
+        ShadingVariant variant = m_shadingVariant;
+        variant.shadowFilter = filter;
+        setShadingVariant(variant);
+    }
+
+    void VkeRenderer::setPresentMode(PresentMode mode) {
+        assert(!m_isFrameStarted && "Can't change the present mode while a frame is in progress");
+        m_swapChainConfig.presentMode = mode;
+        m_swapChainOutdated = true; // Stays set while minimized
+        recreateSwapChain();
+    }
+
+    void VkeRenderer::setSwapChainImageCount(uint32_t imageCount) {
+        assert(!m_isFrameStarted && "Can't change the swap chain image count while a frame is in progress");
+        m_swapChainConfig.imageCount = imageCount;
+        m_swapChainOutdated = true; // Stays set while minimized
+        recreateSwapChain();
+    }
+
+    void VkeRenderer::waitForFrameStart() {
+        assert(!m_isFrameStarted && "Can't wait for a frame start while a frame is in progress");
+        uint64_t submitted = m_swapChain->getSubmittedFrame();
+        uint32_t framesInFlight = m_swapChainConfig.framesInFlight;
+
+        // Queued only waits for the slot about to be reused, which acquire would wait for anyway
+        uint64_t frame = 0;
+        if (m_latencyMode == LatencyMode::JustInTime) {
+            frame = submitted;
+        }
+        else if (submitted >= framesInFlight) {
+            frame = submitted + 1 - framesInFlight;
+        }
+
+        if (frame > 0) {
+            m_swapChain->waitForFrame(frame);
+        }
+    }
+
+    void VkeRenderer::createTimestampPool() {
+        m_timestampsWritten.assign(m_swapChainConfig.framesInFlight, false);
+        if (!m_device.properties.limits.timestampComputeAndGraphics) {
+            return;
+        }
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = TIMESTAMPS_PER_FRAME * m_swapChainConfig.framesInFlight;
+
+        if (vkCreateQueryPool(m_device.device(), &poolInfo, nullptr, &m_timestampPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    void VkeRenderer::readTimestamps() {
+        // Called after acquire, which waited for the frame that last used this slot, so its queries are done
+        if (m_timestampPool == VK_NULL_HANDLE || !m_timestampsWritten[m_currentFrameIndex]) {
+            return;
+        }
+
+        std::array<uint64_t, TIMESTAMPS_PER_FRAME> timestamps{};
+        VkResult result = vkGetQueryPoolResults(m_device.device(), m_timestampPool, m_currentFrameIndex * TIMESTAMPS_PER_FRAME, TIMESTAMPS_PER_FRAME,
+            sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+            return;
+        }
+
+        float period = m_device.properties.limits.timestampPeriod * 1e-6f; // Nanoseconds per tick to milliseconds
+        m_gpuTimings.shadowMs = static_cast<float>(timestamps[1] - timestamps[0]) * period;
+        m_gpuTimings.mainMs = static_cast<float>(timestamps[3] - timestamps[2]) * period;
+        m_gpuTimings.upscaleMs = static_cast<float>(timestamps[4] - timestamps[3]) * period;
+
+        // Shadow maps have a fixed resolution and the upscale always fills the swap chain, only the main pass
+        // follows the render extent
+        m_dynamicResolution.update(m_gpuTimings.shadowMs + m_gpuTimings.upscaleMs, m_gpuTimings.mainMs);
+    }
+
     VkCommandBuffer VkeRenderer::beginFrame() {
         assert(!m_isFrameStarted && "Can't call beginFrame when frame is not in progress");
+        releaseRetiredSwapChains();
+        if (m_renderGraph != nullptr) {
+            m_renderGraph->releaseRetired(m_swapChain->getCompletedFrame());
+        }
+
+        // Every resize since the last frame collapses into one recreation
+        if (m_swapChainOutdated || m_window.wasWindowResized()) {
+            if (!recreateSwapChain()) {
+                return nullptr;
+            }
+        }
+
+        m_currentFrameIndex = static_cast<int>(m_swapChain->getCurrentFrame());
         auto result = m_swapChain->acquireNextImage(&m_currentImageIndex);
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            recreateSwapChain();
+            m_swapChainOutdated = true;
             return nullptr;
         }
 
@@ -38,51 +174,72 @@ namespace vke {
         }
 
         m_isFrameStarted = true;
+        readTimestamps();
+
+        // The slot's previous frame has finished, nothing still reads the sets allocated the last time this slot was used
+        m_core.frameDescriptorAllocators[m_currentFrameIndex]->resetPools();
         auto commandBuffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS ||
+            vkBeginCommandBuffer(m_earlyCommandBuffers[m_currentFrameIndex], &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        m_computeWaitValue = 0;
         return commandBuffer;
     }
 
     void VkeRenderer::endFrame() {
         assert(m_isFrameStarted && "Can't call endFrame when frame is not in progress");
         auto commandBuffer = getCurrentCommandBuffer();
+        auto earlyCommandBuffer = m_earlyCommandBuffers[m_currentFrameIndex];
 
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        if (vkEndCommandBuffer(earlyCommandBuffer) != VK_SUCCESS || vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
 
-        auto result = m_swapChain->submitCommandBuffers(&commandBuffer, &m_currentImageIndex);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window.wasWindowResized()) {
-            m_window.resetWindowResizedFlag();
-            recreateSwapChain();
+        FrameSubmission submission{};
+        submission.earlyCommandBuffer = earlyCommandBuffer;
+        submission.commandBuffer = commandBuffer;
+        if (m_computeWaitValue != 0) {
+            submission.computeTimeline = m_asyncCompute->getTimeline();
+            submission.computeValue = m_computeWaitValue;
+            submission.computeWaitStages = m_renderGraph->getAsyncWaitStages();
+        }
+
+        auto result = m_swapChain->submitCommandBuffers(submission, &m_currentImageIndex);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+            m_swapChainOutdated = true;
         }
         else if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to present swap chain image!");
         }
 
         m_isFrameStarted = false;
-        m_currentFrameIndex = (m_currentFrameIndex + 1) % VkeSwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
     void VkeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+        bool deferred = m_renderMode == RenderMode::Deferred;
+
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_swapChain->getRenderPass();
-        renderPassInfo.framebuffer = m_swapChain->getFrameBuffer(m_currentImageIndex);
+        renderPassInfo.renderPass = deferred ? m_swapChain->getDeferredRenderPass() : m_swapChain->getRenderPass();
+        renderPassInfo.framebuffer = deferred ?
+            m_swapChain->getDeferredFrameBuffer(m_currentImageIndex) :
+            m_swapChain->getFrameBuffer(m_currentImageIndex);
 
         renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = m_swapChain->getSwapChainExtent();
+        renderPassInfo.renderArea.extent = m_renderExtent;
 
-        std::array<VkClearValue, 2> clearValues{};
+        // Deferred adds the albedo and normal G-buffer attachments
+        std::array<VkClearValue, 4> clearValues{};
         clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
         clearValues[1].depthStencil = { 1.0f, 0 };
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        clearValues[2].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+        clearValues[3].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+        renderPassInfo.clearValueCount = deferred ? 4 : 2;
         renderPassInfo.pClearValues = clearValues.data();
 
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
@@ -90,11 +247,11 @@ namespace vke {
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float>(m_swapChain->getSwapChainExtent().width);
-        viewport.height = static_cast<float>(m_swapChain->getSwapChainExtent().height);
+        viewport.width = static_cast<float>(m_renderExtent.width);
+        viewport.height = static_cast<float>(m_renderExtent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        VkRect2D scissor{ {0, 0}, m_swapChain->getSwapChainExtent() };
+        VkRect2D scissor{ {0, 0}, m_renderExtent };
         vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     }
@@ -103,29 +260,66 @@ namespace vke {
         vkCmdEndRenderPass(commandBuffer);
     }
 
-    void VkeRenderer::recreateSwapChain() {
+    bool VkeRenderer::recreateSwapChain() {
         auto extent = m_window.getExtent();
-        while (extent.width == 0 || extent.height == 0) {
-            extent = m_window.getExtent();
-            glfwWaitEvents();
+        if (m_swapChain == nullptr) {
+            // Nothing to fall back on during construction, wait for the window to get an area
+            while (extent.width == 0 || extent.height == 0) {
+                glfwWaitEvents();
+                extent = m_window.getExtent();
+            }
+        }
+        else if (extent.width == 0 || extent.height == 0) {
+            return false;
         }
 
-        vkDeviceWaitIdle(m_device.device());
+        m_window.resetWindowResizedFlag();
+        m_swapChainOutdated = false;
 
         if (m_swapChain == nullptr) {
-            m_swapChain = std::make_unique<VkeSwapChain>(m_device, extent);
+            m_swapChain = std::make_unique<VkeSwapChain>(m_device, extent, m_swapChainConfig);
         }
         else {
+            // Frames in flight finish against the old swap chain, it's retired instead of waiting for the device
             std::shared_ptr<VkeSwapChain> oldSwapChain = std::move(m_swapChain);
-            m_swapChain = std::make_unique<VkeSwapChain>(m_device, extent, oldSwapChain);
+            m_swapChain = std::make_unique<VkeSwapChain>(m_device, extent, m_swapChainConfig, oldSwapChain);
             if (!oldSwapChain->compareSwapFormats(*m_swapChain.get())) {
                 throw std::runtime_error("Swap chain image(or depth) format has changed!");
             }
+            m_retiredSwapChains.push_back({ oldSwapChain, oldSwapChain->getSubmittedFrame() });
+        }
+
+        // The old render passes go with the retired swap chain, pipelines requested from now on use the new ones
+        if (m_geometrySubPass != nullptr) {
+            m_geometrySubPass->setRenderPass(m_swapChain->getRenderPass());
+        }
+        if (m_lightingSubpass != nullptr) {
+            m_lightingSubpass->setRenderPass(m_swapChain->getDeferredRenderPass());
+            m_lightingSubpass->updateInputAttachments(*m_swapChain);
+        }
+        // The scene color target follows the new extent, the new swap chain's framebuffers are built around it
+        if (m_sceneColorResource != RENDER_GRAPH_INVALID_RESOURCE) {
+            m_renderGraph->setImageInfo(m_sceneColorResource, sceneColorInfo(*m_swapChain));
         }
+        m_sceneColorView = VK_NULL_HANDLE;
+        m_renderGraphDirty = true;
+        return true;
+    }
+
+    void VkeRenderer::releaseRetiredSwapChains() {
+        // The timeline only tracks command buffers, not the present's wait on the render finished semaphore. Waiting
+        // for one frame past the last, submitted after that present, keeps the semaphores alive until it's done
+        uint64_t completed = m_swapChain->getCompletedFrame();
+        m_retiredSwapChains.erase(
+            std::remove_if(m_retiredSwapChains.begin(), m_retiredSwapChains.end(), [completed](const RetiredSwapChain& retired) {
+                return retired.lastFrame < completed;
+            }),
+            m_retiredSwapChains.end());
     }
 
     void VkeRenderer::createCommandBuffers() {
-        m_commandBuffers.resize(VkeSwapChain::MAX_FRAMES_IN_FLIGHT);
+        m_commandBuffers.resize(m_swapChainConfig.framesInFlight);
+        m_earlyCommandBuffers.resize(m_swapChainConfig.framesInFlight);
 
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -133,15 +327,17 @@ namespace vke {
         allocInfo.commandPool = m_device.getCommandPool();
         allocInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());
 
-        if (vkAllocateCommandBuffers(m_device.device(), &allocInfo, m_commandBuffers.data()) !=
-            VK_SUCCESS) {
+        if (vkAllocateCommandBuffers(m_device.device(), &allocInfo, m_commandBuffers.data()) != VK_SUCCESS ||
+            vkAllocateCommandBuffers(m_device.device(), &allocInfo, m_earlyCommandBuffers.data()) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate command buffers!");
         }
     }
 
     void VkeRenderer::freeCommandBuffers() {
         vkFreeCommandBuffers(m_device.device(), m_device.getCommandPool(), static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
+        vkFreeCommandBuffers(m_device.device(), m_device.getCommandPool(), static_cast<uint32_t>(m_earlyCommandBuffers.size()), m_earlyCommandBuffers.data());
         m_commandBuffers.clear();
+        m_earlyCommandBuffers.clear();
     }
     
     void VkeRenderer::updateDescriptorSets(FrameInfo& frameInfo) {
@@ -158,49 +354,204 @@ namespace vke {
         UniformBufferScene ubs{};
         ubs.inverseView = frameInfo.camera.getInverseView();
         m_pointLightSystem->updateDescriptors(frameInfo, ubs);
+        static const std::vector<uint32_t> noShadowCandidates;
+        m_pointShadowSystem->updateDescriptors(
+            frameInfo,
+            ubs,
+            m_pointLightSystem->getLights(),
+            m_shadingVariant.pointShadows ? m_pointLightSystem->getShadowCandidates() : noShadowCandidates);
+        m_lightClusterSystem->updateDescriptors(frameInfo, m_core, m_pointLightSystem->getLights(), m_renderExtent);
+        m_shadowMapSystem->updateDescriptors(frameInfo, ubs);
         
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
+        m_core.sceneBuffers[frameIndex]->writeToBuffer(&ubs);
+        m_core.sceneBuffers[frameIndex]->flush();
+    }
+
+    void VkeRenderer::buildRenderGraph() {
+        if (m_renderGraph == nullptr) {
+            m_renderGraph = std::make_unique<VkeRenderGraph>(m_device);
+            m_shadowMapResource = m_renderGraph->importImage("shadow map", m_shadowMapSystem->getShadowImage(), m_shadowMapSystem->getShadowRange());
+            m_shadowMomentsResource = m_renderGraph->importImage("shadow moments", m_shadowMapSystem->getMomentsImage(), m_shadowMapSystem->getMomentsRange());
+            m_pointShadowResource = m_renderGraph->importImage("point shadow atlas", m_pointShadowSystem->getAtlasImage(), m_pointShadowSystem->getAtlasRange());
+            m_lightClusterResource = m_renderGraph->importBuffer("light clusters", true);
+            m_sceneColorResource = m_renderGraph->createImage("scene color", sceneColorInfo(*m_swapChain));
+        }
+        m_renderGraph->clearPasses();
+
+        // Shadow passes clear, copy into and render their depth, then leave it for sampling
+        const ResourceUsage shadowDepthWrite{
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+        const ResourceUsage fragmentDepthRead{
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+        m_renderGraph->addPass("shadow map")
+            .write(m_shadowMapResource, shadowDepthWrite)
+            .execute([this](FrameInfo& frameInfo) { m_shadowMapSystem->render(frameInfo); });
+
+        m_renderGraph->addPass("shadow moments")
+            .read(m_shadowMapResource, { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL })
+            .write(m_shadowMomentsResource, {
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL })
+            .execute([this](FrameInfo& frameInfo) { m_shadowMapSystem->renderMoments(frameInfo); });
+
+        m_renderGraph->addPass("point shadows")
+            .write(m_pointShadowResource, {
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL })
+            .execute([this](FrameInfo& frameInfo) {
+                m_pointShadowSystem->render(frameInfo);
+                if (m_timestampPool != VK_NULL_HANDLE) {
+                    vkCmdWriteTimestamp(frameInfo.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, frameInfo.frameIndex * TIMESTAMPS_PER_FRAME + 1);
+                }
+            });
+
+        // Overlaps the shadow passes on the async compute queue, the main pass waits for it at the fragment shader
+        m_renderGraph->addPass("light clusters")
+            .write(m_lightClusterResource, { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT })
+            .asyncCompute()
+            .execute([this](FrameInfo& frameInfo) { m_lightClusterSystem->dispatch(frameInfo); });
+
+        // Only the passes the main pass samples from survive, the light grid is a forward only input and the
+        // moments an EVSM only one
+        auto& mainPass = m_renderGraph->addPass("main");
+        mainPass
+            .read(m_shadowMapResource, fragmentDepthRead)
+            .read(m_pointShadowResource, fragmentDepthRead)
+            .write(m_sceneColorResource, {
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL })
+            .execute([this](FrameInfo& frameInfo) {
+                // Bracketed in the graphics command buffer itself, the gap after the early batch holds the acquire
+                // and async compute waits
+                uint32_t firstQuery = frameInfo.frameIndex * TIMESTAMPS_PER_FRAME;
+                if (m_timestampPool != VK_NULL_HANDLE) {
+                    vkCmdWriteTimestamp(frameInfo.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool, firstQuery + 2);
+                }
+                renderMainPass(frameInfo);
+                if (m_timestampPool != VK_NULL_HANDLE) {
+                    vkCmdWriteTimestamp(frameInfo.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, firstQuery + 3);
+                }
+            });
+        if (m_shadingVariant.shadowFilter == ShadowFilter::EVSM) {
+            mainPass.read(m_shadowMomentsResource, { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+        }
+        if (m_renderMode == RenderMode::Forward) {
+            mainPass.read(m_lightClusterResource, { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT });
+        }
 
-            if (obj.directionalLight == nullptr)
-                continue;
+        m_renderGraph->addPass("upscale")
+            .read(m_sceneColorResource, { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL })
+            .markOutput()
+            .execute([this](FrameInfo& frameInfo) { renderUpscalePass(frameInfo); });
 
-            auto rotateLight = glm::rotate(glm::mat4(1.0f), frameInfo.deltaTime, { 0.0f, -1.0f, 0.0f });
-            float zNear = 1.0f;
-            float zFar = 94.0f;
-            glm::mat4 depthProjectionMatrix = glm::perspective(glm::radians(obj.directionalLight->fov), m_swapChain->extentAspectRatio(), zNear, zFar);
-            glm::mat4 depthViewMatrix = glm::lookAt(obj.transform->translation, glm::vec3(0.0f), glm::vec3(0, 1, 0));
+        // Replaced transients are kept until the frames submitted so far have finished with them
+        m_renderGraph->compile(m_swapChain->getSubmittedFrame());
+        m_renderGraphDirty = false;
 
-            obj.transform->translation = glm::vec3(rotateLight * glm::vec4(obj.transform->translation, 1.0f));
-            ubs.directionalLight.position = glm::vec4(obj.transform->translation, 1.0f);
-            ubs.directionalLight.viewProjection = depthProjectionMatrix * depthViewMatrix;
+        VkImageView sceneColorView = m_renderGraph->getImageView(m_sceneColorResource);
+        if (sceneColorView != m_sceneColorView) {
+            m_sceneColorView = sceneColorView;
+            m_swapChain->setSceneColor(sceneColorView);
+            m_upscaleSystem->setSource(sceneColorView);
         }
-        
-        m_core.sceneBuffers[frameIndex]->writeToBuffer(&ubs);
-        m_core.sceneBuffers[frameIndex]->flush();
+    }
+
+    void VkeRenderer::renderMainPass(FrameInfo& frameInfo) {
+        beginSwapChainRenderPass(frameInfo.commandBuffer);
+        if (m_renderMode == RenderMode::Deferred) {
+            m_geometrySubPass->drawGBuffer(frameInfo);
+            vkCmdNextSubpass(frameInfo.commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+            uint32_t lightCount = static_cast<uint32_t>(m_pointLightSystem->getLights().size());
+            m_lightingSubpass->draw(frameInfo, m_currentImageIndex, lightCount);
+            m_pointLightSystem->render(frameInfo, true);
+        }
+        else {
+            if (m_geometrySubPass->isDepthPrepassEnabled()) {
+                m_geometrySubPass->drawDepthPrepass(frameInfo);
+            }
+            m_geometrySubPass->draw(frameInfo);
+            m_pointLightSystem->render(frameInfo);
+        }
+        endSwapChainRenderPass(frameInfo.commandBuffer);
+    }
+
+    void VkeRenderer::renderUpscalePass(FrameInfo& frameInfo) {
+        VkExtent2D swapChainExtent = m_swapChain->getSwapChainExtent();
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_swapChain->getPresentRenderPass();
+        renderPassInfo.framebuffer = m_swapChain->getPresentFrameBuffer(m_currentImageIndex);
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = swapChainExtent;
+
+        vkCmdBeginRenderPass(frameInfo.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        m_upscaleSystem->render(frameInfo, m_renderExtent, swapChainExtent, swapChainExtent);
+        vkCmdEndRenderPass(frameInfo.commandBuffer);
     }
 
     void VkeRenderer::update(VkeCamera& activeCamera, VkeGameObject::Map& gameObjects, float dt) {
         if (auto commandBuffer = beginFrame()) {
             int frameIndex = getFrameIndex();
+            m_renderExtent = m_dynamicResolution.scaledExtent(m_swapChain->getSwapChainExtent());
             float aspectRatio = getAspectRatio();
             activeCamera.setPespectiveProjection(glm::radians(90.0f), aspectRatio, 0.01f, 1000.0f);
             activeCamera.updateViewYXZ();
 
-            FrameInfo frameInfo = { frameIndex, dt, commandBuffer, activeCamera, m_core.getSets(frameIndex), gameObjects};
+            // The only place the renderer reads game objects, every pass below works from the packet
+            RenderPacket& renderPacket = m_renderPackets[frameIndex];
+            renderPacket.extract(gameObjects);
+
+            FrameInfo frameInfo = {
+                frameIndex,
+                dt,
+                commandBuffer,
+                activeCamera,
+                m_core.getSets(frameIndex),
+                renderPacket,
+                *m_core.frameDescriptorAllocators[frameIndex] };
             updateDescriptorSets(frameInfo);
 
             assert(m_isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
             assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
             
-            // Shadow render pass
-            m_shadowMapSystem->render(frameInfo);
+            // The early command buffer is submitted first, the frame's timestamps start there
+            GraphCommandBuffers graphCommandBuffers{};
+            graphCommandBuffers.early = m_earlyCommandBuffers[frameIndex];
+            graphCommandBuffers.graphics = commandBuffer;
+
+            uint32_t firstQuery = frameIndex * TIMESTAMPS_PER_FRAME;
+            if (m_timestampPool != VK_NULL_HANDLE) {
+                vkCmdResetQueryPool(graphCommandBuffers.early, m_timestampPool, firstQuery, TIMESTAMPS_PER_FRAME);
+                vkCmdWriteTimestamp(graphCommandBuffers.early, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool, firstQuery);
+            }
 
-            // Main render pass
-            beginSwapChainRenderPass(commandBuffer);
-            m_geometrySubPass->draw(frameInfo);
-            m_pointLightSystem->render(frameInfo);
-            endSwapChainRenderPass(frameInfo.commandBuffer);
+            if (m_renderGraphDirty) {
+                buildRenderGraph();
+            }
+            if (m_renderGraph->hasAsyncWork()) {
+                graphCommandBuffers.compute = m_asyncCompute->begin(frameIndex);
+            }
+            m_renderGraph->execute(frameInfo, graphCommandBuffers);
+
+            // Submitted ahead of the graphics work that waits for it
+            if (graphCommandBuffers.compute != VK_NULL_HANDLE) {
+                uint64_t computeValue = m_asyncCompute->submit(frameIndex);
+                m_computeWaitValue = m_renderGraph->getAsyncWaitStages() != 0 ? computeValue : 0;
+            }
+            if (m_timestampPool != VK_NULL_HANDLE) {
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, firstQuery + 4);
+                m_timestampsWritten[frameIndex] = true;
+            }
 
             endFrame();
         }
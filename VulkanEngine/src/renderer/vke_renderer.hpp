@@ -4,14 +4,23 @@
 #include "../core/vke_device.hpp"
 #include "../core/vke_swap_chain.hpp"
 #include "../core/vke_core.hpp"
+#include "../core/vke_render_graph.hpp"
+#include "../core/vke_async_compute.hpp"
 #include "../scene/vke_game_object.hpp"
 
 // Systems
 #include "../renderer/geometry_subpass.hpp"
+#include "../renderer/lighting_subpass.hpp"
 #include "../renderer/point_light_system.hpp"
 #include "../renderer/shadow_map_system.hpp"
+#include "../renderer/shading_variant.hpp"
+#include "../renderer/point_shadow_system.hpp"
+#include "../renderer/light_cluster_system.hpp"
+#include "../renderer/upscale_system.hpp"
+#include "../renderer/dynamic_resolution.hpp"
 
 // std
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <vector>
@@ -19,9 +28,28 @@
 #include <array>
 
 namespace vke {
+	enum class RenderMode {
+		Forward,	// Clustered forward, single subpass
+		Deferred	// G-buffer subpass followed by a lighting subpass
+	};
+
+	// Where the CPU blocks on the GPU relative to reading input, see VkeRenderer::waitForFrameStart
+	enum class LatencyMode {
+		Queued,		// Records up to frames in flight ahead, highest throughput
+		JustInTime	// Waits for the previous frame to finish first, input is sampled as late as possible
+	};
+
+	// Milliseconds spent on the GPU by the last frame whose results are available
+	struct GpuTimings {
+		float shadowMs = 0.0f;
+		float mainMs = 0.0f;
+		float upscaleMs = 0.0f;
+	};
+
 	class VkeRenderer {
 	public:
-		VkeRenderer(VkeWindow& window, VkeDevice& device);
+		// framesInFlight within [MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT], sizes every per frame resource
+		VkeRenderer(VkeWindow& window, VkeDevice& device, const SwapChainConfig& swapChainConfig = SwapChainConfig{});
 		~VkeRenderer();
 
 		VkeRenderer(const VkeRenderer&) = delete;
@@ -46,29 +74,122 @@ namespace vke {
 			return m_commandBuffers[m_currentFrameIndex];
 		}
 		VkRenderPass getSwapChainRenderPass() const { return m_swapChain->getRenderPass(); }
+		uint32_t getFramesInFlight() const { return m_swapChainConfig.framesInFlight; }
+
+		// Both recreate the swap chain, call between frames
+		void setPresentMode(PresentMode mode);
+		PresentMode getPresentMode() const { return m_swapChain->getPresentMode(); }
+		PresentMode getRequestedPresentMode() const { return m_swapChainConfig.presentMode; }
+		void setSwapChainImageCount(uint32_t imageCount);
+		uint32_t getSwapChainImageCount() const { return static_cast<uint32_t>(m_swapChain->imageCount()); }
+
+		// Call before polling input. Blocks for as long as the latency mode requires, so the input and camera of
+		// the next frame are as recent as possible when recording starts
+		void waitForFrameStart();
+		void setLatencyMode(LatencyMode mode) { m_latencyMode = mode; }
+		LatencyMode getLatencyMode() const { return m_latencyMode; }
+
+		// Depth only pass before the main pass, main pass then shades with an EQUAL depth test
+		void setDepthPrepass(bool enabled) { m_geometrySubPass->setDepthPrepass(enabled); }
+		bool isDepthPrepassEnabled() const { return m_geometrySubPass->isDepthPrepassEnabled(); }
+
+		// Depth prepass only applies to the forward path
+		void setRenderMode(RenderMode mode) { m_renderMode = mode; m_renderGraphDirty = true; }
+		RenderMode getRenderMode() const { return m_renderMode; }
+
+		// Swaps every lighting pipeline to the variant's specialization. Without point shadows the point shadow
+		// pass draws nothing and the shaders skip the lookup
+		void setShadingVariant(const ShadingVariant& variant);
+		const ShadingVariant& getShadingVariant() const { return m_shadingVariant; }
+
+		// Swaps every pipeline that samples the directional shadow map to the filter's variant
+		void setShadowFilter(ShadowFilter filter);
+		ShadowFilter getShadowFilter() const { return m_shadingVariant.shadowFilter; }
+		void setCascadeCount(int count) { m_shadowMapSystem->setCascadeCount(count); }
+		int getCascadeCount() const { return m_shadowMapSystem->getCascadeCount(); }
+
+		// All zero when the graphics queue doesn't support timestamps
+		const GpuTimings& getGpuTimings() const { return m_gpuTimings; }
+
+		// The scene renders at a fraction of the swap chain extent picked from the GPU timings, then is upscaled
+		// to the swap chain. Disabled, the scale stays at the config's maximum
+		void setDynamicResolution(const DynamicResolutionConfig& config) { m_dynamicResolution.setConfig(config); }
+		const DynamicResolutionConfig& getDynamicResolution() const { return m_dynamicResolution.getConfig(); }
+		float getResolutionScale() const { return m_dynamicResolution.getScale(); }
+		VkExtent2D getRenderExtent() const { return m_renderExtent; }
+		void setUpscaleFilter(UpscaleFilter filter) { m_upscaleSystem->setFilter(filter); }
+		UpscaleFilter getUpscaleFilter() const { return m_upscaleSystem->getFilter(); }
 
 	private:
 		void createCommandBuffers();
 		void freeCommandBuffers();
-		void recreateSwapChain();
+		// False while the window is minimized, frames are skipped until it has an area again
+		bool recreateSwapChain();
+		void releaseRetiredSwapChains();
 		void updateDescriptorSets(FrameInfo& frameInfo);
+		void buildRenderGraph();
+		void renderMainPass(FrameInfo& frameInfo);
+		void renderUpscalePass(FrameInfo& frameInfo);
 
 		VkeWindow& m_window;
 		VkeDevice& m_device;
 
 		std::unique_ptr<VkeSwapChain> m_swapChain;
+		bool m_swapChainOutdated = false; // Recreated at the start of the next frame, resizes until then coalesce
+
+		// Replaced swap chains the GPU may still render to, destroyed once the frame timeline passes lastFrame
+		struct RetiredSwapChain {
+			std::shared_ptr<VkeSwapChain> swapChain;
+			uint64_t lastFrame;
+		};
+		std::vector<RetiredSwapChain> m_retiredSwapChains;
 		std::vector<VkCommandBuffer> m_commandBuffers;
+		std::vector<VkCommandBuffer> m_earlyCommandBuffers; // Passes that overlap async compute, submitted first
+		std::vector<RenderPacket> m_renderPackets; // One per frame in flight
 
 		// Descriptor heap
 		VkeCore m_core;
 
 		// Render
 		std::unique_ptr<VkeShadowMapSystem> m_shadowMapSystem;
+		std::unique_ptr<VkePointShadowSystem> m_pointShadowSystem;
+		std::unique_ptr<VkeLightClusterSystem> m_lightClusterSystem;
 		std::unique_ptr<GeometrySubpass> m_geometrySubPass;
+		std::unique_ptr<LightingSubpass> m_lightingSubpass;
 		std::unique_ptr<PointLightSystem> m_pointLightSystem;
+		std::unique_ptr<VkeUpscaleSystem> m_upscaleSystem;
+
+		// Extent of this frame's scene passes, the top left corner of the scene color target
+		VkeDynamicResolution m_dynamicResolution;
+		VkExtent2D m_renderExtent{};
 
+		// Rebuilt when the render mode or shading variant changes which passes the main pass depends on
+		std::unique_ptr<VkeRenderGraph> m_renderGraph;
+		bool m_renderGraphDirty = true;
+		std::unique_ptr<VkeAsyncCompute> m_asyncCompute;
+		uint64_t m_computeWaitValue = 0; // Async compute submission the frame being recorded waits for, 0 for none
+		RenderResource m_shadowMapResource = RENDER_GRAPH_INVALID_RESOURCE;
+		RenderResource m_shadowMomentsResource = RENDER_GRAPH_INVALID_RESOURCE;
+		RenderResource m_pointShadowResource = RENDER_GRAPH_INVALID_RESOURCE;
+		RenderResource m_lightClusterResource = RENDER_GRAPH_INVALID_RESOURCE;
+		RenderResource m_sceneColorResource = RENDER_GRAPH_INVALID_RESOURCE;
+		VkImageView m_sceneColorView = VK_NULL_HANDLE; // What the swap chain's scene framebuffers were built around
+
+		SwapChainConfig m_swapChainConfig;
+		LatencyMode m_latencyMode = LatencyMode::Queued;
 		uint32_t m_currentImageIndex;
-		int m_currentFrameIndex{ 0 };
+		int m_currentFrameIndex{ 0 }; // Mirrors the swap chain's current frame while a frame is in progress
 		bool m_isFrameStarted = false;
+		RenderMode m_renderMode = RenderMode::Forward;
+		ShadingVariant m_shadingVariant;
+
+		// GPU timestamps, TIMESTAMPS_PER_FRAME queries for each frame in flight
+		void createTimestampPool();
+		void readTimestamps();
+		// Frame start, shadows done, main pass start, main pass done, upscale done
+		static constexpr uint32_t TIMESTAMPS_PER_FRAME = 5;
+		VkQueryPool m_timestampPool = VK_NULL_HANDLE;
+		std::vector<bool> m_timestampsWritten;
+		GpuTimings m_gpuTimings{};
 	};
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <glm/gtx/hash.hpp>
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -27,10 +28,29 @@ namespace vke {
     VkeModel::VkeModel(VkeDevice& device, const ModelData& modelData) : m_device{ device } {
         createVertexBuffers(modelData.vertices);
         createIndexBuffers(modelData.indices);
+        computeBounds(modelData.vertices);
     }
 
     VkeModel::~VkeModel() { }
 
+    void VkeModel::computeBounds(const std::vector<Vertex>& vertices) {
+        if (vertices.empty())
+            return;
+
+        // Centered on the AABB, looser than a minimal sphere but one pass
+        glm::vec3 minPosition = vertices[0].position;
+        glm::vec3 maxPosition = vertices[0].position;
+        for (auto& vertex : vertices) {
+            minPosition = glm::min(minPosition, vertex.position);
+            maxPosition = glm::max(maxPosition, vertex.position);
+        }
+
+        m_boundingCenter = (minPosition + maxPosition) * 0.5f;
+        for (auto& vertex : vertices) {
+            m_boundingRadius = std::max(m_boundingRadius, glm::length(vertex.position - m_boundingCenter));
+        }
+    }
+
     std::unique_ptr<VkeModel>VkeModel::createModelFromFile(VkeDevice& device, const std::string& filePath) {
         ModelData modelData{};
         modelData.loadModel(ASSET_DIR + filePath);
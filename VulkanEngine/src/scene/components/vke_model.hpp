@@ -51,9 +51,14 @@ namespace vke {
 		void bind(VkCommandBuffer& commandBuffer);
 		void draw(VkCommandBuffer& commandBuffer);
 
+		// Object space bounding sphere, used for culling
+		glm::vec3 getBoundingCenter() const { return m_boundingCenter; }
+		float getBoundingRadius() const { return m_boundingRadius; }
+
 	private:
 		void createVertexBuffers(const std::vector<Vertex> &vertices);
 		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		void computeBounds(const std::vector<Vertex>& vertices);
 
 		VkeDevice& m_device;
 
@@ -63,5 +68,8 @@ namespace vke {
 		bool m_hasIndexBuffer = false;
 		std::unique_ptr<VkeBuffer> m_indexBuffer;
 		uint32_t m_indexCount;
+
+		glm::vec3 m_boundingCenter{ 0.0f };
+		float m_boundingRadius = 0.0f;
 	};
 }
\ No newline at end of file
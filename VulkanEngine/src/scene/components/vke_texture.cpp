@@ -49,6 +49,7 @@ namespace vke {
 		// Memory and staging buffer will clean themselves
 		createTextureImageView();
 		createTextureSampler();
+		m_bindlessIndex = m_device.bindlessHeap().addTexture(getDescriptorImageInfo());
 		m_ready = true;
 	}
 
@@ -183,6 +184,9 @@ namespace vke {
 	}
 
 	VkeTexture::~VkeTexture() {
+		if (m_bindlessIndex != BINDLESS_INVALID_INDEX) {
+			m_device.bindlessHeap().removeTexture(m_bindlessIndex);
+		}
 		vkDestroyImageView(m_device.device(), m_data.view, nullptr);
 		vkDestroyImage(m_device.device(), m_data.image, nullptr);
 		vkDestroySampler(m_device.device(), m_data.sampler, nullptr);
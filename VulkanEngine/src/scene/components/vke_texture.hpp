@@ -2,6 +2,7 @@
 
 #include "../../core/vke_buffer.hpp"
 #include "../../core/vke_descriptors.hpp"
+#include "../../core/vke_bindless_heap.hpp"
 
 #ifndef ASSET_DIR
 #define ASSET_DIR "../assets/"
@@ -35,6 +36,9 @@ namespace vke {
 		int32_t getWidth() { return m_width; }
 		int32_t getHeight() { return m_height; }
 		id_t getId() { return m_id; }
+
+		// Slot in the bindless texture array, what shaders index with
+		uint32_t getBindlessIndex() const { return m_bindlessIndex; }
 	private:
 		void createTextureImage(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags memProperties);
 		void createTextureImageView();
@@ -57,5 +61,6 @@ namespace vke {
 		uint32_t	m_mip_level;
 
 		id_t		m_id;
+		uint32_t	m_bindlessIndex = BINDLESS_INVALID_INDEX;
 	};
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../scene/components/vke_model.hpp"
+#include "../scene/components/vke_texture.hpp"
 #include "../scene/components/transform.hpp"
 
 // std
@@ -12,6 +13,7 @@ namespace vke {
 	struct PointLightComponent {
 		float lightIntensity = 1.0f;
 		float radius = 1.0f;
+		bool castsShadows = false; // Competes for one of the MAX_SHADOWED_POINT_LIGHTS shadow slots
 	};
 
 	struct DirectionalLightComponent {
@@ -43,6 +45,8 @@ namespace vke {
 		glm::vec3 color{};
 
 		std::shared_ptr<VkeModel> model{};
+		std::shared_ptr<VkeTexture> texture{}; // Albedo, sampled through the bindless heap
+		bool isStatic = false; // Never moves, shadow casters are cached while this holds
 
 		std::shared_ptr<PointLightComponent> pointLight = nullptr;
 		std::shared_ptr<DirectionalLightComponent> directionalLight = nullptr;
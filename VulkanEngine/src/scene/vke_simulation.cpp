@@ -0,0 +1,145 @@
+#include "vke_simulation.hpp"
+
+// libs
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#define CAMERA_LOOK_SPEED 1.0f
+#define CAMERA_MOVE_SPEED 2.0f
+#define LIGHT_ORBIT_SPEED 1.0f // Radians per second around the Y axis
+
+namespace vke {
+    VkeSimulation::VkeSimulation(const VkeGameObject::Map& gameObjects, const VkeCamera& camera, float tickRate)
+        : m_tickSeconds{ 1.0f / tickRate } {
+        assert(tickRate > 0.0f && "Simulation tick rate must be positive");
+
+        m_state.cameraPosition = camera.position;
+        m_state.cameraEulerAngles = camera.eulerAngles;
+        for (auto& kv : gameObjects) {
+            auto& obj = kv.second;
+            if (obj.pointLight == nullptr && obj.directionalLight == nullptr)
+                continue;
+
+            m_state.transforms.push_back({ kv.first, obj.transform->translation });
+        }
+
+        // Until the first tick every snapshot is the initial state
+        for (auto& snapshot : m_snapshots) {
+            snapshot = m_state;
+        }
+        m_previous = m_state;
+    }
+
+    VkeSimulation::~VkeSimulation() {
+        stop();
+    }
+
+    void VkeSimulation::start() {
+        assert(!m_running && "Simulation already running");
+        m_running = true;
+        m_start = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_state.time));
+        m_thread = std::thread(&VkeSimulation::run, this);
+    }
+
+    void VkeSimulation::stop() {
+        m_running = false;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void VkeSimulation::setInput(const InputState& input) {
+        std::lock_guard<std::mutex> lock(m_inputMutex);
+        m_input = input;
+    }
+
+    void VkeSimulation::run() {
+        auto tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(m_tickSeconds));
+        auto maxLag = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(SIMULATION_MAX_LAG));
+        auto next = m_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_state.time));
+
+        while (m_running) {
+            next += tick;
+            auto now = Clock::now();
+            if (now - next > maxLag) {
+                // Stalled, e.g. by a debugger. Skip ahead instead of running a burst of ticks, the next
+                // snapshot simply spans a longer time
+                next = now;
+            }
+            std::this_thread::sleep_until(next);
+
+            InputState input;
+            {
+                std::lock_guard<std::mutex> lock(m_inputMutex);
+                input = m_input;
+            }
+
+            step(m_state, input, m_tickSeconds);
+            m_state.tick++;
+            m_state.time = std::chrono::duration<double>(next - m_start).count();
+            publish();
+        }
+    }
+
+    void VkeSimulation::step(SceneSnapshot& state, const InputState& input, float dt) {
+        if (glm::dot(input.look, input.look) > std::numeric_limits<float>::epsilon()) {
+            state.cameraEulerAngles += glm::normalize(input.look) * CAMERA_LOOK_SPEED * dt;
+        }
+        state.cameraEulerAngles.x = glm::clamp(state.cameraEulerAngles.x, -glm::pi<float>() / 2.0f, glm::pi<float>() / 2.0f);
+
+        if (glm::dot(input.move, input.move) > std::numeric_limits<float>::epsilon()) {
+            state.cameraPosition += glm::normalize(input.move) * CAMERA_MOVE_SPEED * dt;
+        }
+
+        // Lights orbit the origin
+        auto rotateLight = glm::rotate(glm::mat4(1.0f), LIGHT_ORBIT_SPEED * dt, { 0.0f, -1.0f, 0.0f });
+        for (auto& transform : state.transforms) {
+            transform.translation = glm::vec3(rotateLight * glm::vec4(transform.translation, 1.0f));
+        }
+    }
+
+    void VkeSimulation::publish() {
+        // Copy assignment reuses the snapshot's vector storage
+        m_snapshots[m_writeIndex] = m_state;
+        uint32_t ready = m_ready.exchange(m_writeIndex | FRESH_SNAPSHOT, std::memory_order_acq_rel);
+        m_writeIndex = ready & ~FRESH_SNAPSHOT;
+    }
+
+    bool VkeSimulation::consume() {
+        if ((m_ready.load(std::memory_order_acquire) & FRESH_SNAPSHOT) == 0) {
+            return false;
+        }
+
+        // The current snapshot becomes the previous one, the slot handed back holds stale data the simulation overwrites
+        std::swap(m_previous, m_snapshots[m_readIndex]);
+        uint32_t ready = m_ready.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = ready & ~FRESH_SNAPSHOT;
+        return true;
+    }
+
+    void VkeSimulation::apply(VkeGameObject::Map& gameObjects, VkeCamera& camera) {
+        consume();
+        const SceneSnapshot& current = m_snapshots[m_readIndex];
+
+        // One tick behind the simulation clock, so there is almost always a newer snapshot to interpolate towards
+        double renderTime = std::chrono::duration<double>(Clock::now() - m_start).count() - m_tickSeconds;
+        double span = current.time - m_previous.time;
+        float alpha = span > 0.0 ? static_cast<float>(std::clamp((renderTime - m_previous.time) / span, 0.0, 1.0)) : 1.0f;
+
+        camera.position = glm::mix(m_previous.cameraPosition, current.cameraPosition, alpha);
+        camera.eulerAngles = glm::mix(m_previous.cameraEulerAngles, current.cameraEulerAngles, alpha);
+
+        assert(m_previous.transforms.size() == current.transforms.size() && "Simulated object set changed");
+        for (size_t i = 0; i < current.transforms.size(); i++) {
+            auto obj = gameObjects.find(current.transforms[i].id);
+            if (obj == gameObjects.end())
+                continue;
+
+            obj->second.transform->translation = glm::mix(m_previous.transforms[i].translation, current.transforms[i].translation, alpha);
+        }
+    }
+}
\ No newline at end of file
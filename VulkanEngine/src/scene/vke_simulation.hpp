@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../scene/vke_game_object.hpp"
+#include "../scene/components/vke_camera.hpp"
+
+// std
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define SIMULATION_TICK_RATE 60.0f
+// Behind by more than this the simulation drops ticks instead of trying to catch up
+#define SIMULATION_MAX_LAG 0.25f
+
+namespace vke {
+	// Keyboard state sampled on the main thread, GLFW input can only be read there
+	struct InputState {
+		glm::vec3 look{ 0.0f };	// Euler angle directions, x pitch, y yaw
+		glm::vec3 move{ 0.0f };	// World space directions
+	};
+
+	struct SimulatedTransform {
+		VkeGameObject::id_t id;
+		glm::vec3 translation;
+	};
+
+	// Everything the simulation owns, copied whole into a snapshot after each tick
+	struct SceneSnapshot {
+		double time = 0.0; // Seconds since the simulation started, at the end of the tick
+		uint64_t tick = 0;
+		glm::vec3 cameraPosition{ 0.0f };
+		glm::vec3 cameraEulerAngles{ 0.0f };
+		std::vector<SimulatedTransform> transforms; // Animated lights
+	};
+
+	// Steps the scene at a fixed rate on its own thread, a slow frame never slows the simulation down. Ticks are
+	// published through a triple buffer: the simulation fills a free snapshot and swaps it with the ready one, the
+	// render thread swaps the ready one with its own. Neither side ever waits on the other
+	class VkeSimulation {
+	public:
+		VkeSimulation(const VkeGameObject::Map& gameObjects, const VkeCamera& camera, float tickRate = SIMULATION_TICK_RATE);
+		~VkeSimulation();
+
+		VkeSimulation(const VkeSimulation&) = delete;
+		VkeSimulation& operator=(const VkeSimulation&) = delete;
+
+		void start();
+		void stop();
+
+		// Render thread. Input is consumed by every tick until the next call
+		void setInput(const InputState& input);
+
+		// Render thread. Writes the state one tick in the past, interpolated between the two latest snapshots, into
+		// the camera and the game objects' transforms. The game objects are never touched by the simulation thread
+		void apply(VkeGameObject::Map& gameObjects, VkeCamera& camera);
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		void run();
+		void step(SceneSnapshot& state, const InputState& input, float dt);
+		void publish();
+		bool consume();
+
+		float m_tickSeconds;
+		Clock::time_point m_start; // Set before the thread starts and never written while it runs
+		std::thread m_thread;
+		std::atomic<bool> m_running{ false };
+
+		std::mutex m_inputMutex;
+		InputState m_input{};
+
+		// Simulation thread only
+		SceneSnapshot m_state;
+
+		// Triple buffer, m_ready holds the ready index and FRESH_SNAPSHOT once the simulation published it
+		static constexpr uint32_t FRESH_SNAPSHOT = 0x4;
+		std::array<SceneSnapshot, 3> m_snapshots;
+		std::atomic<uint32_t> m_ready{ 1 };
+		uint32_t m_writeIndex = 0;	// Simulation thread
+		uint32_t m_readIndex = 2;	// Render thread
+
+		// Render thread, the snapshot consumed before m_readIndex
+		SceneSnapshot m_previous;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+// Bindless heap, set 3 of every pipeline, see vke_bindless_heap.hpp.
+// Expects GL_EXT_nonuniform_qualifier to be enabled by the including shader
+
+#define BINDLESS_INVALID_INDEX 0xFFFFFFFFu
+
+layout(set = 3, binding = 0) uniform sampler2D bindlessTextures[];
+layout(std430, set = 3, binding = 1) readonly buffer BindlessBuffer{
+	uint words[];
+} bindlessBuffers[];
+
+// White for untextured draws. The index may differ between invocations once it comes from a buffer
+vec4 sampleBindless(uint textureIndex, vec2 uv)
+{
+	if (textureIndex == BINDLESS_INVALID_INDEX)
+	{
+		return vec4(1.0);
+	}
+	return texture(bindlessTextures[nonuniformEXT(textureIndex)], uv);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout (location = 0) out vec4 outFragColor;
+
+#include "deferred_common.glsl"
+
+// Ambient and directional shadow, once per pixel. Point lights are added on top by the light volumes
+void main() {
+	float depth = subpassLoad(gbufferDepth).r;
+	if (depth >= 1.0){
+		discard;
+	}
+
+	vec3 positionWorld = worldPositionFromDepth(depth);
+	vec3 albedo = subpassLoad(gbufferAlbedo).rgb;
+
+	float shadow = directionalShadow(positionWorld, (cluster.view * vec4(positionWorld, 1.0f)).z);
+	vec3 ambientLight = ubs.ambientLightColor.xyz * ubs.ambientLightColor.w;
+	outFragColor = vec4(shadow * ambientLight * albedo, 1.0f);
+}
\ No newline at end of file
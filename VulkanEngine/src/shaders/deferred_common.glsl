@@ -0,0 +1,60 @@
+// Lighting subpass resources of the deferred path, see renderer/lighting_subpass.cpp
+
+struct PointLight{
+	vec4 position; // w = range
+	vec4 color;
+	int shadowIndex; // -1 when unshadowed
+};
+
+#define MAX_SHADOW_CASCADES 4
+#define MAX_SHADOWED_POINT_LIGHTS 8
+
+struct DirectionalLight {
+	vec4 position;
+	mat4 viewProjection[MAX_SHADOW_CASCADES];
+	vec4 cascadeSplits; // view depth where each cascade ends
+};
+
+layout (set = 1, binding = 0) uniform sampler2DArrayShadow shadowMap;
+layout (set = 1, binding = 1) uniform sampler2DArray pointShadowMap;
+layout (set = 1, binding = 2) uniform sampler2DArray shadowDepth;
+layout (set = 1, binding = 3) uniform sampler2DArray shadowMoments;
+
+layout(set = 0, binding = 1) uniform UniformBufferScene{
+	mat4 inverseView;
+	vec4 ambientLightColor;
+	DirectionalLight directionalLight;
+	mat4 pointShadowMatrices[MAX_SHADOWED_POINT_LIGHTS * 6]; // Cube faces +X -X +Y -Y +Z -Z per slot
+	vec4 pointShadowTiles[MAX_SHADOWED_POINT_LIGHTS]; // Atlas uv offset in xy, scale in zw
+	int numLights;
+	int cascadeCount;
+} ubs;
+
+layout(set = 2, binding = 0) uniform ClusterInfo{
+	mat4 inverseProjection;
+	mat4 view;
+	uvec4 gridSize; // w = max lights per cluster
+	vec2 screenSize;
+	float zNear;
+	float zFar;
+	uint lightCount;
+} cluster;
+
+layout(std430, set = 2, binding = 1) readonly buffer Lights{
+	PointLight lights[];
+};
+
+// G-buffer, read at the current pixel only
+layout (input_attachment_index = 0, set = 4, binding = 0) uniform subpassInput gbufferAlbedo;
+layout (input_attachment_index = 1, set = 4, binding = 1) uniform subpassInput gbufferNormal;
+layout (input_attachment_index = 2, set = 4, binding = 2) uniform subpassInput gbufferDepth;
+
+#include "shadow_sampling.glsl"
+#include "lighting.glsl"
+
+vec3 worldPositionFromDepth(float depth)
+{
+	vec2 ndc = gl_FragCoord.xy / cluster.screenSize * 2.0 - 1.0;
+	vec4 viewPosition = cluster.inverseProjection * vec4(ndc, depth, 1.0);
+	return (ubs.inverseView * vec4(viewPosition.xyz / viewPosition.w, 1.0)).xyz;
+}
\ No newline at end of file
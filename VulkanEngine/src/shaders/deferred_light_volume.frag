@@ -0,0 +1,25 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout (location = 0) flat in uint inLightIndex;
+layout (location = 0) out vec4 outFragColor;
+
+#include "deferred_common.glsl"
+
+// One point light, only for pixels inside its volume. Blended additively over the ambient pass
+void main() {
+	float depth = subpassLoad(gbufferDepth).r;
+	vec3 positionWorld = worldPositionFromDepth(depth);
+	vec3 albedo = subpassLoad(gbufferAlbedo).rgb;
+	vec3 surfaceNormal = subpassLoad(gbufferNormal).xyz;
+
+	vec3 cameraPositionWorld = ubs.inverseView[3].xyz;
+	vec3 viewDir = normalize(cameraPositionWorld - positionWorld);
+
+	vec3 diffuseLight = vec3(0.0f);
+	vec3 specularLight = vec3(0.0f);
+	addPointLight(lights[inLightIndex], positionWorld, surfaceNormal, viewDir, diffuseLight, specularLight);
+
+	float shadow = directionalShadow(positionWorld, (cluster.view * vec4(positionWorld, 1.0f)).z);
+	outFragColor = vec4((shadow * diffuseLight + specularLight) * albedo, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#version 450
+
+// Unit cube, wound counter clockwise seen from outside
+const vec3 CORNERS[8] = vec3[](
+	vec3(-1.0, -1.0, -1.0),
+	vec3( 1.0, -1.0, -1.0),
+	vec3(-1.0,  1.0, -1.0),
+	vec3( 1.0,  1.0, -1.0),
+	vec3(-1.0, -1.0,  1.0),
+	vec3( 1.0, -1.0,  1.0),
+	vec3(-1.0,  1.0,  1.0),
+	vec3( 1.0,  1.0,  1.0)
+);
+
+const int INDICES[36] = int[](
+	1, 3, 7,  1, 7, 5, // +x
+	0, 4, 6,  0, 6, 2, // -x
+	2, 6, 7,  2, 7, 3, // +y
+	0, 1, 5,  0, 5, 4, // -y
+	4, 5, 7,  4, 7, 6, // +z
+	0, 2, 3,  0, 3, 1  // -z
+);
+
+struct PointLight{
+	vec4 position; // w = range
+	vec4 color;
+	int shadowIndex; // -1 when unshadowed
+};
+
+layout(set = 0, binding = 0) uniform UniformBufferObject{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+	mat4 modelNormal;
+} ubo;
+
+layout(std430, set = 2, binding = 1) readonly buffer Lights{
+	PointLight lights[];
+};
+
+layout (location = 0) flat out uint outLightIndex;
+
+void main(){
+	PointLight light = lights[gl_InstanceIndex];
+	vec3 worldPosition = light.position.xyz + CORNERS[INDICES[gl_VertexIndex]] * light.position.w;
+
+	outLightIndex = gl_InstanceIndex;
+	gl_Position = ubo.projection * ubo.view * vec4(worldPosition, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 450
+layout(location = 0) in vec3 inPosition;
+
+layout(set = 0, binding = 0) uniform UniformBufferObject{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+	mat4 modelNormal;
+} ubo;
+
+layout(push_constant) uniform Push {
+	mat4 model;
+	mat4 modelNormal;
+	uint textureIndex;
+} push;
+
+out gl_PerVertex { invariant vec4 gl_Position; };
+
+void main() {
+	// Same transform order as simple_shader.vert so both passes produce identical depth
+	vec4 worldSpace = push.model * vec4(inPosition, 1.0);
+	gl_Position = ubo.projection * ubo.view * worldSpace;
+}
\ No newline at end of file
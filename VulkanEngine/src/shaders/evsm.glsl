@@ -0,0 +1,25 @@
+// Exponential variance shadow map warp, shared by the moment generation and the sampling shaders.
+// Exponents are kept within what 16 bit float moments can hold, see EVSM_FORMAT
+
+#define EVSM_POSITIVE_EXPONENT 5.0
+#define EVSM_NEGATIVE_EXPONENT 5.0
+#define EVSM_MIN_VARIANCE 0.0001
+#define EVSM_LIGHT_BLEED_REDUCTION 0.2
+
+// Depth in [0, 1] warped to (positive, negative) exponential space
+vec2 warpDepth(float depth)
+{
+	depth = 2.0 * depth - 1.0;
+	return vec2(exp(EVSM_POSITIVE_EXPONENT * depth), -exp(-EVSM_NEGATIVE_EXPONENT * depth));
+}
+
+float chebyshevUpperBound(vec2 moments, float mean, float minVariance)
+{
+	float variance = max(moments.y - moments.x * moments.x, minVariance);
+	float d = mean - moments.x;
+	float pMax = variance / (variance + d * d);
+
+	// Cut off the tail of the bound, trades a little contact softness for much less light bleeding
+	pMax = clamp((pMax - EVSM_LIGHT_BLEED_REDUCTION) / (1.0 - EVSM_LIGHT_BLEED_REDUCTION), 0.0, 1.0);
+	return mean <= moments.x ? 1.0 : pMax;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 inFragColor;
+layout(location = 1) in vec3 inFragPositionWorld;
+layout(location = 2) in vec3 inFragNormalWorld;
+layout(location = 3) in vec2 inFragTexCoord;
+
+// G-buffer, see VkeSwapChain::createDeferredRenderPass
+layout (location = 0) out vec4 outAlbedo;
+layout (location = 1) out vec4 outNormal;
+
+layout(push_constant) uniform Push {
+	mat4 model;
+	mat4 modelNormal;
+	uint textureIndex;
+} push;
+
+#include "bindless.glsl"
+
+void main() {
+	outAlbedo = vec4(inFragColor, 1.0f) * sampleBindless(push.textureIndex, inFragTexCoord);
+	outNormal = vec4(normalize(inFragNormalWorld), 0.0f);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+// Blinn-Phong point light, shared by the forward and deferred shaders.
+// Expects PointLight (position.w = range) to be declared and shadow_sampling.glsl to be included first
+
+layout (constant_id = 3) const float specularExponent = 512.0;
+
+void addPointLight(PointLight light, vec3 positionWorld, vec3 normal, vec3 viewDir, inout vec3 diffuseLight, inout vec3 specularLight)
+{
+	vec3 lightDir = light.position.xyz - positionWorld;
+	float distSquared = dot(lightDir, lightDir);
+
+	// Inverse square, windowed to reach zero at the binning range
+	float rangeFactor = distSquared / (light.position.w * light.position.w);
+	float window = clamp(1.0 - rangeFactor * rangeFactor, 0.0, 1.0);
+	float attenuation = window * window / distSquared;
+	if (pointShadowsEnabled && light.shadowIndex >= 0)
+	{
+		attenuation *= pointShadow(light.shadowIndex, light.position.xyz, positionWorld);
+	}
+	lightDir = normalize(lightDir);
+
+	// Diffuse
+	float cosAng = max(dot(normal, lightDir), 0);
+	vec3 intensity = light.color.xyz * light.color.w * attenuation;
+	
+	// Specular
+	vec3 halfAngle = normalize(lightDir + viewDir);
+	float blinn = dot(normal, halfAngle);
+	blinn = clamp(blinn, 0, 1);
+	blinn = pow(blinn, specularExponent);
+
+	specularLight += light.color.xyz * intensity * blinn;
+	diffuseLight += intensity * cosAng;
+}
\ No newline at end of file
@@ -9,11 +9,18 @@ const vec2 OFFSETS[6] = vec2[](
   vec2(1.0, 1.0)
 );
 
+// Per instance
+layout (location = 0) in vec4 lightPosition;
+layout (location = 1) in vec4 lightColor;
+layout (location = 2) in float lightRadius;
+
 layout (location = 0) out vec2 fragOffset;
+layout (location = 1) out vec4 fragColor;
 
 struct PointLight{
 	vec4 position;
 	vec4 color;
+	int shadowIndex; // -1 when unshadowed
 };
 
 layout(set = 0, binding = 0) uniform UniformBufferObject{
@@ -23,22 +30,17 @@ layout(set = 0, binding = 0) uniform UniformBufferObject{
 	mat4 modelNormal;
 } ubo;
 
-layout(push_constant) uniform Push{
-	vec4 position;
-	vec4 color;
-	float radius;
-} push;
-
 const float LIGHT_RADIUS = 0.1f;
 
 void main(){
 	fragOffset = OFFSETS[gl_VertexIndex];
+	fragColor = lightColor;
 	vec3 cameraRightWorld = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
 	vec3 cameraUpWorld = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
 
-	vec3 worldPosition = push.position.xyz
-		+ push.radius * fragOffset.x * cameraRightWorld
-		+ push.radius * fragOffset.y * cameraUpWorld;
+	vec3 worldPosition = lightPosition.xyz
+		+ lightRadius * fragOffset.x * cameraRightWorld
+		+ lightRadius * fragOffset.y * cameraUpWorld;
 
 	gl_Position = ubo.projection * ubo.view * vec4(worldPosition, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#version 450
+#extension GL_EXT_multiview : require
+
+// One draw covers all six cube faces of a point light, gl_ViewIndex is the face
+layout(location = 0) in vec3 inPosition;
+
+struct PointLight{
+	vec4 position;
+	vec4 color;
+	int shadowIndex; // -1 when unshadowed
+};
+
+#define MAX_SHADOW_CASCADES 4
+#define MAX_SHADOWED_POINT_LIGHTS 8
+
+struct DirectionalLight {
+	vec4 position;
+	mat4 viewProjection[MAX_SHADOW_CASCADES];
+	vec4 cascadeSplits; // view depth where each cascade ends
+};
+
+layout(set = 0, binding = 1) uniform UniformBufferScene{
+	mat4 inverseView;
+	vec4 ambientLightColor;
+	DirectionalLight directionalLight;
+	mat4 pointShadowMatrices[MAX_SHADOWED_POINT_LIGHTS * 6]; // Cube faces +X -X +Y -Y +Z -Z per slot
+	vec4 pointShadowTiles[MAX_SHADOWED_POINT_LIGHTS]; // Atlas uv offset in xy, scale in zw
+	int numLights;
+	int cascadeCount;
+} ubs;
+
+layout(push_constant) uniform Push {
+	mat4 modelMatrix;
+	int shadowIndex;
+	uint faceMask; // Faces the object overlaps, see VkePointShadowSystem::faceMask
+} push;
+
+out gl_PerVertex { vec4 gl_Position; };
+
+void main() {
+	// Negative w fails every clip plane, so faces the object misses rasterize nothing
+	if ((push.faceMask & (1u << gl_ViewIndex)) == 0u) {
+		gl_Position = vec4(0.0, 0.0, 0.0, -1.0);
+		return;
+	}
+
+	vec4 pos = push.modelMatrix * vec4(inPosition, 1.0);
+	gl_Position = ubs.pointShadowMatrices[push.shadowIndex * 6 + gl_ViewIndex] * pos;
+}
\ No newline at end of file
@@ -1,35 +1,39 @@
 #version 450
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec3 inNormal;
-layout(location = 3) in vec2 inTexCoord;
 
 struct PointLight{
 	vec4 position;
 	vec4 color;
+	int shadowIndex; // -1 when unshadowed
 };
 
+#define MAX_SHADOW_CASCADES 4
+#define MAX_SHADOWED_POINT_LIGHTS 8
+
 struct DirectionalLight {
 	vec4 position;
-	mat4 viewProjection;
+	mat4 viewProjection[MAX_SHADOW_CASCADES];
+	vec4 cascadeSplits; // view depth where each cascade ends
 };
 
 layout(set = 0, binding = 1) uniform UniformBufferScene{
 	mat4 inverseView;
 	vec4 ambientLightColor;
-	PointLight pointLights[10];
 	DirectionalLight directionalLight;
+	mat4 pointShadowMatrices[MAX_SHADOWED_POINT_LIGHTS * 6]; // Cube faces +X -X +Y -Y +Z -Z per slot
+	vec4 pointShadowTiles[MAX_SHADOWED_POINT_LIGHTS]; // Atlas uv offset in xy, scale in zw
 	int numLights;
+	int cascadeCount;
 } ubs;
 
 layout(push_constant) uniform Push {
 	mat4 modelMatrix;
-	mat4 normalMatrix;
+	int cascadeIndex;
 } push;
 
 out gl_PerVertex { vec4 gl_Position; };
 
 void main() {
 	vec4 pos = push.modelMatrix * vec4(inPosition, 1.0);
-	gl_Position = ubs.directionalLight.viewProjection * pos;
+	gl_Position = ubs.directionalLight.viewProjection[push.cascadeIndex] * pos;
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 #version 450
 
-layout (set = 1, binding = 0) uniform sampler2D shadowMap;
+layout (set = 1, binding = 2) uniform sampler2DArray shadowMap;
 
 layout (location = 0) in vec2 inUV;
 
@@ -16,6 +16,6 @@ float LinearizeDepth(float depth)
 
 void main() 
 {
-	float depth = texture(shadowMap, inUV).r;
+	float depth = texture(shadowMap, vec3(inUV, 0.0)).r;
 	outFragColor = vec4(vec3(1.0-LinearizeDepth(depth)), 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,180 @@
+// Directional light shadow sampling, shared by the forward and deferred shaders.
+// Expects shadowMap (set = 1, binding = 0, comparison sampler, one layer per cascade), pointShadowMap (binding = 1),
+// shadowDepth (binding = 2, same image without comparison), shadowMoments (binding = 3) and ubs to be declared
+// by the including shader
+
+#include "evsm.glsl"
+
+// ShadowFilter in shadow_map_system.hpp
+#define SHADOW_FILTER_HARDWARE_PCF 0
+#define SHADOW_FILTER_POISSON 1
+#define SHADOW_FILTER_PCSS 2
+#define SHADOW_FILTER_EVSM 3
+
+// ShadingVariant in shading_variant.hpp, the driver folds the branches of every filter but the chosen one
+layout (constant_id = 0) const int shadowFilter = SHADOW_FILTER_HARDWARE_PCF;
+layout (constant_id = 1) const float shadowAmbient = 0.1;	// Light left in full directional shadow
+layout (constant_id = 2) const float poissonRadius = 1.5;	// Texels
+layout (constant_id = 4) const bool pointShadowsEnabled = true;
+
+#define PCSS_SEARCH_RADIUS 12.0		// Texels
+#define PCSS_PENUMBRA_SCALE 400.0	// Texels of penumbra per unit of light space depth between blocker and receiver
+#define PCSS_MAX_RADIUS 16.0		// Texels
+
+const mat4 biasMat = mat4( 
+	0.5, 0.0, 0.0, 0.0,
+	0.0, 0.5, 0.0, 0.0,
+	0.0, 0.0, 1.0, 0.0,
+	0.5, 0.5, 0.0, 1.0 );
+
+const vec2 poissonDisk[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+	vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+	vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+	vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+	vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+// Interleaved gradient noise, rotates the disk per pixel so banding turns into fine noise
+mat2 poissonRotation()
+{
+	float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	float s = sin(angle);
+	float c = cos(angle);
+	return mat2(c, s, -s, c);
+}
+
+float filterPoisson(vec3 sc, float layer, float radiusTexels)
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+	mat2 rotation = poissonRotation();
+
+	float lit = 0.0;
+	for (int i = 0; i < 16; i++)
+	{
+		vec2 offset = rotation * poissonDisk[i] * radiusTexels * texelSize;
+		lit += texture(shadowMap, vec4(sc.xy + offset, layer, sc.z));
+	}
+	return lit / 16.0;
+}
+
+float filterPCSS(vec3 sc, float layer)
+{
+	// Average depth of the occluders around the receiver
+	vec2 texelSize = 1.0 / vec2(textureSize(shadowDepth, 0).xy);
+	mat2 rotation = poissonRotation();
+	float blockerSum = 0.0;
+	int blockerCount = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		vec2 offset = rotation * poissonDisk[i] * PCSS_SEARCH_RADIUS * texelSize;
+		float depth = texture(shadowDepth, vec3(sc.xy + offset, layer)).r;
+		if (depth < sc.z)
+		{
+			blockerSum += depth;
+			blockerCount++;
+		}
+	}
+	if (blockerCount == 0)
+	{
+		return 1.0;
+	}
+
+	// Directional light, the penumbra grows linearly with the blocker to receiver distance
+	float blockerDepth = blockerSum / float(blockerCount);
+	float radius = clamp((sc.z - blockerDepth) * PCSS_PENUMBRA_SCALE, 1.0, PCSS_MAX_RADIUS);
+	return filterPoisson(sc, layer, radius);
+}
+
+float filterEVSM(vec3 sc, float layer, vec2 uvDx, vec2 uvDy)
+{
+	vec4 moments = textureGrad(shadowMoments, vec3(sc.xy, layer), uvDx, uvDy);
+	vec2 warped = warpDepth(sc.z);
+
+	// Positive and negative warps bound the visibility from both sides, the smaller one wins
+	float positive = chebyshevUpperBound(moments.xy, warped.x, EVSM_MIN_VARIANCE * warped.x * warped.x);
+	float negative = chebyshevUpperBound(moments.zw, warped.y, EVSM_MIN_VARIANCE * warped.y * warped.y);
+	return min(positive, negative);
+}
+
+float directionalShadow(vec3 positionWorld, float viewDepth)
+{
+	// Screen space derivatives before any divergent branch, mapped to shadow uv for the EVSM mip selection
+	vec3 positionDx = dFdx(positionWorld);
+	vec3 positionDy = dFdy(positionWorld);
+
+	// First cascade whose far split covers this depth, unshadowed past the last one
+	int cascade = 0;
+	while (cascade < ubs.cascadeCount && viewDepth > ubs.directionalLight.cascadeSplits[cascade])
+	{
+		cascade++;
+	}
+	if (cascade == ubs.cascadeCount)
+	{
+		return 1.0;
+	}
+
+	mat4 shadowMatrix = biasMat * ubs.directionalLight.viewProjection[cascade];
+	vec4 shadowCoord = shadowMatrix * vec4(positionWorld, 1.0);
+	shadowCoord /= shadowCoord.w;
+	if (shadowCoord.z <= -1.0 || shadowCoord.z >= 1.0)
+	{
+		return 1.0;
+	}
+
+	float layer = float(cascade);
+	float lit;
+	if (shadowFilter == SHADOW_FILTER_POISSON)
+	{
+		lit = filterPoisson(shadowCoord.xyz, layer, poissonRadius);
+	}
+	else if (shadowFilter == SHADOW_FILTER_PCSS)
+	{
+		lit = filterPCSS(shadowCoord.xyz, layer);
+	}
+	else if (shadowFilter == SHADOW_FILTER_EVSM)
+	{
+		vec2 uvDx = (shadowMatrix * vec4(positionDx, 0.0)).xy;
+		vec2 uvDy = (shadowMatrix * vec4(positionDy, 0.0)).xy;
+		lit = filterEVSM(shadowCoord.xyz, layer, uvDx, uvDy);
+	}
+	else
+	{
+		lit = texture(shadowMap, vec4(shadowCoord.xy, layer, shadowCoord.z));
+	}
+	return mix(shadowAmbient, 1.0, lit);
+}
+
+// Point light cube shadows, each light owns the same tile in all six face layers (+X -X +Y -Y +Z -Z) of the atlas
+float pointShadow(int shadowIndex, vec3 lightPosition, vec3 positionWorld)
+{
+	vec3 dir = positionWorld - lightPosition;
+	vec3 absDir = abs(dir);
+	int face;
+	if (absDir.x >= absDir.y && absDir.x >= absDir.z)
+	{
+		face = dir.x > 0.0 ? 0 : 1;
+	}
+	else if (absDir.y >= absDir.z)
+	{
+		face = dir.y > 0.0 ? 2 : 3;
+	}
+	else
+	{
+		face = dir.z > 0.0 ? 4 : 5;
+	}
+
+	vec4 shadowCoord = biasMat * ubs.pointShadowMatrices[shadowIndex * 6 + face] * vec4(positionWorld, 1.0);
+	shadowCoord /= shadowCoord.w;
+
+	// Stay half a texel inside the tile so neighbouring tiles never bleed in
+	vec4 tile = ubs.pointShadowTiles[shadowIndex];
+	vec2 halfTexel = 0.5 / (vec2(textureSize(pointShadowMap, 0).xy) * tile.zw);
+	vec2 uv = tile.xy + clamp(shadowCoord.st, halfTexel, 1.0 - halfTexel) * tile.zw;
+
+	float dist = texture(pointShadowMap, vec3(uv, float(face))).r;
+	return dist < shadowCoord.z ? 0.0 : 1.0;
+}
\ No newline at end of file
@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
+
 layout(location = 0) in vec3 inFragColor;
 layout(location = 1) in vec3 inFragPositionWorld;
 layout(location = 2) in vec3 inFragNormalWorld;
@@ -7,69 +10,71 @@ layout(location = 3) in vec2 inFragTexCoord;
 // Shadow
 layout(location = 4) in vec3 inViewVec;
 layout(location = 5) in vec3 inLightVec;
-layout(location = 6) in vec4 inShadowCoord;
 
 layout (location = 0) out vec4 outFragColor;
 
 struct PointLight{
-	vec4 position;
+	vec4 position; // w = range
 	vec4 color;
+	int shadowIndex; // -1 when unshadowed
 };
 
+#define MAX_SHADOW_CASCADES 4
+#define MAX_SHADOWED_POINT_LIGHTS 8
+
 struct DirectionalLight {
 	vec4 position;
-	mat4 viewProjection;
+	mat4 viewProjection[MAX_SHADOW_CASCADES];
+	vec4 cascadeSplits; // view depth where each cascade ends
 };
 
-layout (set = 1, binding = 0) uniform sampler2D shadowMap;
+layout (set = 1, binding = 0) uniform sampler2DArrayShadow shadowMap;
+layout (set = 1, binding = 1) uniform sampler2DArray pointShadowMap;
+layout (set = 1, binding = 2) uniform sampler2DArray shadowDepth;
+layout (set = 1, binding = 3) uniform sampler2DArray shadowMoments;
 
 layout(set = 0, binding = 1) uniform UniformBufferScene{
 	mat4 inverseView;
 	vec4 ambientLightColor;
-	PointLight pointLights[10];
 	DirectionalLight directionalLight;
+	mat4 pointShadowMatrices[MAX_SHADOWED_POINT_LIGHTS * 6]; // Cube faces +X -X +Y -Y +Z -Z per slot
+	vec4 pointShadowTiles[MAX_SHADOWED_POINT_LIGHTS]; // Atlas uv offset in xy, scale in zw
 	int numLights;
+	int cascadeCount;
 } ubs;
 
-#define ambient 0.1
-const int enablePCF = 1;
-
-float textureProj(vec4 shadowCoord, vec2 off)
-{
-	float shadow = 1.0;
-	if ( shadowCoord.z > -1.0 && shadowCoord.z < 1.0 ) 
-	{
-		float dist = texture( shadowMap, shadowCoord.st + off ).r;
-		if ( shadowCoord.w > 0.0 && dist < shadowCoord.z ) 
-		{
-			shadow = ambient;
-		}
-	}
-	return shadow;
-}
-
-float filterPCF(vec4 sc)
-{
-	ivec2 texDim = textureSize(shadowMap, 0);
-	float scale = 1.5;
-	float dx = scale * 1.0 / float(texDim.x);
-	float dy = scale * 1.0 / float(texDim.y);
-
-	float shadowFactor = 0.0;
-	int count = 0;
-	int range = 1;
-	
-	for (int x = -range; x <= range; x++)
-	{
-		for (int y = -range; y <= range; y++)
-		{
-			shadowFactor += textureProj(sc, vec2(dx*x, dy*y));
-			count++;
-		}
-	
-	}
-	return shadowFactor / count;
-}
+// Clustered lights, binned by light_cluster.comp
+layout(set = 2, binding = 0) uniform ClusterInfo{
+	mat4 inverseProjection;
+	mat4 view;
+	uvec4 gridSize; // w = max lights per cluster
+	vec2 screenSize;
+	float zNear;
+	float zFar;
+	uint lightCount;
+} cluster;
+
+layout(std430, set = 2, binding = 1) readonly buffer Lights{
+	PointLight lights[];
+};
+
+layout(std430, set = 2, binding = 2) readonly buffer LightGrid{
+	uint lightCounts[];
+};
+
+layout(std430, set = 2, binding = 3) readonly buffer LightIndices{
+	uint lightIndices[];
+};
+
+layout(push_constant) uniform Push {
+	mat4 model;
+	mat4 modelNormal;
+	uint textureIndex;
+} push;
+
+#include "shadow_sampling.glsl"
+#include "lighting.glsl"
+#include "bindless.glsl"
 
 void main() {
 	vec3 cameraPositionWorld = ubs.inverseView[3].xyz;
@@ -79,31 +84,24 @@ void main() {
 	vec3 surfaceNormal = normalize(inFragNormalWorld);
 	vec3 specularLight = vec3(0.0f);
 
-	// Point lights
-	for (int i = 0; i < ubs.numLights; i++){
-		PointLight light = ubs.pointLights[i];
-		vec3 lightDir = light.position.xyz - inFragPositionWorld;
-		float attenuation = 1.0 / dot(lightDir, lightDir);
-		lightDir = normalize(lightDir);
-
-		// Diffuse
-		float cosAng = max(dot(surfaceNormal, lightDir), 0);
-		vec3 intensity = light.color.xyz * light.color.w * attenuation;
-		
-		// Specular
-		vec3 halfAngle = normalize(lightDir + viewDir);
-		float blinn = dot(surfaceNormal, halfAngle);
-		blinn = clamp(blinn, 0, 1);
-		blinn = pow(blinn, 512.0f);
-
-		specularLight += light.color.xyz * intensity * blinn;
-		diffuseLight += intensity * cosAng;
+	// Point lights of this fragment's cluster, gl_FragCoord.w is 1 / view depth
+	uvec3 grid = cluster.gridSize.xyz;
+	float viewDepth = 1.0 / gl_FragCoord.w;
+	uvec3 cell;
+	cell.xy = min(uvec2(gl_FragCoord.xy / cluster.screenSize * vec2(grid.xy)), grid.xy - 1);
+	cell.z = uint(clamp(log(viewDepth / cluster.zNear) / log(cluster.zFar / cluster.zNear) * float(grid.z), 0.0, float(grid.z - 1)));
+	uint clusterIndex = cell.x + grid.x * (cell.y + grid.y * cell.z);
+	uint base = clusterIndex * cluster.gridSize.w;
+
+	for (uint i = 0; i < lightCounts[clusterIndex]; i++){
+		PointLight light = lights[lightIndices[base + i]];
+		addPointLight(light, inFragPositionWorld, surfaceNormal, viewDir, diffuseLight, specularLight);
 	}
 
 	// Direcitional Lights
-	float shadow = (enablePCF == 1) ? filterPCF(inShadowCoord / inShadowCoord.w) : textureProj(inShadowCoord / inShadowCoord.w, vec2(0.0));
+	float shadow = directionalShadow(inFragPositionWorld, viewDepth);
 
 	vec4 lambertian = vec4(shadow * diffuseLight + specularLight, 1.0f);
-	vec4 modelTexture = vec4(inFragTexCoord, 0.0, 1.0);
-	outFragColor = lambertian * vec4(inFragColor, 1.0f);
+	vec4 albedo = vec4(inFragColor, 1.0f) * sampleBindless(push.textureIndex, inFragTexCoord);
+	outFragColor = lambertian * albedo;
 }
\ No newline at end of file
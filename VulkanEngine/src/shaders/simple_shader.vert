@@ -12,16 +12,23 @@ layout(location = 3) out vec2 outFragTexCoord;
 // Shadow
 layout(location = 4) out vec3 outViewVec;
 layout(location = 5) out vec3 outLightVec;
-layout(location = 6) out vec4 outShadowCoord;
+
+// Must match depth_prepass.vert bit for bit, the main pass tests against the prepass depth with EQUAL
+invariant gl_Position;
 
 struct PointLight{
 	vec4 position;
 	vec4 color;
+	int shadowIndex; // -1 when unshadowed
 };
 
+#define MAX_SHADOW_CASCADES 4
+#define MAX_SHADOWED_POINT_LIGHTS 8
+
 struct DirectionalLight {
 	vec4 position;
-	mat4 viewProjection;
+	mat4 viewProjection[MAX_SHADOW_CASCADES];
+	vec4 cascadeSplits; // view depth where each cascade ends
 };
 
 layout(set = 0, binding = 0) uniform UniformBufferObject{
@@ -34,34 +41,30 @@ layout(set = 0, binding = 0) uniform UniformBufferObject{
 layout(set = 0, binding = 1) uniform UniformBufferScene{
 	mat4 inverseView;
 	vec4 ambientLightColor;
-	PointLight pointLights[10];
 	DirectionalLight directionalLight;
+	mat4 pointShadowMatrices[MAX_SHADOWED_POINT_LIGHTS * 6]; // Cube faces +X -X +Y -Y +Z -Z per slot
+	vec4 pointShadowTiles[MAX_SHADOWED_POINT_LIGHTS]; // Atlas uv offset in xy, scale in zw
 	int numLights;
+	int cascadeCount;
 } ubs;
 
+// PushModelData in geometry_subpass.cpp
 layout(push_constant) uniform Push {
 	mat4 model;
 	mat4 modelNormal;
-	int texId;
+	uint textureIndex;
 } push;
 
-const mat4 biasMat = mat4( 
-	0.5, 0.0, 0.0, 0.0,
-	0.0, 0.5, 0.0, 0.0,
-	0.0, 0.0, 1.0, 0.0,
-	0.5, 0.5, 0.0, 1.0 );
-
 void main() {
 	// Object
 	vec4 worldSpace = push.model * vec4(inPosition, 1.0);
 	outFragNormalWorld = normalize(mat3(push.modelNormal) * inNormal);
 	outFragPositionWorld = worldSpace.xyz;
 	outFragColor = inColor;
-	outFragTexCoord = outFragTexCoord;
+	outFragTexCoord = inTexCoord;
 	gl_Position = ubo.projection * ubo.view * worldSpace;
 
 	// Shadow
 	outLightVec = normalize(ubs.directionalLight.position.xyz - inPosition);
 	outViewVec = -worldSpace.xyz;
-	outShadowCoord = (biasMat * ubs.directionalLight.viewProjection * push.model) * vec4(inPosition, 1.0f);
 }
\ No newline at end of file
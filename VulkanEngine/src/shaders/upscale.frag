@@ -0,0 +1,39 @@
+#version 450
+
+// Scales the rendered part of the scene color target up to the swap chain. Bilinear, optionally followed by
+// contrast adaptive sharpening to win back some of the detail lost to the lower resolution
+layout (location = 0) out vec4 outFragColor;
+
+layout (set = 0, binding = 0) uniform sampler2D sceneColor;
+
+layout (push_constant) uniform Push {
+	vec2 uvScale;		// Rendered extent over the target's extent
+	vec2 outputSize;	// Swap chain extent in pixels
+	float sharpness;	// 0 is plain bilinear, 1 the strongest sharpening
+} push;
+
+void main() {
+	vec2 texelSize = 1.0 / vec2(textureSize(sceneColor, 0));
+
+	// Bilinear taps stay inside the rendered rectangle, whatever lies past it is stale
+	vec2 uv = gl_FragCoord.xy / push.outputSize * push.uvScale;
+	vec2 maxUv = push.uvScale - 0.5 * texelSize;
+	vec3 color = texture(sceneColor, min(uv, maxUv)).rgb;
+
+	if (push.sharpness > 0.0) {
+		vec3 north = texture(sceneColor, min(uv + vec2(0.0, -texelSize.y), maxUv)).rgb;
+		vec3 south = texture(sceneColor, min(uv + vec2(0.0, texelSize.y), maxUv)).rgb;
+		vec3 east = texture(sceneColor, min(uv + vec2(texelSize.x, 0.0), maxUv)).rgb;
+		vec3 west = texture(sceneColor, min(uv + vec2(-texelSize.x, 0.0), maxUv)).rgb;
+
+		// Less sharpening where the neighbourhood already spans most of the range, avoids ringing at edges
+		vec3 minColor = min(color, min(min(north, south), min(east, west)));
+		vec3 maxColor = max(color, max(max(north, south), max(east, west)));
+		vec3 amplitude = sqrt(clamp(min(minColor, 1.0 - maxColor) / max(maxColor, vec3(1e-4)), 0.0, 1.0));
+		vec3 weight = -amplitude * mix(0.125, 0.2, push.sharpness);
+
+		color = clamp((color + (north + south + east + west) * weight) / (1.0 + 4.0 * weight), 0.0, 1.0);
+	}
+
+	outFragColor = vec4(color, 1.0);
+}
\ No newline at end of file
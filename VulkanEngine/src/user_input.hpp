@@ -10,6 +10,16 @@ namespace vke {
 			int q = GLFW_KEY_Q;
 			int e = GLFW_KEY_E;
 
+			// Renderer toggles
+			int toggleDepthPrepass = GLFW_KEY_P;
+			int toggleRenderMode = GLFW_KEY_O;
+			int toggleShadowFilter = GLFW_KEY_F;
+			int toggleCascadeCount = GLFW_KEY_C;
+			int togglePresentMode = GLFW_KEY_V;
+			int toggleLatencyMode = GLFW_KEY_L;
+			int toggleDynamicResolution = GLFW_KEY_R;
+			int toggleUpscaleFilter = GLFW_KEY_U;
+
 			int arrowUp = GLFW_KEY_UP;
 			int arrowDown = GLFW_KEY_DOWN;
 			int arrowLeft = GLFW_KEY_LEFT;
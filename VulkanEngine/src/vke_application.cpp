@@ -7,43 +7,175 @@
 #include "scene/components/vke_camera.hpp"
 #include "scene/vke_game_object.hpp"
 #include "scene/scene_graph.hpp"
+#include "scene/vke_simulation.hpp"
 
 // AXIS USED:
 // Z+ = forward
 // Y- = Up
 
 namespace vke {  
-    void CameraController(GLFWwindow* window, float dt, VkeCamera& camera) {
-        float lookSpeed = 1.0f;
-        float moveSpeed = 2.0f;
-        KeyboardInput::KeyMappings input;
+    // Upper bound on how long the loop sleeps while minimized, toggles and shutdown stay responsive
+    static constexpr double MINIMIZED_EVENT_TIMEOUT = 0.1;
 
-        glm::vec3 eulerAngles{0.0f};
-        if (glfwGetKey(window, input.arrowRight) == GLFW_PRESS) { eulerAngles.y += 1.0f; }
-        if (glfwGetKey(window, input.arrowLeft) == GLFW_PRESS) { eulerAngles.y -= 1.0f; }
-        if (glfwGetKey(window, input.arrowUp) == GLFW_PRESS) { eulerAngles.x += 1.0f; }
-        if (glfwGetKey(window, input.arrowDown) == GLFW_PRESS) { eulerAngles.x -= 1.0f; }
+    SwapChainConfig VkeApplication::swapChainSettings() {
+        SwapChainConfig config{};
+        if (const char* framesInFlight = std::getenv("VKE_FRAMES_IN_FLIGHT")) {
+            config.framesInFlight = static_cast<uint32_t>(std::strtoul(framesInFlight, nullptr, 10));
+        }
+        if (const char* imageCount = std::getenv("VKE_SWAPCHAIN_IMAGES")) {
+            config.imageCount = static_cast<uint32_t>(std::strtoul(imageCount, nullptr, 10));
+        }
+        if (const char* presentMode = std::getenv("VKE_PRESENT_MODE")) {
+            const std::string mode = presentMode;
+            if (mode == "fifo") { config.presentMode = PresentMode::Fifo; }
+            else if (mode == "fifo_relaxed") { config.presentMode = PresentMode::FifoRelaxed; }
+            else if (mode == "mailbox") { config.presentMode = PresentMode::Mailbox; }
+            else if (mode == "immediate") { config.presentMode = PresentMode::Immediate; }
+            else { throw std::runtime_error("unknown VKE_PRESENT_MODE " + mode); }
+        }
+        return config;
+    }
 
-        if (glm::dot(eulerAngles, eulerAngles) > std::numeric_limits<float>::epsilon()) {
-            camera.eulerAngles += glm::normalize(eulerAngles) * lookSpeed * dt;
+    DynamicResolutionConfig VkeApplication::dynamicResolutionSettings() {
+        DynamicResolutionConfig config{};
+        if (const char* minScale = std::getenv("VKE_RESOLUTION_MIN")) {
+            config.minScale = std::strtof(minScale, nullptr);
         }
-        camera.eulerAngles.x = glm::clamp(camera.eulerAngles.x, -glm::pi<float>()/2.0f, glm::pi<float>()/2.0f);
-        
-        glm::vec3 moveDirection{ 0.0f };
-        if (glfwGetKey(window, input.d) == GLFW_PRESS) { moveDirection.x += 1.0f; }
-        if (glfwGetKey(window, input.a) == GLFW_PRESS) { moveDirection.x -= 1.0f; }
-        if (glfwGetKey(window, input.w) == GLFW_PRESS) { moveDirection.z += 1.0f; }
-        if (glfwGetKey(window, input.s) == GLFW_PRESS) { moveDirection.z -= 1.0f; }
+        if (const char* maxScale = std::getenv("VKE_RESOLUTION_MAX")) {
+            config.maxScale = std::strtof(maxScale, nullptr);
+        }
+        if (const char* targetFrameMs = std::getenv("VKE_TARGET_FRAME_MS")) {
+            config.targetFrameMs = std::strtof(targetFrameMs, nullptr);
+        }
+        if (config.minScale <= 0.0f || config.minScale > config.maxScale || config.maxScale > 1.0f) {
+            throw std::runtime_error("resolution scales must satisfy 0 < VKE_RESOLUTION_MIN <= VKE_RESOLUTION_MAX <= 1");
+        }
+        if (config.targetFrameMs <= 0.0f) {
+            throw std::runtime_error("VKE_TARGET_FRAME_MS must be positive");
+        }
+        return config;
+    }
+
+    // Camera movement itself runs in the simulation's fixed step
+    InputState sampleInput(GLFWwindow* window) {
+        KeyboardInput::KeyMappings input;
+        InputState state{};
+
+        if (glfwGetKey(window, input.arrowRight) == GLFW_PRESS) { state.look.y += 1.0f; }
+        if (glfwGetKey(window, input.arrowLeft) == GLFW_PRESS) { state.look.y -= 1.0f; }
+        if (glfwGetKey(window, input.arrowUp) == GLFW_PRESS) { state.look.x += 1.0f; }
+        if (glfwGetKey(window, input.arrowDown) == GLFW_PRESS) { state.look.x -= 1.0f; }
+
+        if (glfwGetKey(window, input.d) == GLFW_PRESS) { state.move.x += 1.0f; }
+        if (glfwGetKey(window, input.a) == GLFW_PRESS) { state.move.x -= 1.0f; }
+        if (glfwGetKey(window, input.w) == GLFW_PRESS) { state.move.z += 1.0f; }
+        if (glfwGetKey(window, input.s) == GLFW_PRESS) { state.move.z -= 1.0f; }
+
+        if (glfwGetKey(window, input.q) == GLFW_PRESS) { state.move.y -= 1.0f; }
+        if (glfwGetKey(window, input.e) == GLFW_PRESS) { state.move.y += 1.0f; }
+
+        return state;
+    }
+
+    void VkeApplication::rendererToggles(float dt) {
+        KeyboardInput::KeyMappings input;
+        m_modeFrameTime += dt;
+        m_modeShadowGpuTime += m_renderer.getGpuTimings().shadowMs;
+        m_modeMainGpuTime += m_renderer.getGpuTimings().mainMs;
+        m_modeFrameCount++;
+
+        auto describeMode = [&]() {
+            bool deferred = m_renderer.getRenderMode() == RenderMode::Deferred;
+            bool justInTime = m_renderer.getLatencyMode() == LatencyMode::JustInTime;
+            return std::string(deferred ? "Deferred" : "Forward") +
+                (!deferred && m_renderer.isDepthPrepassEnabled() ? " + depth prepass" : "") +
+                ", " + shadowFilterName(m_renderer.getShadowFilter()) + " shadows" +
+                ", " + std::to_string(m_renderer.getCascadeCount()) + " cascades" +
+                ", " + presentModeName(m_renderer.getPresentMode()) +
+                (justInTime ? ", just in time" : ", queued") +
+                (m_renderer.getDynamicResolution().enabled ? ", dynamic resolution " : ", resolution ") +
+                std::to_string(static_cast<int>(m_renderer.getResolutionScale() * 100.0f + 0.5f)) + "%" +
+                ", " + upscaleFilterName(m_renderer.getUpscaleFilter()) + " upscale";
+        };
 
-        if (glfwGetKey(window, input.q) == GLFW_PRESS) { moveDirection.y -= 1.0f; }
-        if (glfwGetKey(window, input.e) == GLFW_PRESS) { moveDirection.y += 1.0f; }
+        bool prepassPressed = glfwGetKey(m_window.getGLFWwindow(), input.toggleDepthPrepass) == GLFW_PRESS;
+        bool renderModePressed = glfwGetKey(m_window.getGLFWwindow(), input.toggleRenderMode) == GLFW_PRESS;
+        bool prepassToggled = prepassPressed && !m_toggleKeyHeld;
+        bool shadowFilterPressed = glfwGetKey(m_window.getGLFWwindow(), input.toggleShadowFilter) == GLFW_PRESS;
+        bool renderModeToggled = renderModePressed && !m_renderModeKeyHeld;
+        bool shadowFilterToggled = shadowFilterPressed && !m_shadowFilterKeyHeld;
+        bool cascadeCountPressed = glfwGetKey(m_window.getGLFWwindow(), input.toggleCascadeCount) == GLFW_PRESS;
+        bool cascadeCountToggled = cascadeCountPressed && !m_cascadeCountKeyHeld;
+        bool presentModePressed = glfwGetKey(m_window.getGLFWwindow(), input.togglePresentMode) == GLFW_PRESS;
+        bool latencyModePressed = glfwGetKey(m_window.getGLFWwindow(), input.toggleLatencyMode) == GLFW_PRESS;
+        bool presentModeToggled = presentModePressed && !m_presentModeKeyHeld;
+        bool latencyModeToggled = latencyModePressed && !m_latencyModeKeyHeld;
+        bool dynamicResolutionPressed = glfwGetKey(m_window.getGLFWwindow(), input.toggleDynamicResolution) == GLFW_PRESS;
+        bool upscaleFilterPressed = glfwGetKey(m_window.getGLFWwindow(), input.toggleUpscaleFilter) == GLFW_PRESS;
+        bool dynamicResolutionToggled = dynamicResolutionPressed && !m_dynamicResolutionKeyHeld;
+        bool upscaleFilterToggled = upscaleFilterPressed && !m_upscaleFilterKeyHeld;
+        m_toggleKeyHeld = prepassPressed;
+        m_renderModeKeyHeld = renderModePressed;
+        m_shadowFilterKeyHeld = shadowFilterPressed;
+        m_cascadeCountKeyHeld = cascadeCountPressed;
+        m_presentModeKeyHeld = presentModePressed;
+        m_latencyModeKeyHeld = latencyModePressed;
+        m_dynamicResolutionKeyHeld = dynamicResolutionPressed;
+        m_upscaleFilterKeyHeld = upscaleFilterPressed;
 
-        if (glm::dot(moveDirection, moveDirection) > std::numeric_limits<float>::epsilon()) {
-            camera.position += glm::normalize(moveDirection) * moveSpeed * dt;
+        if (!prepassToggled && !renderModeToggled && !shadowFilterToggled && !cascadeCountToggled && !presentModeToggled &&
+            !latencyModeToggled && !dynamicResolutionToggled && !upscaleFilterToggled)
+            return;
+
+        std::cout << describeMode() << ": "
+            << (m_modeFrameTime / m_modeFrameCount) * 1000.0f << " ms avg over "
+            << m_modeFrameCount << " frames, GPU shadows "
+            << m_modeShadowGpuTime / m_modeFrameCount << " ms, main pass "
+            << m_modeMainGpuTime / m_modeFrameCount << " ms" << std::endl;
+
+        if (prepassToggled) {
+            m_renderer.setDepthPrepass(!m_renderer.isDepthPrepassEnabled());
+        }
+        if (renderModeToggled) {
+            bool deferred = m_renderer.getRenderMode() == RenderMode::Deferred;
+            m_renderer.setRenderMode(deferred ? RenderMode::Forward : RenderMode::Deferred);
+        }
+        if (shadowFilterToggled) {
+            uint32_t next = (static_cast<uint32_t>(m_renderer.getShadowFilter()) + 1) % static_cast<uint32_t>(ShadowFilter::Count);
+            m_renderer.setShadowFilter(static_cast<ShadowFilter>(next));
         }
+        if (cascadeCountToggled) {
+            // 2 to MAX_SHADOW_CASCADES
+            int count = m_renderer.getCascadeCount();
+            m_renderer.setCascadeCount(count == MAX_SHADOW_CASCADES ? 2 : count + 1);
+        }
+        if (presentModeToggled) {
+            uint32_t next = (static_cast<uint32_t>(m_renderer.getRequestedPresentMode()) + 1) % static_cast<uint32_t>(PresentMode::Count);
+            m_renderer.setPresentMode(static_cast<PresentMode>(next));
+        }
+        if (latencyModeToggled) {
+            bool justInTime = m_renderer.getLatencyMode() == LatencyMode::JustInTime;
+            m_renderer.setLatencyMode(justInTime ? LatencyMode::Queued : LatencyMode::JustInTime);
+        }
+        if (dynamicResolutionToggled) {
+            DynamicResolutionConfig config = m_renderer.getDynamicResolution();
+            config.enabled = !config.enabled;
+            m_renderer.setDynamicResolution(config);
+        }
+        if (upscaleFilterToggled) {
+            uint32_t next = (static_cast<uint32_t>(m_renderer.getUpscaleFilter()) + 1) % static_cast<uint32_t>(UpscaleFilter::Count);
+            m_renderer.setUpscaleFilter(static_cast<UpscaleFilter>(next));
+        }
+
+        std::cout << "Render mode: " << describeMode() << std::endl;
+        m_modeFrameTime = 0.0f;
+        m_modeShadowGpuTime = 0.0f;
+        m_modeMainGpuTime = 0.0f;
+        m_modeFrameCount = 0;
     }
 
     VkeApplication::VkeApplication() {
+        m_renderer.setDynamicResolution(dynamicResolutionSettings());
         loadGameObjects();
     }
 
@@ -52,19 +184,35 @@ namespace vke {
 	void VkeApplication::run() {
         VkeCamera sceneCamera{};
         sceneCamera.position = glm::vec3(0.0f, -1.0f, -4.0f);
+
+        // This thread renders, GLFW requires events to be pumped on the main thread
+        VkeSimulation simulation{ m_gameObjects, sceneCamera };
+        simulation.start();
         
 		while (!m_window.shouldClose()) {
-            glfwPollEvents();
+            // Before input so the frame is built from the freshest state the latency mode allows
+            m_renderer.waitForFrameStart();
+
+            // Minimized frames are skipped, sleep on the event queue instead of spinning through them
+            if (m_window.isMinimized()) {
+                glfwWaitEventsTimeout(MINIMIZED_EVENT_TIMEOUT);
+            }
+            else {
+                glfwPollEvents();
+            }
             
             float time = glfwGetTime();
             TimeStep deltaTime = time - m_lastFrameTime;
             m_lastFrameTime = time;
             
-            CameraController(m_window.getGLFWwindow(), deltaTime, sceneCamera);
+            simulation.setInput(sampleInput(m_window.getGLFWwindow()));
+            rendererToggles(deltaTime);
 
+            simulation.apply(m_gameObjects, sceneCamera);
             m_renderer.update(sceneCamera, m_gameObjects, deltaTime);
 		}
 
+        simulation.stop();
         vkDeviceWaitIdle(m_device.device());
 	}
 
@@ -91,6 +239,7 @@ namespace vke {
         centerObject.model = vaseModel;
         centerObject.transform->translation = { 0.0f, 0.5f, 0.0f };
         centerObject.transform->scale = glm::vec3{ 3.0f };
+        centerObject.isStatic = true;
         m_gameObjects.emplace(centerObject.getId(), std::move(centerObject));   
 
         std::shared_ptr<VkeModel> quadModel = VkeModel::createModelFromFile(m_device, "models/quad.obj");
@@ -98,6 +247,7 @@ namespace vke {
         quad.model = quadModel;
         quad.transform->translation = { 0.0f, 0.5f, 0.0f };
         quad.transform->scale = glm::vec3{ 10.0f };
+        quad.isStatic = true;
         m_gameObjects.emplace(quad.getId(), std::move(quad));
 
         // Point Lights
@@ -107,11 +257,12 @@ namespace vke {
         };
         
         auto directionalLight = VkeGameObject::createDirectionalLight(0.9f, 45.0f, lightColors[1]);
-        for (int i = 0; i < lightColors.size(); i++) {
+        for (size_t i = 0; i < lightColors.size(); i++) {
             auto pointLight = VkeGameObject::createPointLight(0.9f, 0.1f, lightColors[i]);
+            pointLight.pointLight->castsShadows = true;
             auto rotateLight = glm::rotate(
                 glm::mat4(1.0f),
-                i * glm::two_pi<float>() / lightColors.size(),
+                static_cast<float>(i) * glm::two_pi<float>() / static_cast<float>(lightColors.size()),
                 { 0.0f, -1.0f, 0.0f }
             );
 
@@ -14,6 +14,7 @@
 #include <vector>
 #include <array>
 #include <stdexcept>
+#include <cstdlib>
 
 namespace vke {
 	class VkeApplication {
@@ -28,12 +29,33 @@ namespace vke {
 
 	private:
 		void loadGameObjects();
+		void rendererToggles(float dt);
+
+		// VKE_FRAMES_IN_FLIGHT, VKE_PRESENT_MODE (fifo, fifo_relaxed, mailbox, immediate) and VKE_SWAPCHAIN_IMAGES
+		// from the environment, SwapChainConfig defaults for any that are unset
+		static SwapChainConfig swapChainSettings();
+		// VKE_RESOLUTION_MIN, VKE_RESOLUTION_MAX (scales of the swap chain extent) and VKE_TARGET_FRAME_MS
+		static DynamicResolutionConfig dynamicResolutionSettings();
 
 		VkeWindow m_window{ 1000, 1000, "Vulkan Renderer" };
 		VkeDevice m_device{ m_window };
-		VkeRenderer m_renderer{ m_window, m_device };
+		VkeRenderer m_renderer{ m_window, m_device, swapChainSettings() };
 
 		float m_lastFrameTime = 0.0f;
+
+		// Frame time accumulated since the last renderer toggle, printed when switching modes
+		bool m_toggleKeyHeld = false;
+		bool m_renderModeKeyHeld = false;
+		bool m_shadowFilterKeyHeld = false;
+		bool m_cascadeCountKeyHeld = false;
+		bool m_presentModeKeyHeld = false;
+		bool m_latencyModeKeyHeld = false;
+		bool m_dynamicResolutionKeyHeld = false;
+		bool m_upscaleFilterKeyHeld = false;
+		float m_modeFrameTime = 0.0f;
+		float m_modeShadowGpuTime = 0.0f;
+		float m_modeMainGpuTime = 0.0f;
+		uint32_t m_modeFrameCount = 0;
 		VkeGameObject::Map m_gameObjects;
 	};
 }
\ No newline at end of file
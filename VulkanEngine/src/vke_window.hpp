@@ -23,6 +23,7 @@ namespace vke {
 		bool shouldClose() const { return glfwWindowShouldClose(m_window); }
 		VkExtent2D getExtent() { return { static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height) }; }
 		bool wasWindowResized() { return m_frameBufferResized; }
+		bool isMinimized() const { return m_width == 0 || m_height == 0; }
 		void resetWindowResizedFlag() { m_frameBufferResized = false; }
 
 	private:
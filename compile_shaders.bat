@@ -10,6 +10,10 @@ cd %shaderDir%
 
 for %%i in ("%shaderDir%\*.vert")do %vkCompilerDir% "%%~i" -o "%%~i.spv"
 for %%i in ("%shaderDir%\*.frag")do %vkCompilerDir% "%%~i" -o "%%~i.spv"
+for %%i in ("%shaderDir%\*.comp")do %vkCompilerDir% "%%~i" -o "%%~i.spv"
+
+:: Bake the SPIR-V into embedded_shaders.gen.hpp so the executable doesn't load shaders at runtime
+powershell -NoProfile -ExecutionPolicy Bypass -File "%~dp0embed_shaders.ps1" "%shaderDir%"
 
 @echo Finished compiling shaders.
 @exit 0
\ No newline at end of file
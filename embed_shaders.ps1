@@ -0,0 +1,50 @@
+# Embeds every compiled shader into a header of constexpr SPIR-V arrays, run by compile_shaders.bat after glslc
+param([string]$shaderDir = "$PSScriptRoot\VulkanEngine\src\shaders")
+
+# FNV-1a over the SPIR-V bytes, matches hashShaderCode in vke_shader_library.cpp
+Add-Type -TypeDefinition @"
+public static class ShaderHash {
+    public static ulong Fnv1a(byte[] data) {
+        ulong hash = 14695981039346656037UL;
+        unchecked {
+            foreach (byte b in data) { hash = (hash ^ b) * 1099511628211UL; }
+        }
+        return hash;
+    }
+}
+"@
+
+$out = New-Object System.Text.StringBuilder
+[void]$out.Append("// Generated by embed_shaders.ps1 from the .spv files in this directory, do not edit`n")
+[void]$out.Append("#pragma once`n`n")
+[void]$out.Append("#include `"../core/vke_shader_library.hpp`"`n`n")
+[void]$out.Append("namespace vke {`n")
+
+$table = @()
+foreach ($file in Get-ChildItem -Path $shaderDir -Filter *.spv | Sort-Object Name) {
+    $bytes = [System.IO.File]::ReadAllBytes($file.FullName)
+    $symbol = $file.Name -replace '[^A-Za-z0-9]', '_'
+    $hash = [ShaderHash]::Fnv1a($bytes)
+
+    [void]$out.Append("`tconstexpr uint32_t $symbol[] = {`n")
+    for ($i = 0; $i -lt $bytes.Length; $i += 32) {
+        $words = @()
+        for ($j = $i; $j -lt [Math]::Min($i + 32, $bytes.Length); $j += 4) {
+            $words += "0x{0:x8}" -f [BitConverter]::ToUInt32($bytes, $j)
+        }
+        [void]$out.Append("`t`t" + ($words -join ", ") + ",`n")
+    }
+    [void]$out.Append("`t};`n`n")
+    $table += "`t`t{ `"$($file.Name)`", $symbol, sizeof($symbol), 0x{0:x16}ull }," -f $hash
+}
+
+[void]$out.Append("`tconstexpr EmbeddedShader embeddedShaders[] = {`n")
+[void]$out.Append(($table -join "`n") + "`n")
+[void]$out.Append("`t};`n}")
+
+# Only touch the header when the shaders changed, so an unchanged build doesn't recompile it
+$target = Join-Path $shaderDir "embedded_shaders.gen.hpp"
+$text = $out.ToString()
+if (!(Test-Path $target) -or [System.IO.File]::ReadAllText($target) -ne $text) {
+    [System.IO.File]::WriteAllText($target, $text)
+}